@@ -0,0 +1,449 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2020 SIGNET Lab, Department of Information Engineering,
+ * University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * This program benchmarks the hot paths of the qd-channel module and writes the
+ * results to a JSON file, so that performance regressions can be tracked across
+ * releases.
+ * For each of the given array sizes, the scenario is loaded by a new
+ * QdChannelModel, and the channel of every available link is requested at every
+ * timestep, measuring:
+ * - the scenario load time, and the time spent reading each input file
+ * - the GetChannel latency when the channel has to be generated (miss) and when
+ *   it is found in the cache (hit). Misses are also grouped by number of MPCs, as
+ *   they measure the cost of QdChannelModel::GetNewChannel. Hits are measured
+ *   both with the mobility models and with a link handle resolved in advance
+ * - the latency of ComputeSvdBeamformingVectors,
+ *   ComputeSvdBeamformingVectorsMatrixFree, and GetFirstEigenvector
+ * Finally, the peak resident set size of the process is reported.
+ *
+ * Latencies are measured in microseconds with a monotonic wall clock. Larger MPC
+ * counts than the ones of the shipped scenario can be benchmarked by pointing the
+ * program to a different scenario.
+ */
+
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/core-module.h"
+#include "ns3/csv-reader.h"
+#include "ns3/node-container.h"
+#include "ns3/qd-channel-model.h"
+#include "ns3/qd-channel-utils.h"
+#include "ns3/uniform-planar-array.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <sys/resource.h>
+
+NS_LOG_COMPONENT_DEFINE("QdChannelBenchmark");
+
+using namespace ns3;
+
+/**
+ * Latency samples of a benchmarked operation
+ */
+class LatencyStats
+{
+  public:
+    /**
+     * Add a sample
+     *
+     * \param latency the latency [us]
+     */
+    void Add(double latency);
+
+    /**
+     * Write the statistics of the samples as a JSON object
+     *
+     * \param os the output stream
+     */
+    void Write(std::ostream& os) const;
+
+  private:
+    std::vector<double> m_samples; //!< the latency samples [us]
+};
+
+/// The mobility models of the two nodes of each link
+using LinkList = std::vector<std::pair<Ptr<MobilityModel>, Ptr<MobilityModel>>>;
+
+/**
+ * Benchmark of a given array size, with its own channel model and antennas
+ */
+struct ArrayBenchmark
+{
+    uint32_t size;                  //!< number of rows and columns of the arrays
+    Ptr<QdChannelModel> qdChannel;  //!< the channel model
+    Ptr<PhasedArrayModel> aAntenna; //!< the antenna of the first node of each link
+    Ptr<PhasedArrayModel> bAntenna; //!< the antenna of the second node of each link
+    LatencyStats getChannelMiss;    //!< GetChannel latency when the channel is generated
+    LatencyStats getChannelHit;     //!< GetChannel latency when the channel is cached
+    LatencyStats getHandleHit;      //!< GetChannel latency with a link handle, when cached
+    std::map<uint64_t, LatencyStats> getNewChannel; //!< GetChannel misses, by number of MPCs
+    LatencyStats svd;                               //!< ComputeSvdBeamformingVectors latency
+    LatencyStats svdMatrixFree;    //!< ComputeSvdBeamformingVectorsMatrixFree latency
+    LatencyStats firstEigenvector; //!< GetFirstEigenvector latency
+};
+
+/**
+ * Measure the wall-clock time needed to run a function
+ *
+ * \param f the function to run
+ * \return the elapsed time [us]
+ */
+template <class F>
+static double
+MeasureLatency(F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+/**
+ * Benchmark all links of all array sizes at the current timestep
+ *
+ * \param benchmarks the benchmark of each array size
+ * \param links the mobility models of the two nodes of each link
+ * \param numHits number of GetChannel calls hitting the cache for each miss
+ */
+static void BenchmarkTimestep(std::vector<ArrayBenchmark>* benchmarks,
+                              const LinkList* links,
+                              uint32_t numHits);
+
+/**
+ * Get the peak resident set size of the process
+ *
+ * \return the peak resident set size [kB]
+ */
+static uint64_t GetPeakRss();
+
+/**
+ * Escape a string to be written as a JSON string
+ *
+ * \param str the string
+ * \return the escaped string, including the quotes
+ */
+static std::string JsonString(const std::string& str);
+
+int
+main(int argc, char* argv[])
+{
+    std::string qdFilesPath =
+        "contrib/qd-channel/model/QD/"; // The path of the folder with the QD scenarios
+    std::string scenario = "Indoor1";   // The name of the scenario
+    std::string outputFile = "qd-channel-benchmark.json"; // The output JSON file
+    std::string arraySizes = "2,4,8,16"; // Comma-separated sizes of the square arrays
+    uint32_t maxTimesteps = 0;           // Maximum number of timesteps, 0 for all
+    uint32_t numHits = 10;               // Number of GetChannel cache hits for each miss
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("qdFilesPath", "The path of the folder with the QD scenarios", qdFilesPath);
+    cmd.AddValue("scenario", "The name of the scenario", scenario);
+    cmd.AddValue("outputFile", "The output JSON file", outputFile);
+    cmd.AddValue("arraySizes", "Comma-separated sizes of the square arrays", arraySizes);
+    cmd.AddValue("maxTimesteps", "Maximum number of timesteps, 0 for all", maxTimesteps);
+    cmd.AddValue("numHits", "Number of GetChannel cache hits for each miss", numHits);
+    cmd.Parse(argc, argv);
+
+    // Create one node for each position of the ray tracer
+    std::string posFileName =
+        qdFilesPath + "/" + scenario + "/Output/Ns3/NodesPosition/NodesPosition.csv";
+    NodeContainer nodes;
+    CsvReader csv(posFileName, ',');
+    while (csv.FetchNextRow())
+    {
+        if (csv.IsBlankRow())
+        {
+            continue;
+        }
+
+        double x, y, z;
+        bool ok = csv.GetValue(0, x);
+        ok |= csv.GetValue(1, y);
+        ok |= csv.GetValue(2, z);
+        NS_ABORT_MSG_IF(!ok, "Something went wrong while parsing the file: " << posFileName);
+
+        Ptr<Node> node = CreateObject<Node>();
+        Ptr<MobilityModel> mob = CreateObject<ConstantPositionMobilityModel>();
+        mob->SetPosition(Vector(x, y, z));
+        node->AggregateObject(mob);
+        nodes.Add(node);
+    }
+
+    // Load the scenario once for each array size
+    std::vector<ArrayBenchmark> benchmarks;
+    LatencyStats loadTime;
+    std::istringstream sizeStream(arraySizes);
+    std::string sizeStr;
+    while (std::getline(sizeStream, sizeStr, ','))
+    {
+        ArrayBenchmark benchmark;
+        benchmark.size = std::stoul(sizeStr);
+        NS_ABORT_MSG_IF(benchmark.size == 0, "Array sizes must be positive");
+
+        loadTime.Add(MeasureLatency([&benchmark, &qdFilesPath, &scenario]() {
+            benchmark.qdChannel = CreateObject<QdChannelModel>(qdFilesPath, scenario);
+        }));
+        benchmark.aAntenna =
+            CreateObjectWithAttributes<UniformPlanarArray>("NumColumns",
+                                                           UintegerValue(benchmark.size),
+                                                           "NumRows",
+                                                           UintegerValue(benchmark.size));
+        benchmark.bAntenna =
+            CreateObjectWithAttributes<UniformPlanarArray>("NumColumns",
+                                                           UintegerValue(benchmark.size),
+                                                           "NumRows",
+                                                           UintegerValue(benchmark.size));
+        benchmarks.push_back(benchmark);
+    }
+    NS_ABORT_MSG_IF(benchmarks.empty(), "No array size given");
+    Ptr<QdChannelModel> qdChannel = benchmarks.front().qdChannel;
+
+    LinkList links;
+    for (uint32_t i = 0; i < nodes.GetN(); i++)
+    {
+        for (uint32_t j = i + 1; j < nodes.GetN(); j++)
+        {
+            if (qdChannel->IsLinkAvailable(nodes.Get(i)->GetId(), nodes.Get(j)->GetId()))
+            {
+                links.emplace_back(nodes.Get(i)->GetObject<MobilityModel>(),
+                                   nodes.Get(j)->GetObject<MobilityModel>());
+            }
+        }
+    }
+
+    // Request the channels once per timestep
+    uint32_t numTimesteps = qdChannel->GetNumTimesteps();
+    if (maxTimesteps > 0)
+    {
+        numTimesteps = std::min(numTimesteps, maxTimesteps);
+    }
+    NS_LOG_INFO(links.size() << " links, " << numTimesteps << " timesteps");
+    for (uint32_t t = 0; t < numTimesteps; t++)
+    {
+        Simulator::Schedule(qdChannel->GetUpdatePeriod() * t,
+                            &BenchmarkTimestep,
+                            &benchmarks,
+                            &links,
+                            numHits);
+    }
+    Simulator::Run();
+
+    // Write the results
+    std::ofstream f;
+    f.open(outputFile, std::ios::out);
+    f << "{\n";
+    f << "  \"scenario\": " << JsonString(scenario) << ",\n";
+    f << "  \"numNodes\": " << nodes.GetN() << ",\n";
+    f << "  \"numLinks\": " << links.size() << ",\n";
+    f << "  \"numTimesteps\": " << numTimesteps << ",\n";
+    f << "  \"load\": {\n";
+    f << "    \"total_us\": ";
+    loadTime.Write(f);
+    f << ",\n";
+    const QdChannelModel::LoadReport& loadReport = qdChannel->GetLoadReport();
+    f << "    \"readParaCfgFile_us\": " << loadReport.paraCfgTime * 1e6 << ",\n";
+    f << "    \"readNodesPosition_us\": " << loadReport.nodesPositionTime * 1e6 << ",\n";
+    f << "    \"readQdFiles_us\": " << loadReport.qdFilesTime * 1e6 << ",\n";
+    f << "    \"bytesRead\": "
+      << loadReport.paraCfgBytes + loadReport.nodesPositionBytes + loadReport.qdFilesBytes
+      << ",\n";
+    f << "    \"qdInfoBytes\": "
+      << loadReport.qdInfoPayloadBytes + loadReport.qdInfoContainerBytes +
+             loadReport.qdInfoOverheadBytes
+      << ",\n";
+    f << "    \"files\": [";
+    const auto& fileLoadTimes = qdChannel->GetFileLoadTimes();
+    for (size_t i = 0; i < fileLoadTimes.size(); i++)
+    {
+        f << (i == 0 ? "\n" : ",\n") << "      {\"file\": " << JsonString(fileLoadTimes[i].first)
+          << ", \"time_us\": " << fileLoadTimes[i].second * 1e6 << "}";
+    }
+    f << "\n    ]\n";
+    f << "  },\n";
+    f << "  \"arrays\": [";
+    for (size_t i = 0; i < benchmarks.size(); i++)
+    {
+        const ArrayBenchmark& benchmark = benchmarks[i];
+        f << (i == 0 ? "\n" : ",\n") << "    {\n";
+        f << "      \"numRows\": " << benchmark.size << ",\n";
+        f << "      \"numColumns\": " << benchmark.size << ",\n";
+        f << "      \"getChannelMiss_us\": ";
+        benchmark.getChannelMiss.Write(f);
+        f << ",\n      \"getChannelHit_us\": ";
+        benchmark.getChannelHit.Write(f);
+        f << ",\n      \"getHandleHit_us\": ";
+        benchmark.getHandleHit.Write(f);
+        f << ",\n      \"getNewChannel\": [";
+        for (auto it = benchmark.getNewChannel.begin(); it != benchmark.getNewChannel.end(); ++it)
+        {
+            f << (it == benchmark.getNewChannel.begin() ? "\n" : ",\n")
+              << "        {\"numMpcs\": " << it->first << ", \"latency_us\": ";
+            it->second.Write(f);
+            f << "}";
+        }
+        f << "\n      ],\n      \"computeSvdBeamformingVectors_us\": ";
+        benchmark.svd.Write(f);
+        f << ",\n      \"computeSvdBeamformingVectorsMatrixFree_us\": ";
+        benchmark.svdMatrixFree.Write(f);
+        f << ",\n      \"getFirstEigenvector_us\": ";
+        benchmark.firstEigenvector.Write(f);
+        f << "\n    }";
+    }
+    f << "\n  ],\n";
+    f << "  \"peakRss_kB\": " << GetPeakRss() << "\n";
+    f << "}\n";
+    f.close();
+    NS_LOG_INFO("Benchmark results written to " << outputFile);
+
+    Simulator::Destroy();
+    return 0;
+}
+
+/*  UTILITIES */
+void
+LatencyStats::Add(double latency)
+{
+    m_samples.push_back(latency);
+}
+
+void
+LatencyStats::Write(std::ostream& os) const
+{
+    if (m_samples.empty())
+    {
+        os << "{\"count\": 0}";
+        return;
+    }
+
+    std::vector<double> sorted(m_samples);
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0;
+    for (double sample : sorted)
+    {
+        sum += sample;
+    }
+    auto percentile = [&sorted](double p) {
+        return sorted[std::min<size_t>(p * sorted.size(), sorted.size() - 1)];
+    };
+
+    os << "{\"count\": " << sorted.size() << ", \"mean\": " << sum / sorted.size()
+       << ", \"min\": " << sorted.front() << ", \"p50\": " << percentile(0.5)
+       << ", \"p99\": " << percentile(0.99) << ", \"max\": " << sorted.back() << "}";
+}
+
+static void
+BenchmarkTimestep(std::vector<ArrayBenchmark>* benchmarks, const LinkList* links, uint32_t numHits)
+{
+    for (auto& benchmark : *benchmarks)
+    {
+        for (const auto& link : *links)
+        {
+            Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel;
+            double missLatency = MeasureLatency([&benchmark, &link, &channel]() {
+                channel = benchmark.qdChannel->GetChannel(link.first,
+                                                          link.second,
+                                                          benchmark.aAntenna,
+                                                          benchmark.bAntenna);
+            });
+            benchmark.getChannelMiss.Add(missLatency);
+            uint64_t numMpcs = benchmark.qdChannel
+                                   ->GetChannelRays(link.first,
+                                                    link.second,
+                                                    benchmark.aAntenna,
+                                                    benchmark.bAntenna)
+                                   ->m_rayGain.size();
+            benchmark.getNewChannel[numMpcs].Add(missLatency);
+
+            for (uint32_t i = 0; i < numHits; i++)
+            {
+                benchmark.getChannelHit.Add(MeasureLatency([&benchmark, &link]() {
+                    benchmark.qdChannel->GetChannel(link.first,
+                                                    link.second,
+                                                    benchmark.aAntenna,
+                                                    benchmark.bAntenna);
+                }));
+            }
+
+            QdChannelModel::LinkHandle handle =
+                benchmark.qdChannel->ResolveLink(link.first,
+                                                 link.second,
+                                                 benchmark.aAntenna,
+                                                 benchmark.bAntenna);
+            for (uint32_t i = 0; i < numHits; i++)
+            {
+                benchmark.getHandleHit.Add(MeasureLatency(
+                    [&benchmark, &handle]() { benchmark.qdChannel->GetChannel(handle); }));
+            }
+
+            benchmark.svd.Add(
+                MeasureLatency([&channel]() { ComputeSvdBeamformingVectors(channel); }));
+            benchmark.svdMatrixFree.Add(
+                MeasureLatency([&channel]() { ComputeSvdBeamformingVectorsMatrixFree(channel); }));
+
+            // Spatial correlation matrix of the second dimension, as used by
+            // ComputeSvdBeamformingVectors
+            size_t numRows = channel->m_channel.GetNumRows();
+            size_t numCols = channel->m_channel.GetNumCols();
+            MatrixBasedChannelModel::Complex2DVector correlation(numCols, numCols);
+            for (size_t col1 = 0; col1 < numCols; col1++)
+            {
+                for (size_t col2 = 0; col2 < numCols; col2++)
+                {
+                    for (size_t row = 0; row < numRows; row++)
+                    {
+                        correlation(col1, col2) += std::conj(channel->m_channel(row, col1, 0)) *
+                                                   channel->m_channel(row, col2, 0);
+                    }
+                }
+            }
+            benchmark.firstEigenvector.Add(MeasureLatency(
+                [&correlation]() { GetFirstEigenvector(correlation, 30, 1e-8); }));
+        }
+    }
+}
+
+static uint64_t
+GetPeakRss()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // reported in bytes
+#else
+    return usage.ru_maxrss; // reported in kilobytes
+#endif
+}
+
+static std::string
+JsonString(const std::string& str)
+{
+    std::string escaped = "\"";
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped + "\"";
+}
@@ -53,6 +53,7 @@ Ptr<MobilityModel> rxMob;
 Ptr<PhasedArrayModel> txAntenna;
 Ptr<PhasedArrayModel> rxAntenna;
 Ptr<ThreeGppSpectrumPropagationLossModel> spectrumLossModel;
+SvdBeamformer beamformer; // reuses the beamforming vectors until the channel is regenerated
 
 /**
  * Perform the beamforming using the SVD beamforming method
@@ -138,6 +139,12 @@ main(int argc, char* argv[])
 
     Simulator::Stop(simTime);
     Simulator::Run();
+
+    NS_LOG_INFO("Beamforming vectors computed "
+                << beamformer.GetNumComputations() << " times in "
+                << beamformer.GetLatencyHistogram().GetTotal().GetSeconds() << " s, reused "
+                << beamformer.GetNumCacheHits() << " times");
+
     Simulator::Destroy();
     return 0;
 }
@@ -154,7 +161,7 @@ DoBeamforming(Ptr<NetDevice> txDevice,
     Ptr<const MatrixBasedChannelModel::ChannelMatrix> channelMatrix =
         qdChannel->GetChannel(thisMob, otherMob, txAntenna, rxAntenna);
 
-    auto bfVectors = ComputeSvdBeamformingVectors(channelMatrix);
+    auto bfVectors = beamformer.ComputeBeamformingVectors(channelMatrix);
 
     // store the antenna weights
     txAntenna->SetBeamformingVector(std::get<0>(bfVectors));
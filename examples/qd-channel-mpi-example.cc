@@ -0,0 +1,132 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2020 SIGNET Lab, Department of Information Engineering,
+ * University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * This program shows how to load a QD scenario in a distributed simulation, where
+ * each MPI rank only loads the channels involving the nodes it owns.
+ * Nodes are created on every rank, as required by the distributed simulator, and
+ * are assigned to the ranks in a round-robin fashion. Each rank then loads the
+ * scenario with the PartitionBySystemId attribute enabled, requests the channels
+ * of its local links, and prints the number of loaded node pairs and the memory
+ * used by the QD information, which decrease as the number of ranks increases.
+ *
+ * Run it with, e.g.,
+ * mpirun -np 4 ./ns3 run "qd-channel-mpi-example --scenario=Synthetic --qdFilesPath=/tmp/"
+ * after generating a large scenario with the qd-synthetic-scenario example.
+ */
+
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/core-module.h"
+#include "ns3/csv-reader.h"
+#include "ns3/mpi-interface.h"
+#include "ns3/node-container.h"
+#include "ns3/qd-channel-model.h"
+#include "ns3/uniform-planar-array.h"
+
+NS_LOG_COMPONENT_DEFINE("QdChannelMpiExample");
+
+using namespace ns3;
+
+int
+main(int argc, char* argv[])
+{
+    std::string qdFilesPath =
+        "contrib/qd-channel/model/QD/"; // The path of the folder with the QD scenarios
+    std::string scenario = "Indoor1";   // The name of the scenario
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("qdFilesPath", "The path of the folder with the QD scenarios", qdFilesPath);
+    cmd.AddValue("scenario", "The name of the scenario", scenario);
+    cmd.Parse(argc, argv);
+
+    GlobalValue::Bind("SimulatorImplementationType",
+                      StringValue("ns3::DistributedSimulatorImpl"));
+    MpiInterface::Enable(&argc, &argv);
+    uint32_t systemId = MpiInterface::GetSystemId();
+    uint32_t systemCount = MpiInterface::GetSize();
+
+    // Create one node for each position of the ray tracer, assigning them to the ranks
+    std::string posFileName =
+        qdFilesPath + "/" + scenario + "/Output/Ns3/NodesPosition/NodesPosition.csv";
+    NodeContainer nodes;
+    CsvReader csv(posFileName, ',');
+    while (csv.FetchNextRow())
+    {
+        if (csv.IsBlankRow())
+        {
+            continue;
+        }
+
+        double x, y, z;
+        bool ok = csv.GetValue(0, x);
+        ok |= csv.GetValue(1, y);
+        ok |= csv.GetValue(2, z);
+        NS_ABORT_MSG_IF(!ok, "Something went wrong while parsing the file: " << posFileName);
+
+        Ptr<Node> node = CreateObject<Node>(nodes.GetN() % systemCount);
+        Ptr<MobilityModel> mob = CreateObject<ConstantPositionMobilityModel>();
+        mob->SetPosition(Vector(x, y, z));
+        node->AggregateObject(mob);
+        nodes.Add(node);
+    }
+
+    // The partitioning must be configured before the scenario is loaded
+    Ptr<QdChannelModel> qdChannel = CreateObject<QdChannelModel>();
+    qdChannel->SetAttribute("PartitionBySystemId", BooleanValue(true));
+    qdChannel->SetPath(qdFilesPath);
+    qdChannel->SetScenario(scenario);
+
+    // Request the channels of the local links, i.e., with at least one local node
+    Ptr<PhasedArrayModel> aAntenna = CreateObject<UniformPlanarArray>();
+    Ptr<PhasedArrayModel> bAntenna = CreateObject<UniformPlanarArray>();
+    uint32_t numLocalLinks = 0;
+    for (uint32_t i = 0; i < nodes.GetN(); i++)
+    {
+        for (uint32_t j = i + 1; j < nodes.GetN(); j++)
+        {
+            if (nodes.Get(i)->GetSystemId() != systemId &&
+                nodes.Get(j)->GetSystemId() != systemId)
+            {
+                continue;
+            }
+            if (qdChannel->IsLinkAvailable(nodes.Get(i)->GetId(), nodes.Get(j)->GetId()))
+            {
+                qdChannel->GetChannel(nodes.Get(i)->GetObject<MobilityModel>(),
+                                      nodes.Get(j)->GetObject<MobilityModel>(),
+                                      aAntenna,
+                                      bAntenna);
+                numLocalLinks++;
+            }
+        }
+    }
+
+    const QdChannelModel::LoadReport& report = qdChannel->GetLoadReport();
+    std::cout << "Rank " << systemId << "/" << systemCount << ": "
+              << report.qdInfoBytesPerPair.size() << " node pairs loaded, "
+              << numLocalLinks << " local links, "
+              << report.qdInfoPayloadBytes + report.qdInfoContainerBytes +
+                     report.qdInfoOverheadBytes
+              << " bytes of QD information, loaded in "
+              << report.paraCfgTime + report.nodesPositionTime + report.qdFilesTime << " s"
+              << std::endl;
+
+    Simulator::Destroy();
+    MpiInterface::Disable();
+    return 0;
+}
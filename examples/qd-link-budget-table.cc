@@ -0,0 +1,321 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2020 SIGNET Lab, Department of Information Engineering,
+ * University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * This program computes offline a link-budget table for a QD scenario, without
+ * running the ns-3 event loop.
+ * The scenario is loaded once, then, for every link and every timestep, the
+ * channel is combined with analog SVD beamforming to obtain the path gain, the
+ * beamforming gain, the SNR, and the indices of the strongest rays.
+ * Links and timesteps are processed in parallel, and the results are written to
+ * a CSV file, with one row per link and timestep, which can be used by
+ * abstraction models without rerunning the channel.
+ * Each node is equipped with a uniform planar array of isotropic elements.
+ *
+ * The SNR is computed for a narrowband signal at the carrier frequency, with
+ * thermal noise over the given bandwidth.
+ */
+
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/core-module.h"
+#include "ns3/csv-reader.h"
+#include "ns3/node-container.h"
+#include "ns3/qd-channel-model.h"
+#include "ns3/qd-channel-utils.h"
+#include "ns3/uniform-planar-array.h"
+
+#include <fstream>
+#include <limits>
+#include <thread>
+
+NS_LOG_COMPONENT_DEFINE("QdLinkBudgetTable");
+
+using namespace ns3;
+
+/**
+ * Link budget of a link at a given timestep
+ */
+struct LinkBudget
+{
+    uint64_t timestep;      //!< the QD timestep
+    uint32_t aId;           //!< ID of the transmitting node
+    uint32_t bId;           //!< ID of the receiving node
+    uint64_t numRays;       //!< number of rays
+    double pathGainDb;      //!< channel gain without array gain [dB]
+    double bfGainDb;        //!< SVD beamforming gain [dB]
+    double snrDb;           //!< SNR [dB]
+    int64_t strongestRay;   //!< index of the strongest ray, -1 if none
+    int64_t strongestBfRay; //!< index of the strongest ray after beamforming, -1 if none
+};
+
+/**
+ * Compute the link budget of a link at a given timestep
+ *
+ * \param qdChannel the channel model, passed by reference to avoid reference counting
+ *        across threads
+ * \param aId ID of the transmitting node
+ * \param bId ID of the receiving node
+ * \param aAntenna antenna of the transmitting node, not shared with other threads
+ * \param bAntenna antenna of the receiving node, not shared with other threads
+ * \param timestep the QD timestep
+ * \param txPowDbm the transmit power [dBm]
+ * \param noisePowDbm the noise power [dBm]
+ * \return the link budget
+ */
+static LinkBudget ComputeLinkBudget(const QdChannelModel& qdChannel,
+                                    uint32_t aId,
+                                    uint32_t bId,
+                                    Ptr<const PhasedArrayModel> aAntenna,
+                                    Ptr<const PhasedArrayModel> bAntenna,
+                                    uint64_t timestep,
+                                    double txPowDbm,
+                                    double noisePowDbm);
+
+int
+main(int argc, char* argv[])
+{
+    std::string qdFilesPath =
+        "contrib/qd-channel/model/QD/"; // The path of the folder with the QD scenarios
+    std::string scenario = "Indoor1";   // The name of the scenario
+    std::string outputFile = "link-budget-table.csv"; // The output CSV file
+    uint32_t numRows = 2;            // Number of rows of the antenna arrays
+    uint32_t numColumns = 2;         // Number of columns of the antenna arrays
+    double txPow = 20.0;             // Tx power in dBm
+    double noiseFigure = 9.0;        // Noise figure in dB
+    double bandwidth = 400e6;        // Bandwidth in Hz
+    uint32_t numThreads = 0;         // Number of threads, 0 for all hardware threads
+    uint32_t timestepsPerTask = 64;  // Number of consecutive timesteps processed by each task
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("qdFilesPath", "The path of the folder with the QD scenarios", qdFilesPath);
+    cmd.AddValue("scenario", "The name of the scenario", scenario);
+    cmd.AddValue("outputFile", "The output CSV file", outputFile);
+    cmd.AddValue("numRows", "Number of rows of the antenna arrays", numRows);
+    cmd.AddValue("numColumns", "Number of columns of the antenna arrays", numColumns);
+    cmd.AddValue("txPow", "Tx power in dBm", txPow);
+    cmd.AddValue("noiseFigure", "Noise figure in dB", noiseFigure);
+    cmd.AddValue("bandwidth", "Bandwidth in Hz", bandwidth);
+    cmd.AddValue("numThreads", "Number of threads, 0 for all hardware threads", numThreads);
+    cmd.AddValue("timestepsPerTask",
+                 "Number of consecutive timesteps processed by each task",
+                 timestepsPerTask);
+    cmd.Parse(argc, argv);
+
+    NS_ABORT_MSG_IF(timestepsPerTask == 0, "timestepsPerTask must be positive");
+
+    // Create one node for each position of the ray tracer, so that RT and ns-3 IDs match
+    std::string posFileName =
+        qdFilesPath + "/" + scenario + "/Output/Ns3/NodesPosition/NodesPosition.csv";
+    NodeContainer nodes;
+    CsvReader csv(posFileName, ',');
+    while (csv.FetchNextRow())
+    {
+        if (csv.IsBlankRow())
+        {
+            continue;
+        }
+
+        double x, y, z;
+        bool ok = csv.GetValue(0, x);
+        ok |= csv.GetValue(1, y);
+        ok |= csv.GetValue(2, z);
+        NS_ABORT_MSG_IF(!ok, "Something went wrong while parsing the file: " << posFileName);
+
+        Ptr<Node> node = CreateObject<Node>();
+        Ptr<MobilityModel> mob = CreateObject<ConstantPositionMobilityModel>();
+        mob->SetPosition(Vector(x, y, z));
+        node->AggregateObject(mob);
+        nodes.Add(node);
+    }
+
+    // Load the scenario once
+    Ptr<QdChannelModel> qdChannel = CreateObject<QdChannelModel>(qdFilesPath, scenario);
+    uint32_t numTimesteps = qdChannel->GetNumTimesteps();
+    Time updatePeriod = qdChannel->GetUpdatePeriod();
+
+    std::vector<std::pair<uint32_t, uint32_t>> links;
+    for (uint32_t i = 0; i < nodes.GetN(); i++)
+    {
+        for (uint32_t j = i + 1; j < nodes.GetN(); j++)
+        {
+            uint32_t aId = nodes.Get(i)->GetId();
+            uint32_t bId = nodes.Get(j)->GetId();
+            if (qdChannel->IsLinkAvailable(aId, bId))
+            {
+                links.emplace_back(aId, bId);
+            }
+        }
+    }
+    NS_LOG_INFO(links.size() << " links, " << numTimesteps << " timesteps");
+
+    // Split the work in tasks made of consecutive timesteps of the same link, which are
+    // interleaved among the worker threads
+    uint32_t tasksPerLink = (numTimesteps + timestepsPerTask - 1) / timestepsPerTask;
+    uint32_t numTasks = links.size() * tasksPerLink;
+    if (numThreads == 0)
+    {
+        numThreads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    uint32_t numWorkers = std::max(1U, std::min(numThreads, numTasks));
+
+    // Each worker uses its own antenna objects for all its tasks, since reference counting
+    // is not thread safe. They are created here, as object creation is not thread safe either
+    auto createAntenna = [numRows, numColumns]() -> Ptr<PhasedArrayModel> {
+        return CreateObjectWithAttributes<UniformPlanarArray>("NumColumns",
+                                                              UintegerValue(numColumns),
+                                                              "NumRows",
+                                                              UintegerValue(numRows));
+    };
+    std::vector<std::pair<Ptr<PhasedArrayModel>, Ptr<PhasedArrayModel>>> antennas;
+    antennas.reserve(numWorkers);
+    for (uint32_t worker = 0; worker < numWorkers; worker++)
+    {
+        antennas.emplace_back(createAntenna(), createAntenna());
+    }
+
+    double noisePowDbm = -174 + 10 * log10(bandwidth) + noiseFigure;
+    std::vector<LinkBudget> table(links.size() * numTimesteps);
+    ParallelFor(numWorkers, numWorkers, [&](uint32_t worker) {
+        for (uint32_t task = worker; task < numTasks; task += numWorkers)
+        {
+            uint32_t linkIndex = task / tasksPerLink;
+            uint64_t firstTimestep = (uint64_t)(task % tasksPerLink) * timestepsPerTask;
+            uint64_t lastTimestep =
+                std::min<uint64_t>(firstTimestep + timestepsPerTask, numTimesteps);
+            for (uint64_t t = firstTimestep; t < lastTimestep; t++)
+            {
+                table[linkIndex * numTimesteps + t] = ComputeLinkBudget(*qdChannel,
+                                                                        links[linkIndex].first,
+                                                                        links[linkIndex].second,
+                                                                        antennas[worker].first,
+                                                                        antennas[worker].second,
+                                                                        t,
+                                                                        txPow,
+                                                                        noisePowDbm);
+            }
+        }
+    });
+
+    std::ofstream f;
+    f.open(outputFile, std::ios::out);
+    f << "timestep,time_s,txId,rxId,numRays,pathGain_dB,bfGain_dB,snr_dB,strongestRay,"
+         "strongestBfRay"
+      << std::endl;
+    for (const auto& row : table)
+    {
+        f << row.timestep << "," << (updatePeriod * row.timestep).GetSeconds() << "," << row.aId
+          << "," << row.bId << "," << row.numRays << "," << row.pathGainDb << "," << row.bfGainDb
+          << "," << row.snrDb << "," << row.strongestRay << "," << row.strongestBfRay << "\n";
+    }
+    f.close();
+    NS_LOG_INFO("Link-budget table written to " << outputFile);
+
+    Simulator::Destroy();
+    return 0;
+}
+
+/*  UTILITIES */
+static LinkBudget
+ComputeLinkBudget(const QdChannelModel& qdChannel,
+                  uint32_t aId,
+                  uint32_t bId,
+                  Ptr<const PhasedArrayModel> aAntenna,
+                  Ptr<const PhasedArrayModel> bAntenna,
+                  uint64_t timestep,
+                  double txPowDbm,
+                  double noisePowDbm)
+{
+    Ptr<const QdChannelModel::ChannelRays> rays =
+        qdChannel.GetChannelRays(aId, bId, aAntenna, bAntenna, timestep);
+    uint64_t numRays = rays->m_rayGain.size();
+
+    LinkBudget budget{timestep, aId, bId, numRays, 0, 0, 0, -1, -1};
+    if (numRays == 0)
+    {
+        budget.pathGainDb = -std::numeric_limits<double>::infinity();
+        budget.snrDb = -std::numeric_limits<double>::infinity();
+        return budget;
+    }
+
+    // Path gain and strongest ray, before beamforming
+    double pathGain = 0;
+    double strongestGain = 0;
+    for (uint64_t k = 0; k < numRays; k++)
+    {
+        double rayGain = std::norm(rays->m_rayGain[k]);
+        pathGain += rayGain;
+        if (rayGain > strongestGain)
+        {
+            strongestGain = rayGain;
+            budget.strongestRay = k;
+        }
+    }
+
+    // Narrowband channel, with the same layout as QdChannelModel::GetChannel
+    size_t aSize = rays->m_aSteering.GetNumRows();
+    size_t bSize = rays->m_bSteering.GetNumRows();
+    Ptr<MatrixBasedChannelModel::ChannelMatrix> channel =
+        Create<MatrixBasedChannelModel::ChannelMatrix>();
+    channel->m_channel = MatrixBasedChannelModel::Complex3DVector(bSize, aSize, 1);
+    for (uint64_t k = 0; k < numRays; k++)
+    {
+        for (size_t bIndex = 0; bIndex < bSize; bIndex++)
+        {
+            std::complex<double> bRay = rays->m_rayGain[k] * rays->m_bSteering(bIndex, k);
+            for (size_t aIndex = 0; aIndex < aSize; aIndex++)
+            {
+                channel->m_channel(bIndex, aIndex, 0) += bRay * rays->m_aSteering(aIndex, k);
+            }
+        }
+    }
+
+    auto bfVectors = ComputeSvdBeamformingVectorsMatrixFree(channel);
+    const PhasedArrayModel::ComplexVector& aW = bfVectors.first;
+    const PhasedArrayModel::ComplexVector& bW = bfVectors.second;
+
+    // Beamformed gain of each ray, and of the whole channel
+    std::complex<double> bfChannel(0, 0);
+    double strongestBfGain = 0;
+    for (uint64_t k = 0; k < numRays; k++)
+    {
+        std::complex<double> aResponse(0, 0);
+        for (size_t aIndex = 0; aIndex < aSize; aIndex++)
+        {
+            aResponse += aW[aIndex] * rays->m_aSteering(aIndex, k);
+        }
+        std::complex<double> bResponse(0, 0);
+        for (size_t bIndex = 0; bIndex < bSize; bIndex++)
+        {
+            bResponse += bW[bIndex] * rays->m_bSteering(bIndex, k);
+        }
+        std::complex<double> bfRay = rays->m_rayGain[k] * bResponse * aResponse;
+        bfChannel += bfRay;
+        if (std::norm(bfRay) > strongestBfGain)
+        {
+            strongestBfGain = std::norm(bfRay);
+            budget.strongestBfRay = k;
+        }
+    }
+
+    budget.pathGainDb = 10 * log10(pathGain);
+    budget.bfGainDb = 10 * log10(std::norm(bfChannel) / pathGain);
+    budget.snrDb = txPowDbm + 10 * log10(std::norm(bfChannel)) - noisePowDbm;
+
+    return budget;
+}
@@ -0,0 +1,80 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2020 SIGNET Lab, Department of Information Engineering,
+ * University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * This program writes a synthetic QD scenario, in the same format as the ray
+ * tracer, to stress test the loading and the channel generation of
+ * QdChannelModel with large numbers of nodes, MPCs, and timesteps.
+ * The number of MPCs of each link at each timestep is drawn from the given
+ * random variable, e.g., "ns3::UniformRandomVariable[Min=50|Max=150]", and the
+ * whole scenario is reproducible by fixing the seed.
+ * The generated scenario can then be used by the other examples, e.g.,
+ * ./ns3 run "qd-channel-benchmark --qdFilesPath=/tmp/ --scenario=Synthetic"
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/qd-scenario-generator.h"
+
+NS_LOG_COMPONENT_DEFINE("QdSyntheticScenario");
+
+using namespace ns3;
+
+int
+main(int argc, char* argv[])
+{
+    std::string qdFilesPath = "/tmp/";  // The path of the folder that will contain the scenario
+    std::string scenario = "Synthetic"; // The name of the scenario
+    uint32_t numNodes = 10;             // Number of nodes
+    uint32_t numTimesteps = 100;        // Number of timesteps
+    double totalTimeDuration = 1.0;     // Duration of the scenario in seconds
+    std::string numMpcs =
+        "ns3::UniformRandomVariable[Min=1|Max=10]"; // Number of MPCs of a link at a timestep
+    double linkProbability = 1.0; // Probability that the channel of a pair of nodes is written
+    uint32_t seed = 1;            // Seed of the random number generator
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("qdFilesPath",
+                 "The path of the folder that will contain the scenario",
+                 qdFilesPath);
+    cmd.AddValue("scenario", "The name of the scenario", scenario);
+    cmd.AddValue("numNodes", "Number of nodes", numNodes);
+    cmd.AddValue("numTimesteps", "Number of timesteps", numTimesteps);
+    cmd.AddValue("totalTimeDuration", "Duration of the scenario in seconds", totalTimeDuration);
+    cmd.AddValue("numMpcs", "Random variable for the number of MPCs of a link", numMpcs);
+    cmd.AddValue("linkProbability",
+                 "Probability that the channel of a pair of nodes is written",
+                 linkProbability);
+    cmd.AddValue("seed", "Seed of the random number generator", seed);
+    cmd.Parse(argc, argv);
+
+    RngSeedManager::SetSeed(seed);
+
+    Ptr<QdScenarioGenerator> generator = CreateObject<QdScenarioGenerator>();
+    generator->SetAttribute("NumNodes", UintegerValue(numNodes));
+    generator->SetAttribute("NumTimesteps", UintegerValue(numTimesteps));
+    generator->SetAttribute("TotalTimeDuration", TimeValue(Seconds(totalTimeDuration)));
+    generator->SetAttribute("NumMpcs", StringValue(numMpcs));
+    generator->SetAttribute("LinkProbability", DoubleValue(linkProbability));
+    generator->AssignStreams(0);
+    generator->Generate(qdFilesPath, scenario);
+
+    NS_LOG_INFO("Scenario written to " << qdFilesPath << "/" << scenario);
+
+    return 0;
+}
@@ -0,0 +1,402 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2020 SIGNET Lab, Department of Information Engineering,
+ * University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/qd-channel-cache.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/system-path.h"
+
+#include <cmath>
+#include <fcntl.h>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include <unistd.h>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("QdChannelCache");
+
+namespace
+{
+
+const uint32_t FILE_MAGIC = 0x51444346;   //!< "QDCF", start of a cache file
+const uint32_t RECORD_MAGIC = 0x51444352; //!< "QDCR", start of a record
+const uint32_t FORMAT_VERSION = 1;        //!< version of the file format
+
+/**
+ * Header of a cache file
+ */
+struct FileHeader
+{
+    uint32_t magic;        //!< FILE_MAGIC
+    uint32_t version;      //!< FORMAT_VERSION
+    uint64_t scenarioHash; //!< hash of the scenario
+};
+
+/**
+ * Header of a record, followed by the values of the stored pages of the channel matrix
+ */
+struct RecordHeader
+{
+    uint32_t magic;        //!< RECORD_MAGIC
+    uint32_t aNodeId;      //!< ns-3 ID of the a node
+    uint32_t bNodeId;      //!< ns-3 ID of the b node
+    uint32_t reserved;     //!< padding, always 0
+    uint64_t aAntennaHash; //!< hash of the antenna array of the a device
+    uint64_t bAntennaHash; //!< hash of the antenna array of the b device
+    uint64_t timestep;     //!< timestep of the channel
+    uint64_t numRows;      //!< number of rows of the matrix
+    uint64_t numCols;      //!< number of columns of the matrix
+    uint64_t numPages;     //!< number of pages of the matrix
+    uint64_t storedPages;  //!< number of pages stored, the following ones being zero
+};
+
+/**
+ * Get the name of the cache file of a scenario
+ *
+ * \param directory the cache directory
+ * \param scenarioHash the hash of the scenario
+ * \return the file name, including the directory
+ */
+std::string
+GetCacheFileName(const std::string& directory, uint64_t scenarioHash)
+{
+    std::ostringstream fileName;
+    fileName << directory << "/qd-channel-" << std::hex << std::setw(16) << std::setfill('0')
+             << scenarioHash << ".cache";
+    return fileName.str();
+}
+
+} // namespace
+
+std::shared_ptr<QdChannelCache>
+QdChannelCache::Open(const std::string& directory, uint64_t scenarioHash)
+{
+    NS_LOG_FUNCTION(directory << scenarioHash);
+
+    // the advisory locks belong to the process, thus the models of a process share the
+    // cache of each file, rather than locking it again
+    static std::mutex openCachesMutex;
+    static std::map<std::string, std::weak_ptr<QdChannelCache>> openCaches;
+
+    std::lock_guard<std::mutex> lock(openCachesMutex);
+    std::weak_ptr<QdChannelCache>& openCache =
+        openCaches[GetCacheFileName(directory, scenarioHash)];
+    std::shared_ptr<QdChannelCache> cache = openCache.lock();
+    if (!cache)
+    {
+        cache.reset(new QdChannelCache(directory, scenarioHash));
+        openCache = cache;
+    }
+    return cache;
+}
+
+QdChannelCache::QdChannelCache(const std::string& directory, uint64_t scenarioHash)
+{
+    NS_LOG_FUNCTION(this << directory << scenarioHash);
+
+    SystemPath::MakeDirectories(directory);
+    m_fileName = GetCacheFileName(directory, scenarioHash);
+
+    // only one process writes to the file, while the other ones read the records already
+    // complete, which are never modified
+    m_lockFd = ::open(m_fileName.c_str(), O_RDWR | O_CREAT, 0644);
+    m_readOnly = m_lockFd < 0 || lockf(m_lockFd, F_TLOCK, 0) != 0;
+    if (m_readOnly)
+    {
+        NS_LOG_WARN("Channel cache " << m_fileName
+                                     << " locked by another process, opening it read-only");
+    }
+
+    LoadIndex(scenarioHash);
+
+    std::ios::openmode mode = std::ios::in | std::ios::binary;
+    if (!m_readOnly)
+    {
+        mode |= std::ios::out | std::ios::app;
+    }
+    m_file.open(m_fileName, mode);
+    // a read-only cache may lack the file, e.g., in a read-only directory, thus be empty
+    NS_ABORT_MSG_IF(!m_file.is_open() && (!m_readOnly || !m_index.empty()),
+                    "Unable to open the channel cache " << m_fileName);
+
+    NS_LOG_INFO("Channel cache " << m_fileName << " contains " << m_index.size()
+                                 << " channel matrices");
+}
+
+QdChannelCache::~QdChannelCache()
+{
+    NS_LOG_FUNCTION(this);
+
+    m_file.close();
+    if (m_lockFd >= 0)
+    {
+        // also releases the lock
+        ::close(m_lockFd);
+    }
+}
+
+void
+QdChannelCache::LoadIndex(uint64_t scenarioHash)
+{
+    NS_LOG_FUNCTION(this << scenarioHash);
+
+    std::error_code error;
+    uint64_t fileSize = std::filesystem::file_size(m_fileName, error);
+    if (error)
+    {
+        fileSize = 0;
+    }
+
+    uint64_t validSize = 0;
+    std::ifstream in(m_fileName, std::ios::binary);
+    FileHeader fileHeader;
+    if (in.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader)) &&
+        fileHeader.magic == FILE_MAGIC && fileHeader.version == FORMAT_VERSION &&
+        fileHeader.scenarioHash == scenarioHash)
+    {
+        validSize = sizeof(fileHeader);
+        RecordHeader record;
+        while (in.read(reinterpret_cast<char*>(&record), sizeof(record)) &&
+               record.magic == RECORD_MAGIC)
+        {
+            uint64_t payload = record.numRows * record.numCols * record.storedPages *
+                               sizeof(std::complex<double>);
+            if (record.storedPages > record.numPages ||
+                validSize + sizeof(record) + payload > fileSize)
+            {
+                break;
+            }
+
+            Key key;
+            key.aAntennaHash = record.aAntennaHash;
+            key.bAntennaHash = record.bAntennaHash;
+            key.aNodeId = record.aNodeId;
+            key.bNodeId = record.bNodeId;
+            key.timestep = record.timestep;
+            Entry& entry = m_index[key];
+            entry.offset = validSize + sizeof(record);
+            entry.numRows = record.numRows;
+            entry.numCols = record.numCols;
+            entry.numPages = record.numPages;
+            entry.storedPages = record.storedPages;
+
+            validSize += sizeof(record) + payload;
+            in.seekg(validSize);
+        }
+    }
+    in.close();
+
+    if (m_readOnly)
+    {
+        // the file is handled by the process writing to it
+        NS_LOG_LOGIC("Indexed " << m_index.size() << " records of " << m_fileName);
+    }
+    else if (validSize == 0)
+    {
+        // new file, or written for another scenario or format version
+        NS_LOG_LOGIC("Creating the channel cache " << m_fileName);
+        std::ofstream out(m_fileName, std::ios::binary | std::ios::trunc);
+        NS_ABORT_MSG_IF(!out.is_open(), "Unable to write the channel cache " << m_fileName);
+        fileHeader.magic = FILE_MAGIC;
+        fileHeader.version = FORMAT_VERSION;
+        fileHeader.scenarioHash = scenarioHash;
+        out.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+    }
+    else if (validSize < fileSize)
+    {
+        // the last record was not completely written, e.g., by an interrupted run
+        NS_LOG_WARN("Discarding " << fileSize - validSize << " bytes at the end of "
+                                  << m_fileName);
+        std::filesystem::resize_file(m_fileName, validSize);
+    }
+}
+
+bool
+QdChannelCache::Read(const Key& key, MatrixBasedChannelModel::Complex3DVector& channel)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_index.find(key);
+    if (it == m_index.end())
+    {
+        return false;
+    }
+
+    const Entry& entry = it->second;
+    if (channel.GetNumRows() != entry.numRows || channel.GetNumCols() != entry.numCols ||
+        channel.GetNumPages() != entry.numPages)
+    {
+        channel = MatrixBasedChannelModel::Complex3DVector(entry.numRows,
+                                                           entry.numCols,
+                                                           entry.numPages);
+    }
+    else
+    {
+        // the pages which are not stored are zero
+        uint64_t pageSize = entry.numRows * entry.numCols;
+        for (uint64_t i = entry.storedPages * pageSize; i < channel.GetSize(); ++i)
+        {
+            channel[i] = std::complex<double>(0, 0);
+        }
+    }
+    if (entry.storedPages > 0)
+    {
+        m_file.seekg(entry.offset);
+        m_file.read(reinterpret_cast<char*>(&channel[0]),
+                    entry.numRows * entry.numCols * entry.storedPages *
+                        sizeof(std::complex<double>));
+    }
+    if (!m_file)
+    {
+        NS_LOG_WARN("Unable to read a channel matrix from " << m_fileName);
+        m_file.clear();
+        return false;
+    }
+    return true;
+}
+
+bool
+QdChannelCache::Write(const Key& key, const MatrixBasedChannelModel::Complex3DVector& channel)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_readOnly || m_index.count(key) != 0)
+    {
+        return false;
+    }
+
+    RecordHeader record;
+    record.magic = RECORD_MAGIC;
+    record.aNodeId = key.aNodeId;
+    record.bNodeId = key.bNodeId;
+    record.reserved = 0;
+    record.aAntennaHash = key.aAntennaHash;
+    record.bAntennaHash = key.bAntennaHash;
+    record.timestep = key.timestep;
+    record.numRows = channel.GetNumRows();
+    record.numCols = channel.GetNumCols();
+    record.numPages = channel.GetNumPages();
+
+    // trailing pages of zeros, e.g., the ones of the rays summed into the first page, are
+    // not stored
+    uint64_t pageSize = record.numRows * record.numCols;
+    record.storedPages = record.numPages;
+    while (record.storedPages > 0)
+    {
+        uint64_t pageStart = (record.storedPages - 1) * pageSize;
+        bool isZero = true;
+        for (uint64_t i = pageStart; i < pageStart + pageSize && isZero; ++i)
+        {
+            isZero = channel[i] == std::complex<double>(0, 0);
+        }
+        if (!isZero)
+        {
+            break;
+        }
+        --record.storedPages;
+    }
+
+    m_file.seekp(0, std::ios::end);
+    uint64_t offset = m_file.tellp();
+    m_file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    if (record.storedPages > 0)
+    {
+        m_file.write(reinterpret_cast<const char*>(&channel[0]),
+                     pageSize * record.storedPages * sizeof(std::complex<double>));
+    }
+    m_file.flush();
+    if (!m_file)
+    {
+        NS_LOG_WARN("Unable to write a channel matrix to " << m_fileName);
+        m_file.clear();
+        return false;
+    }
+
+    Entry& entry = m_index[key];
+    entry.offset = offset + sizeof(record);
+    entry.numRows = record.numRows;
+    entry.numCols = record.numCols;
+    entry.numPages = record.numPages;
+    entry.storedPages = record.storedPages;
+    return true;
+}
+
+uint64_t
+QdChannelCache::GetNumEntries() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_index.size();
+}
+
+std::string
+QdChannelCache::GetFileName() const
+{
+    return m_fileName;
+}
+
+bool
+QdChannelCache::IsReadOnly() const
+{
+    return m_readOnly;
+}
+
+uint64_t
+QdChannelCache::GetAntennaHash(const Ptr<const PhasedArrayModel>& antenna)
+{
+    uint64_t numElements = antenna->GetNumberOfElements();
+    uint64_t hash = Hash(&numElements, sizeof(numElements));
+    for (uint64_t eIndex = 0; eIndex < numElements; ++eIndex)
+    {
+        Vector loc = antenna->GetElementLocation(eIndex);
+        double coordinates[3] = {loc.x, loc.y, loc.z};
+        hash = Hash(coordinates, sizeof(coordinates), hash);
+    }
+
+    // the element pattern, including the orientation of the array, is sampled every 45
+    // degrees in azimuth and inclination
+    for (uint32_t azIndex = 0; azIndex < 8; ++azIndex)
+    {
+        for (uint32_t inclIndex = 0; inclIndex < 4; ++inclIndex)
+        {
+            Angles angles(-M_PI + azIndex * M_PI / 4, M_PI / 8 + inclIndex * M_PI / 4);
+            std::pair<double, double> pattern = antenna->GetElementFieldPattern(angles);
+            double values[2] = {pattern.first, pattern.second};
+            hash = Hash(values, sizeof(values), hash);
+        }
+    }
+    return hash;
+}
+
+uint64_t
+QdChannelCache::Hash(const void* data, size_t size, uint64_t hash)
+{
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+} // namespace ns3
@@ -0,0 +1,202 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2020 SIGNET Lab, Department of Information Engineering,
+ * University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef QD_CHANNEL_CACHE_H
+#define QD_CHANNEL_CACHE_H
+
+#include "ns3/matrix-based-channel-model.h"
+#include "ns3/phased-array-model.h"
+
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+namespace ns3
+{
+
+/**
+ * \ingroup spectrum
+ *
+ * Persistent cache of the channel matrices generated by QdChannelModel, shared by
+ * consecutive runs of the same scenario.
+ * Each scenario is stored in a separate append-only file, named after a hash of the
+ * loaded QD information, so that a change of the traces, of the loaded window, or of the
+ * node mapping selects a different file. Each record is indexed by the hashes of the
+ * geometry and of the element pattern of the two antenna arrays, by the node IDs of the
+ * link, and by the timestep, and trailing pages of zeros are not stored.
+ * When the cache is opened, the records are indexed without reading the matrices, which
+ * are read back only when requested.
+ *
+ * Records of an interrupted run, or of a different format version, are discarded.
+ * The files use the native byte order. Simultaneous runs can share the cache directory:
+ * the models of a process share the cache of each file, and only the process holding
+ * an advisory lock (lockf) of the file writes to it, while the other ones open it
+ * read-only, reading the records complete when opened.
+ */
+class QdChannelCache
+{
+  public:
+    /**
+     * Key of a cached channel matrix
+     */
+    struct Key
+    {
+        uint64_t aAntennaHash{0}; //!< hash of the antenna array of the a device
+        uint64_t bAntennaHash{0}; //!< hash of the antenna array of the b device
+        uint32_t aNodeId{0};      //!< ns-3 ID of the a node
+        uint32_t bNodeId{0};      //!< ns-3 ID of the b node
+        uint64_t timestep{0};     //!< timestep of the channel
+
+        /**
+         * Strict ordering, for indexing
+         *
+         * \param other the other key
+         * \return true if this key comes before the other one
+         */
+        bool operator<(const Key& other) const
+        {
+            return std::tie(aAntennaHash, bAntennaHash, aNodeId, bNodeId, timestep) <
+                   std::tie(other.aAntennaHash,
+                            other.bAntennaHash,
+                            other.aNodeId,
+                            other.bNodeId,
+                            other.timestep);
+        }
+    };
+
+    /**
+     * Get the cache of a scenario, shared with the other models of the process using
+     * the same file, opening it if needed
+     *
+     * \param directory the cache directory
+     * \param scenarioHash the hash of the loaded scenario
+     * \return the cache
+     */
+    static std::shared_ptr<QdChannelCache> Open(const std::string& directory,
+                                                uint64_t scenarioHash);
+
+    /**
+     * Close the cache file, releasing its lock
+     */
+    ~QdChannelCache();
+
+    /**
+     * Read a channel matrix from the cache
+     *
+     * \param key the key of the channel
+     * \param [in,out] channel the channel matrix, whose buffer is reused if it has the
+     *        same dimensions as the cached one; it may be modified also if the read fails
+     * \return true if the channel was found
+     */
+    bool Read(const Key& key, MatrixBasedChannelModel::Complex3DVector& channel);
+
+    /**
+     * Append a channel matrix to the cache, unless already present
+     *
+     * \param key the key of the channel
+     * \param channel the channel matrix
+     * \return true if the channel was written, i.e., not already present and the cache
+     *         is not read-only
+     */
+    bool Write(const Key& key, const MatrixBasedChannelModel::Complex3DVector& channel);
+
+    /**
+     * Get the number of channel matrices in the cache
+     *
+     * \return the number of channel matrices
+     */
+    uint64_t GetNumEntries() const;
+
+    /**
+     * Get the name of the cache file
+     *
+     * \return the file name, including the directory
+     */
+    std::string GetFileName() const;
+
+    /**
+     * Check whether the cache is read-only, as its file is locked by another process
+     *
+     * \return true if the cache is read-only
+     */
+    bool IsReadOnly() const;
+
+    /**
+     * Compute the hash of an antenna array, covering the number of elements, their
+     * locations, and the element field pattern sampled over a grid of directions, i.e.,
+     * everything affecting the channel matrix but the identity of the object
+     *
+     * \param antenna the antenna array
+     * \return the hash
+     */
+    static uint64_t GetAntennaHash(const Ptr<const PhasedArrayModel>& antenna);
+
+    /**
+     * Update a 64-bit FNV-1a hash with a block of bytes
+     *
+     * \param data the bytes
+     * \param size the number of bytes
+     * \param hash the hash of the previous blocks, or the default value for the first one
+     * \return the updated hash
+     */
+    static uint64_t Hash(const void* data, size_t size, uint64_t hash = 14695981039346656037ULL);
+
+  private:
+    /**
+     * Open the cache file of a scenario, creating the directory and the file if needed,
+     * and locking the file, or opening it read-only if locked by another process
+     *
+     * \param directory the cache directory
+     * \param scenarioHash the hash of the loaded scenario
+     */
+    QdChannelCache(const std::string& directory, uint64_t scenarioHash);
+
+    /**
+     * Index the records of the cache file, discarding the file if it does not match the
+     * scenario and the incomplete records at its end, unless read-only
+     *
+     * \param scenarioHash the hash of the loaded scenario
+     */
+    void LoadIndex(uint64_t scenarioHash);
+
+    /**
+     * Location and dimensions of a cached channel matrix in the file
+     */
+    struct Entry
+    {
+        uint64_t offset{0};      //!< offset of the matrix values in the file [bytes]
+        uint64_t numRows{0};     //!< number of rows of the matrix
+        uint64_t numCols{0};     //!< number of columns of the matrix
+        uint64_t numPages{0};    //!< number of pages of the matrix
+        uint64_t storedPages{0}; //!< number of pages stored, the following ones being zero
+    };
+
+    std::string m_fileName;       //!< the cache file, including the directory
+    std::fstream m_file;          //!< the cache file, open for reading and appending
+    int m_lockFd{-1};             //!< descriptor of the cache file holding its lock, if any
+    bool m_readOnly{false};       //!< whether the file is locked by another process
+    std::map<Key, Entry> m_index; //!< location of each cached channel in the file
+    mutable std::mutex m_mutex;   //!< serializes the accesses to the file and the index
+};
+
+} // namespace ns3
+
+#endif /* QD_CHANNEL_CACHE_H */
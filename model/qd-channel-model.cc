@@ -28,12 +28,16 @@
 #include "ns3/net-device.h"
 #include "ns3/node.h"
 #include "ns3/string.h"
+#include "ns3/uinteger.h"
 #include <ns3/node-list.h>
 #include <ns3/simulator.h>
 
 #include <algorithm>
+#include <array>
+#include <chrono>
 #include <fstream>
 #include <glob.h>
+#include <limits>
 #include <random>
 #include <sstream>
 
@@ -44,7 +48,599 @@ NS_LOG_COMPONENT_DEFINE("QdChannelModel");
 
 NS_OBJECT_ENSURE_REGISTERED(QdChannelModel);
 
+void
+QdLatencyHistogram::Add(Time latency)
+{
+    int64_t ns = latency.GetNanoSeconds();
+    uint32_t bin = 0;
+    while (ns > 1 && bin < NUM_BINS - 1)
+    {
+        ns >>= 1;
+        bin++;
+    }
+
+    m_bins[bin]++;
+    m_count++;
+    m_total += latency;
+}
+
+uint64_t
+QdLatencyHistogram::GetCount() const
+{
+    return m_count;
+}
+
+uint64_t
+QdLatencyHistogram::GetBinCount(uint32_t bin) const
+{
+    NS_ABORT_MSG_IF(bin >= NUM_BINS, "Bin " << bin << " out of range");
+    return m_bins[bin];
+}
+
+Time
+QdLatencyHistogram::GetTotal() const
+{
+    return m_total;
+}
+
+void
+QdLatencyHistogram::Print(std::ostream& os) const
+{
+    for (uint32_t bin = 0; bin < NUM_BINS; bin++)
+    {
+        if (m_bins[bin] > 0)
+        {
+            os << "[" << (bin == 0 ? 0 : (uint64_t)1 << bin) << ", " << ((uint64_t)1 << (bin + 1))
+               << ") ns: " << m_bins[bin] << std::endl;
+        }
+    }
+}
+
+void
+QdLatencyHistogram::Merge(const QdLatencyHistogram& other)
+{
+    for (uint32_t bin = 0; bin < NUM_BINS; bin++)
+    {
+        m_bins[bin] += other.m_bins[bin];
+    }
+    m_count += other.m_count;
+    m_total += other.m_total;
+}
+
+void
+QdLatencyHistogram::Reset()
+{
+    m_bins.fill(0);
+    m_count = 0;
+    m_total = Time();
+}
+
+namespace
+{
+
+/// Minimum number of timesteps read from each QD file at each pass of the asynchronous
+/// loading
+const uint64_t ASYNC_LOADING_MIN_BLOCK = 10;
+
+/// Number of passes of the asynchronous loading over the QD files, for long traces
+const uint64_t ASYNC_LOADING_PASSES = 100;
+
+/// Last ID assigned to a realization of a channel matrix, by any QdChannelModel
+std::atomic<uint64_t> g_lastRealizationId{0};
+
+/**
+ * Geometry of an antenna array, i.e., the locations of its elements, normalized w.r.t. the
+ * wavelength.
+ * If the elements lie on a grid, as for UniformPlanarArray, the location of the element
+ * with index r * numColumns + c is origin + columnOffsets[c] + rowOffsets[r], and the
+ * steering vectors are the Kronecker product of a row and a column term
+ */
+struct ArrayGeometry
+{
+    std::vector<Vector> locs;          //!< the element locations
+    uint64_t numRows{0};               //!< number of rows of the grid, 0 if not a grid
+    uint64_t numColumns{0};            //!< number of columns of the grid, 0 if not a grid
+    Vector origin;                     //!< location of the first element of the grid
+    std::vector<Vector> columnOffsets; //!< offset of each column w.r.t. the origin
+    std::vector<Vector> rowOffsets;    //!< offset of each row w.r.t. the origin
+};
+
+/**
+ * Get the geometry of an antenna array, detecting whether its elements lie on a grid.
+ * The detection relies on the element locations only, thus it also covers rotated
+ * arrays, while arrays with a different geometry keep the generic element-wise steering
+ *
+ * \param antenna the antenna array
+ * \return the geometry of the array
+ */
+ArrayGeometry
+GetArrayGeometry(const Ptr<const PhasedArrayModel>& antenna)
+{
+    ArrayGeometry geometry;
+    std::vector<Vector>& locs = geometry.locs;
+    locs.resize(antenna->GetNumberOfElements());
+    for (uint64_t eIndex = 0; eIndex < locs.size(); ++eIndex)
+    {
+        locs[eIndex] = antenna->GetElementLocation(eIndex);
+    }
+    if (locs.size() < 4)
+    {
+        return geometry;
+    }
+
+    // the first row ends where the spacing between consecutive elements changes
+    const double tolerance = 1e-9;
+    auto isEqual = [tolerance](const Vector& u, const Vector& v) {
+        return std::abs(u.x - v.x) < tolerance && std::abs(u.y - v.y) < tolerance &&
+               std::abs(u.z - v.z) < tolerance;
+    };
+    Vector step = locs[1] - locs[0];
+    uint64_t numColumns = 2;
+    while (numColumns < locs.size() && isEqual(locs[numColumns] - locs[numColumns - 1], step))
+    {
+        ++numColumns;
+    }
+    uint64_t numRows = locs.size() / numColumns;
+    if (numRows < 2 || numRows * numColumns != locs.size())
+    {
+        return geometry;
+    }
+
+    std::vector<Vector> columnOffsets(numColumns);
+    std::vector<Vector> rowOffsets(numRows);
+    for (uint64_t c = 0; c < numColumns; ++c)
+    {
+        columnOffsets[c] = locs[c] - locs[0];
+    }
+    for (uint64_t r = 0; r < numRows; ++r)
+    {
+        rowOffsets[r] = locs[r * numColumns] - locs[0];
+    }
+    for (uint64_t r = 0; r < numRows; ++r)
+    {
+        for (uint64_t c = 0; c < numColumns; ++c)
+        {
+            if (!isEqual(locs[r * numColumns + c], locs[0] + rowOffsets[r] + columnOffsets[c]))
+            {
+                return geometry;
+            }
+        }
+    }
+
+    geometry.numRows = numRows;
+    geometry.numColumns = numColumns;
+    geometry.origin = locs[0];
+    geometry.columnOffsets = std::move(columnOffsets);
+    geometry.rowOffsets = std::move(rowOffsets);
+    return geometry;
+}
+
+/**
+ * Compute the steering vector of an antenna array towards a given direction.
+ * For arrays on a grid, only numRows + numColumns + 1 complex exponentials are computed,
+ * instead of one per element
+ *
+ * \param az the azimuth angle [rad]
+ * \param el the elevation angle [rad], measured as in the QD traces
+ * \param geometry the geometry of the array
+ * \param [out] steering the steering vector, with as many entries as the array elements
+ */
+void
+ComputeSteeringVector(double az,
+                      double el,
+                      const ArrayGeometry& geometry,
+                      std::complex<double>* steering)
+{
+    double sinEl = sin(el);
+    double cosEl = cos(el);
+    double cosAz = cos(az);
+    double sinAz = sin(az);
+    // the phase of each element is the projection of its location on the wave vector
+    Vector k(2 * M_PI * sinEl * cosAz, 2 * M_PI * sinEl * sinAz, 2 * M_PI * cosEl);
+    auto phase = [&k](const Vector& loc) { return k.x * loc.x + k.y * loc.y + k.z * loc.z; };
+
+    if (geometry.numRows == 0)
+    {
+        for (uint64_t eIndex = 0; eIndex < geometry.locs.size(); ++eIndex)
+        {
+            steering[eIndex] = std::polar(1.0, phase(geometry.locs[eIndex]));
+        }
+        return;
+    }
+
+    // the column terms are kept in the first row, which is thus scaled last
+    for (uint64_t c = 0; c < geometry.numColumns; ++c)
+    {
+        steering[c] = std::polar(1.0, phase(geometry.columnOffsets[c]));
+    }
+    std::complex<double> originTerm = std::polar(1.0, phase(geometry.origin));
+    for (uint64_t r = geometry.numRows; r-- > 0;)
+    {
+        std::complex<double> rowTerm = originTerm * std::polar(1.0, phase(geometry.rowOffsets[r]));
+        for (uint64_t c = 0; c < geometry.numColumns; ++c)
+        {
+            steering[r * geometry.numColumns + c] = rowTerm * steering[c];
+        }
+    }
+}
+
+/**
+ * Properties of an antenna array cached by a link, computed when first needed. The
+ * element locations and patterns are assumed not to change once an antenna has been used
+ * to generate a channel
+ */
+struct CachedAntenna
+{
+    bool valid{false};       //!< whether the entry holds an antenna
+    uint32_t antennaId{0};   //!< ID of the antenna
+    bool hasGeometry{false}; //!< whether the geometry has been computed
+    ArrayGeometry geometry;  //!< geometry of the antenna array
+    bool hasHash{false};     //!< whether the hash has been computed
+    uint64_t hash{0};        //!< hash of the antenna, see QdChannelCache::GetAntennaHash
+};
+
+/**
+ * Get the entry of an antenna array in the cache of a link, which holds its last two
+ * antennas, replacing the older one if not found
+ *
+ * \param cache the cached antennas of the link
+ * \param antenna the antenna array
+ * \param otherId ID of the other antenna of the link, whose entry is kept
+ * \return the entry of the antenna
+ */
+CachedAntenna&
+GetCachedAntenna(std::array<CachedAntenna, 2>& cache,
+                 const Ptr<const PhasedArrayModel>& antenna,
+                 uint32_t otherId)
+{
+    uint32_t antennaId = antenna->GetId();
+    for (auto& entry : cache)
+    {
+        if (entry.valid && entry.antennaId == antennaId)
+        {
+            return entry;
+        }
+    }
+    CachedAntenna& entry = cache[0].valid && cache[0].antennaId == otherId ? cache[1] : cache[0];
+    entry.valid = true;
+    entry.antennaId = antennaId;
+    entry.hasGeometry = false;
+    entry.hasHash = false;
+    return entry;
+}
+
+/**
+ * Get the geometry of an antenna array from the cache of a link
+ *
+ * \param cache the cached antennas of the link
+ * \param antenna the antenna array
+ * \param otherId ID of the other antenna of the link
+ * \return the geometry of the array
+ */
+const ArrayGeometry&
+GetCachedArrayGeometry(std::array<CachedAntenna, 2>& cache,
+                       const Ptr<const PhasedArrayModel>& antenna,
+                       uint32_t otherId)
+{
+    CachedAntenna& entry = GetCachedAntenna(cache, antenna, otherId);
+    if (!entry.hasGeometry)
+    {
+        entry.geometry = GetArrayGeometry(antenna);
+        entry.hasGeometry = true;
+    }
+    return entry.geometry;
+}
+
+/**
+ * Get the hash of an antenna array from the cache of a link, which samples its element
+ * pattern only once
+ *
+ * \param cache the cached antennas of the link
+ * \param antenna the antenna array
+ * \param otherId ID of the other antenna of the link
+ * \return the hash of the array
+ */
+uint64_t
+GetCachedAntennaHash(std::array<CachedAntenna, 2>& cache,
+                     const Ptr<const PhasedArrayModel>& antenna,
+                     uint32_t otherId)
+{
+    CachedAntenna& entry = GetCachedAntenna(cache, antenna, otherId);
+    if (!entry.hasHash)
+    {
+        entry.hash = QdChannelCache::GetAntennaHash(antenna);
+        entry.hasHash = true;
+    }
+    return entry.hash;
+}
+
+/**
+ * Ray decomposition of a channel, as QdChannelModel::ChannelRays, in buffers that keep
+ * their capacity when the number of rays changes
+ */
+struct RayBuffers
+{
+    uint64_t aSize{0};                           //!< number of elements of the a array
+    uint64_t bSize{0};                           //!< number of elements of the b array
+    std::vector<std::complex<double>> rayGain;   //!< complex gain of each ray
+    std::vector<std::complex<double>> aSteering; //!< steering vectors of a, one ray after another
+    std::vector<std::complex<double>> bSteering; //!< steering vectors of b, one ray after another
+};
+
+/**
+ * Sum the rays of a channel into a matrix of compile-time size NB x NA, keeping the scaled
+ * steering vectors of each ray in stack arrays, so that the loops can be unrolled and
+ * vectorized. Up to 256 entries, the matrix is also accumulated on the stack (4 KiB at most),
+ * while larger ones are accumulated directly into the channel matrix.
+ * Each entry accumulates the same products, in the same order, as the generic loop of
+ * QdChannelModel::GetNewChannel, thus the result is the same
+ *
+ * \param rays the ray decomposition of the channel, with NB and NA elements per array
+ * \param [out] H the channel matrix, whose first page is overwritten
+ */
+template <size_t NB, size_t NA>
+void
+SynthesizeFixedSizeChannel(const RayBuffers& rays, MatrixBasedChannelModel::Complex3DVector& H)
+{
+    constexpr bool onStack = NB * NA <= 256;
+    std::array<std::complex<double>, onStack ? NB * NA : 0> stackAcc{};
+    std::complex<double>* acc = onStack ? stackAcc.data() : &H[0];
+    if (!onStack)
+    {
+        std::fill(acc, acc + NB * NA, std::complex<double>(0.0, 0.0));
+    }
+
+    std::array<std::complex<double>, NB> bRays;
+    std::array<std::complex<double>, NA> aSteering;
+    for (size_t mpcIndex = 0; mpcIndex < rays.rayGain.size(); ++mpcIndex)
+    {
+        for (size_t bIndex = 0; bIndex < NB; ++bIndex)
+        {
+            bRays[bIndex] = rays.rayGain[mpcIndex] * rays.bSteering[mpcIndex * NB + bIndex];
+        }
+        for (size_t aIndex = 0; aIndex < NA; ++aIndex)
+        {
+            aSteering[aIndex] = rays.aSteering[mpcIndex * NA + aIndex];
+        }
+
+        // column-major, as the channel matrix
+        for (size_t aIndex = 0; aIndex < NA; ++aIndex)
+        {
+            for (size_t bIndex = 0; bIndex < NB; ++bIndex)
+            {
+                acc[aIndex * NB + bIndex] += bRays[bIndex] * aSteering[aIndex];
+            }
+        }
+    }
+    if (onStack)
+    {
+        std::copy(stackAcc.begin(), stackAcc.end(), &H[0]);
+    }
+}
+
+/**
+ * Sum the rays of a channel into its first page with the kernel specialized for NB
+ * elements of the b array and the number of elements of the a array, if available
+ *
+ * \param rays the ray decomposition of the channel, with NB elements in the b array
+ * \param [out] H the channel matrix
+ * \return true if a kernel is available for the size of the a array
+ */
+template <size_t NB>
+bool
+SynthesizeFixedSizeChannel(const RayBuffers& rays, MatrixBasedChannelModel::Complex3DVector& H)
+{
+    switch (rays.aSize)
+    {
+    case 1:
+        SynthesizeFixedSizeChannel<NB, 1>(rays, H);
+        return true;
+    case 4:
+        SynthesizeFixedSizeChannel<NB, 4>(rays, H);
+        return true;
+    case 16:
+        SynthesizeFixedSizeChannel<NB, 16>(rays, H);
+        return true;
+    case 64:
+        SynthesizeFixedSizeChannel<NB, 64>(rays, H);
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * Sum the rays of a channel into its first page with a kernel specialized for the size of
+ * the arrays, if available. Kernels are provided for any pair of arrays with 1, 4, 16, or 64
+ * elements each, i.e., 1x1, 2x2, 4x4, 8x8, and 16x4 arrays, as they only depend on the
+ * number of elements
+ *
+ * \param rays the ray decomposition of the channel
+ * \param [out] H the channel matrix
+ * \return true if a kernel is available for the size of the arrays
+ */
+bool
+SynthesizeFixedSizeChannel(const RayBuffers& rays, MatrixBasedChannelModel::Complex3DVector& H)
+{
+    if (rays.rayGain.empty())
+    {
+        return false;
+    }
+    switch (rays.bSize)
+    {
+    case 1:
+        return SynthesizeFixedSizeChannel<1>(rays, H);
+    case 4:
+        return SynthesizeFixedSizeChannel<4>(rays, H);
+    case 16:
+        return SynthesizeFixedSizeChannel<16>(rays, H);
+    case 64:
+        return SynthesizeFixedSizeChannel<64>(rays, H);
+    default:
+        return false;
+    }
+}
+
+/**
+ * Set a channel matrix to zero with the given dimensions, keeping its buffer if the
+ * dimensions are unchanged, e.g., when reusing the matrix of a retired channel. Otherwise,
+ * the matrix is reallocated, as its size cannot change in place, which is why the retired
+ * channels are pooled by number of pages as well
+ *
+ * \param [in,out] H the channel matrix
+ * \param numRows the number of rows
+ * \param numCols the number of columns
+ * \param numPages the number of pages
+ */
+void
+ResetChannelMatrix(MatrixBasedChannelModel::Complex3DVector& H,
+                   uint64_t numRows,
+                   uint64_t numCols,
+                   uint64_t numPages)
+{
+    if (H.GetNumRows() != numRows || H.GetNumCols() != numCols || H.GetNumPages() != numPages)
+    {
+        H = MatrixBasedChannelModel::Complex3DVector(numRows, numCols, numPages);
+        return;
+    }
+    for (size_t i = 0; i < H.GetSize(); ++i)
+    {
+        H[i] = std::complex<double>(0, 0);
+    }
+}
+
+/**
+ * Estimate the memory allocated on the heap for a block of the given size, assuming an
+ * allocator with 8-byte headers, 16-byte alignment, and 32-byte minimum blocks
+ *
+ * \param size the requested size [bytes]
+ * \return the allocated size [bytes]
+ */
+uint64_t
+GetHeapBlockSize(uint64_t size)
+{
+    if (size == 0)
+    {
+        return 0;
+    }
+    return std::max<uint64_t>(32, (size + 8 + 15) / 16 * 16);
+}
+
+/**
+ * Estimate the heap memory used by the elements of a vector, including the allocator
+ * overhead
+ *
+ * \param vector the vector
+ * \return the heap memory [bytes]
+ */
+template <class T>
+uint64_t
+GetVectorHeapSize(const std::vector<T>& vector)
+{
+    return GetHeapBlockSize(vector.capacity() * sizeof(T));
+}
+
+/**
+ * Get the size of a file
+ *
+ * \param fileName the file name
+ * \return the size of the file [bytes]
+ */
+uint64_t
+GetFileSize(const std::string& fileName)
+{
+    std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+    return file.is_open() ? (uint64_t)file.tellg() : 0;
+}
+
+/**
+ * Estimate the heap memory used by a channel matrix
+ *
+ * \param channelMatrix the channel matrix
+ * \return the heap memory [bytes]
+ */
+uint64_t
+GetChannelMatrixMemory(const MatrixBasedChannelModel::ChannelMatrix& channelMatrix)
+{
+    return GetHeapBlockSize(sizeof(MatrixBasedChannelModel::ChannelMatrix)) +
+           GetHeapBlockSize(channelMatrix.m_channel.GetSize() * sizeof(std::complex<double>));
+}
+
+/**
+ * Estimate the heap memory used by channel parameters
+ *
+ * \param channelParams the channel parameters
+ * \return the heap memory [bytes]
+ */
+uint64_t
+GetChannelParamsMemory(const MatrixBasedChannelModel::ChannelParams& channelParams)
+{
+    uint64_t bytes = GetHeapBlockSize(sizeof(MatrixBasedChannelModel::ChannelParams)) +
+                     GetVectorHeapSize(channelParams.m_alpha) +
+                     GetVectorHeapSize(channelParams.m_D) +
+                     GetVectorHeapSize(channelParams.m_delay) +
+                     GetVectorHeapSize(channelParams.m_angle) +
+                     GetVectorHeapSize(channelParams.m_cachedAngleSincos);
+    for (const auto& angles : channelParams.m_angle)
+    {
+        bytes += GetVectorHeapSize(angles);
+    }
+    return bytes;
+}
+
+/**
+ * Parse a comma-separated list of ray-tracer IDs
+ *
+ * \param list the list, e.g., "0,3,7"
+ * \return the set of IDs
+ */
+std::set<uint32_t>
+ParseRtIdList(const std::string& list)
+{
+    std::set<uint32_t> ids;
+    std::stringstream ss{list};
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (item.find_first_not_of(" \t") == std::string::npos)
+        {
+            continue;
+        }
+        NS_ABORT_MSG_IF(item.find_first_not_of(" \t0123456789") != std::string::npos,
+                        "Invalid ray-tracer ID \"" << item << "\" in the list \"" << list
+                                                   << "\"");
+        ids.insert(std::stoul(item));
+    }
+    return ids;
+}
+
+} // namespace
+
+/**
+ * Buffers reused by the regenerations of a link
+ */
+struct QdChannelModel::RegenerationScratch
+{
+    RayBuffers rays;                       //!< ray decomposition of the last channel
+    std::array<CachedAntenna, 2> antennas; //!< properties of the last two antennas
+};
+
 QdChannelModel::QdChannelModel(std::string path, std::string scenario)
+    : m_linkSlotsGeneration(0),
+      m_partitionBySystemId(false),
+      m_loadMatchedNodesOnly(false),
+      m_firstTimestep(0),
+      m_asyncLoading(false),
+      m_asyncLoadingOpenFiles(256),
+      m_cancelLoading(false),
+      m_loadedTimesteps(0),
+      m_loadingComplete(true),
+      m_paramsMisses(0),
+      m_simulationThreadId(std::this_thread::get_id()),
+      m_getChannelCallsTrace(0),
+      m_cacheHitsTrace(0),
+      m_regenerationsTrace(0),
+      m_paramsMissesTrace(0)
 {
     NS_LOG_FUNCTION(this);
 
@@ -55,6 +651,22 @@ QdChannelModel::QdChannelModel(std::string path, std::string scenario)
 QdChannelModel::~QdChannelModel()
 {
     NS_LOG_FUNCTION(this);
+
+    // the background loading, if any, uses this object, and stops after the file it is
+    // reading
+    m_cancelLoading = true;
+    if (m_preloadFuture.valid())
+    {
+        m_preloadFuture.wait();
+    }
+    if (m_asyncLoadingFuture.valid())
+    {
+        m_asyncLoadingFuture.wait();
+    }
+
+    m_scenarioSwitchEvent.Cancel();
+    m_statsDumpEvent.Cancel();
+    m_loadReportDumpEvent.Cancel();
 }
 
 TypeId
@@ -71,7 +683,142 @@ QdChannelModel::GetTypeId(void)
                 "only for compatibility with ns3::ThreeGppSpectrumPropagationLossModel.",
                 DoubleValue(__DBL_MIN__),
                 MakeDoubleAccessor(&QdChannelModel::SetFrequency, &QdChannelModel::GetFrequency),
-                MakeDoubleChecker<double>());
+                MakeDoubleChecker<double>())
+            .AddAttribute("PartitionBySystemId",
+                          "If true, only the channels with at least one node owned by this "
+                          "system, i.e., this MPI rank of a distributed simulation, are loaded. "
+                          "Requesting the channel between two remote nodes aborts the "
+                          "simulation. It must be set before the scenario is loaded, i.e., "
+                          "creating the model without a scenario and calling SetScenario "
+                          "afterwards.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&QdChannelModel::m_partitionBySystemId),
+                          MakeBooleanChecker())
+            .AddAttribute("LoadMatchedNodesOnly",
+                          "If true, the positions of the scenario that do not match any node "
+                          "are ignored, and only the channels between matched nodes are "
+                          "loaded, so that memory and loading time scale with the number of "
+                          "nodes actually used. Otherwise, every position must match a node. "
+                          "It must be set before the scenario is loaded.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&QdChannelModel::m_loadMatchedNodesOnly),
+                          MakeBooleanChecker())
+            .AddAttribute("LoadedRtIds",
+                          "Comma-separated list of the ray-tracer IDs of the nodes to load, "
+                          "e.g., \"0,3,7\". If not empty, only the positions with these IDs "
+                          "are matched to the nodes, and only the channels between them are "
+                          "loaded. It must be set before the scenario is loaded.",
+                          StringValue(""),
+                          MakeStringAccessor(&QdChannelModel::m_loadedRtIds),
+                          MakeStringChecker())
+            .AddAttribute("WindowStartOffset",
+                          "The time of the traces corresponding to the start of the scenario. "
+                          "The timesteps before it are skipped while loading, without parsing "
+                          "them, and the simulation time is mapped onto the window. "
+                          "It must be set before the scenario is loaded.",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&QdChannelModel::m_windowStartOffset),
+                          MakeTimeChecker(Seconds(0)))
+            .AddAttribute("WindowDuration",
+                          "The duration of the time window of the traces to load, starting "
+                          "from WindowStartOffset. The timesteps after the window are not read, "
+                          "so that loading time and memory are proportional to the simulated "
+                          "span. If zero, the traces are loaded until their end. It must be "
+                          "set before the scenario is loaded.",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&QdChannelModel::m_windowDuration),
+                          MakeTimeChecker(Seconds(0)))
+            .AddAttribute("AsyncLoading",
+                          "If true, only the configuration and the node positions are read "
+                          "when the scenario is loaded, while the QD files are read in a "
+                          "background thread, in timestep order. The channel of a timestep "
+                          "that has not been loaded yet waits for it, while GetLoadReport "
+                          "waits for the whole loading, and the persistent channel cache, if "
+                          "any, is used once all the files have been read. It must be set "
+                          "before the scenario is loaded.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&QdChannelModel::m_asyncLoading),
+                          MakeBooleanChecker())
+            .AddAttribute("AsyncLoadingOpenFiles",
+                          "The maximum number of QD files kept open by the asynchronous "
+                          "loading, which reads the files in blocks of timesteps; the other "
+                          "ones are reopened at each block.",
+                          UintegerValue(256),
+                          MakeUintegerAccessor(&QdChannelModel::m_asyncLoadingOpenFiles),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("ChannelCacheDirectory",
+                          "The directory of the persistent cache of the channel matrices. If "
+                          "not empty, the channel matrices are written to a file specific to "
+                          "the loaded scenario, and read back instead of being recomputed by "
+                          "later runs with the same scenario and antenna arrays. It must be "
+                          "set before the scenario is loaded.",
+                          StringValue(""),
+                          MakeStringAccessor(&QdChannelModel::m_channelCacheDirectory),
+                          MakeStringChecker())
+            .AddAttribute("PathGainThreshold",
+                          "The path gain [dB] below which the links are pruned, i.e., the "
+                          "links whose strongest ray at the current timestep is weaker than "
+                          "this threshold get an empty channel, without rays, instead of "
+                          "being synthesized, and results in a zero received PSD, see "
+                          "IsLinkPruned. The default value is below the path gain of any ray "
+                          "of the traces, i.e., no link is pruned.",
+                          DoubleValue(-1000.0),
+                          MakeDoubleAccessor(&QdChannelModel::m_pathGainThreshold),
+                          MakeDoubleChecker<double>())
+            .AddAttribute("ReuseChannelBuffers",
+                          "If true, a link is regenerated in the buffers of the channel it "
+                          "retired at its previous regeneration, or of a pooled channel with "
+                          "the same antenna dimensions, when no one else holds them, instead "
+                          "of allocating a new channel matrix and new parameters. The retired "
+                          "channels are not included in the memory reported by GetLoadReport.",
+                          BooleanValue(true),
+                          MakeBooleanAccessor(&QdChannelModel::m_reuseChannelBuffers),
+                          MakeBooleanChecker())
+            .AddAttribute("StatsFile",
+                          "The file where the runtime statistics are written at "
+                          "Simulator::Destroy. If empty, the statistics are not written.",
+                          StringValue(""),
+                          MakeStringAccessor(&QdChannelModel::SetStatsFile,
+                                             &QdChannelModel::GetStatsFile),
+                          MakeStringChecker())
+            .AddAttribute("LoadReportFile",
+                          "The file where the load report, including the peak memory of the "
+                          "cached channels, is written at Simulator::Destroy. If empty, the "
+                          "report is not written.",
+                          StringValue(""),
+                          MakeStringAccessor(&QdChannelModel::SetLoadReportFile,
+                                             &QdChannelModel::GetLoadReportFile),
+                          MakeStringChecker())
+            .AddTraceSource("GetChannelCalls",
+                            "The number of GetChannel calls of the thread running the "
+                            "simulation",
+                            MakeTraceSourceAccessor(&QdChannelModel::m_getChannelCallsTrace),
+                            "ns3::TracedValueCallback::Uint64")
+            .AddTraceSource("CacheHits",
+                            "The number of GetChannel calls of the thread running the "
+                            "simulation served by the cache",
+                            MakeTraceSourceAccessor(&QdChannelModel::m_cacheHitsTrace),
+                            "ns3::TracedValueCallback::Uint64")
+            .AddTraceSource("Regenerations",
+                            "The number of channel matrices generated by the thread running "
+                            "the simulation",
+                            MakeTraceSourceAccessor(&QdChannelModel::m_regenerationsTrace),
+                            "ns3::TracedValueCallback::Uint64")
+            .AddTraceSource("ParamsMisses",
+                            "The number of GetParams calls of the thread running the "
+                            "simulation not finding the channel parameters",
+                            MakeTraceSourceAccessor(&QdChannelModel::m_paramsMissesTrace),
+                            "ns3::TracedValueCallback::Uint64")
+            .AddTraceSource("ChannelRegenerated",
+                            "A channel matrix has been generated by the thread running the "
+                            "simulation",
+                            MakeTraceSourceAccessor(&QdChannelModel::m_channelRegeneratedTrace),
+                            "ns3::QdChannelModel::ChannelRegeneratedTracedCallback")
+            .AddTraceSource("BeamformingComputed",
+                            "Beamforming vectors have been computed by a beamformer attached to "
+                            "the model, in the thread running the simulation",
+                            MakeTraceSourceAccessor(&QdChannelModel::m_beamformingComputedTrace),
+                            "ns3::QdChannelModel::BeamformingComputedTracedCallback");
 
     return tid;
 }
@@ -123,14 +870,16 @@ QdChannelModel::ParseCsv(const std::string& str, bool toRad)
 }
 
 QdChannelModel::RtIdToNs3IdMap_t
-QdChannelModel::ReadNodesPosition()
+QdChannelModel::ReadNodesPosition(const std::string& folder, ScenarioData& data)
 {
-    NS_LOG_FUNCTION(this);
+    NS_LOG_FUNCTION(this << folder);
 
-    std::string posFileName{m_path + m_scenario + "Output/Ns3/NodesPosition/NodesPosition.csv"};
+    auto start = std::chrono::steady_clock::now();
+    std::string posFileName{folder + "Output/Ns3/NodesPosition/NodesPosition.csv"};
 
     uint32_t id{0};
     QdChannelModel::RtIdToNs3IdMap_t rtIdToNs3IdMap;
+    std::set<uint32_t> loadedRtIds = ParseRtIdList(m_loadedRtIds);
 
     CsvReader csv(posFileName, ',');
     while (csv.FetchNextRow())
@@ -151,7 +900,14 @@ QdChannelModel::ReadNodesPosition()
         Vector3D nodePosition{x, y, z};
 
         NS_LOG_DEBUG("Trying to match position from file: " << nodePosition);
-        m_nodePositionList.push_back(nodePosition);
+        data.nodePositionList.push_back(nodePosition);
+        if (!loadedRtIds.empty() && loadedRtIds.count(id) == 0)
+        {
+            NS_LOG_LOGIC("Skipping qdId=" << id << ", not in the LoadedRtIds list");
+            ++id;
+            continue;
+        }
+
         bool found{false};
         uint32_t matchedNodeId;
         for (NodeList::Iterator nit = NodeList::Begin(); nit != NodeList::End(); ++nit)
@@ -172,6 +928,13 @@ QdChannelModel::ReadNodesPosition()
                 }
             }
         }
+        if (!found && m_loadMatchedNodesOnly && loadedRtIds.empty())
+        {
+            NS_LOG_INFO("Position of qdId=" << id << " not matched, its channels are not loaded: "
+                                            << nodePosition);
+            ++id;
+            continue;
+        }
         if (!found)
         {
             NS_LOG_ERROR("Position not found: " << nodePosition);
@@ -182,29 +945,45 @@ QdChannelModel::ReadNodesPosition()
                         "the channel is created");
 
         rtIdToNs3IdMap.insert(std::make_pair(id, matchedNodeId));
-        m_ns3IdToRtIdMap.insert(std::make_pair(matchedNodeId, id));
+        data.ns3IdToRtIdMap.insert(std::make_pair(matchedNodeId, id));
 
         NS_LOG_INFO("qdId=" << id << " matches NodeId=" << matchedNodeId
                             << " with position=" << nodePosition);
+        if (NodeList::GetNode(matchedNodeId)->GetSystemId() == Simulator::GetSystemId())
+        {
+            data.localNodeIds.insert(matchedNodeId);
+        }
 
         ++id;
 
     } // while FetchNextRow
 
-    for (auto elem : m_nodePositionList)
+    for (auto elem : data.nodePositionList)
     {
         NS_LOG_INFO(elem);
     }
+    for (auto rtId : loadedRtIds)
+    {
+        NS_ABORT_MSG_IF(rtId >= id,
+                        "qdId=" << rtId << " in the LoadedRtIds list, but the scenario has only "
+                                << id << " nodes");
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    data.report.fileLoadTimes.emplace_back(posFileName, elapsed.count());
+    data.report.nodesPositionTime = elapsed.count();
+    data.report.nodesPositionBytes = GetFileSize(posFileName);
 
     return rtIdToNs3IdMap;
 }
 
 void
-QdChannelModel::ReadParaCfgFile()
+QdChannelModel::ReadParaCfgFile(const std::string& folder, ScenarioData& data)
 {
-    NS_LOG_FUNCTION(this);
+    NS_LOG_FUNCTION(this << folder);
 
-    std::string paraCfgCurrentFileName{m_path + m_scenario + "Input/paraCfgCurrent.txt"};
+    auto start = std::chrono::steady_clock::now();
+    std::string paraCfgCurrentFileName{folder + "Input/paraCfgCurrent.txt"};
     CsvReader csv(paraCfgCurrentFileName, '\t');
     csv.FetchNextRow(); // ignore first line (header)
 
@@ -225,51 +1004,82 @@ QdChannelModel::ReadParaCfgFile()
 
         if (varName.compare("numberOfTimeDivisions") == 0)
         {
-            m_totTimesteps = atoi(varValue.c_str());
-            NS_LOG_DEBUG("numberOfTimeDivisions (int) = " << m_totTimesteps);
+            data.totTimesteps = atoi(varValue.c_str());
+            NS_LOG_DEBUG("numberOfTimeDivisions (int) = " << data.totTimesteps);
         }
         else if (varName.compare("totalTimeDuration") == 0)
         {
-            m_totalTimeDuration = Seconds(atof(varValue.c_str()));
-            NS_LOG_DEBUG("m_totalTimeDuration = " << m_totalTimeDuration.GetSeconds() << " s");
+            data.totalTimeDuration = Seconds(atof(varValue.c_str()));
+            NS_LOG_DEBUG("totalTimeDuration = " << data.totalTimeDuration.GetSeconds() << " s");
         }
         else if (varName.compare("carrierFrequency") == 0)
         {
-            m_frequency = atof(varValue.c_str());
-            NS_LOG_DEBUG("carrierFrequency (float) = " << m_frequency);
+            data.frequency = atof(varValue.c_str());
+            NS_LOG_DEBUG("carrierFrequency (float) = " << data.frequency);
         }
 
     } // while FetchNextRow
+
+    // Setup simulation timings assuming constant periodicity
+    NS_ABORT_MSG_IF(data.totTimesteps == 0, "No timesteps in " << paraCfgCurrentFileName);
+    data.updatePeriod =
+        NanoSeconds((double)data.totalTimeDuration.GetNanoSeconds() / (double)data.totTimesteps);
+
+    // Restrict the traces to the time window to load
+    NS_ABORT_MSG_IF(m_windowStartOffset >= data.totalTimeDuration,
+                    "The window start offset " << m_windowStartOffset.GetSeconds()
+                                               << " s exceeds the duration of the traces "
+                                               << data.totalTimeDuration.GetSeconds() << " s");
+    uint64_t endTimestep = data.totTimesteps;
+    if (m_windowDuration.IsStrictlyPositive())
+    {
+        Time windowEnd = m_windowStartOffset + m_windowDuration;
+        // the timestep containing the end of the window is needed as well
+        endTimestep = std::min<uint64_t>(endTimestep,
+                                         windowEnd.GetNanoSeconds() /
+                                                 data.updatePeriod.GetNanoSeconds() +
+                                             1);
+    }
+    data.startOffset = m_windowStartOffset;
+    data.firstTimestep = m_windowStartOffset.GetNanoSeconds() / data.updatePeriod.GetNanoSeconds();
+    data.totTimesteps = endTimestep - data.firstTimestep;
+    data.totalTimeDuration = data.updatePeriod * data.totTimesteps;
+    NS_LOG_DEBUG("Loading timesteps [" << data.firstTimestep << ", " << endTimestep << ")");
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    data.report.fileLoadTimes.emplace_back(paraCfgCurrentFileName, elapsed.count());
+    data.report.paraCfgTime = elapsed.count();
+    data.report.paraCfgBytes = GetFileSize(paraCfgCurrentFileName);
 }
 
 void
-QdChannelModel::ReadQdFiles(QdChannelModel::RtIdToNs3IdMap_t rtIdToNs3IdMap)
+QdChannelModel::ReadQdFiles(const std::string& folder,
+                            const QdChannelModel::RtIdToNs3IdMap_t& rtIdToNs3IdMap,
+                            ScenarioData& data)
 {
-    NS_LOG_FUNCTION(this);
+    NS_LOG_FUNCTION(this << folder);
+
+    auto readStart = std::chrono::steady_clock::now();
 
     // QdFiles input
-    NS_LOG_INFO("m_path + m_scenario = " << m_path + m_scenario);
-    auto qdFileList = GetQdFilesList(m_path + m_scenario + "Output/Ns3/QdFiles/*");
+    auto qdFileList = GetQdFilesList(folder + "Output/Ns3/QdFiles/*");
     NS_LOG_DEBUG("qdFileList.size ()=" << qdFileList.size());
 
     for (auto fileName : qdFileList)
     {
-        // get the nodes IDs from the file name
-        int txIndex = fileName.find("Tx");
-        int rxIndex = fileName.find("Rx");
-        int txtIndex = fileName.find(".txt");
-
-        int len{rxIndex - txIndex - 2};
-        int id_tx{::atoi(fileName.substr(txIndex + 2, len).c_str())};
-        len = txtIndex - rxIndex - 2;
-        int id_rx{::atoi(fileName.substr(rxIndex + 2, len).c_str())};
-
-        NS_ABORT_MSG_IF(rtIdToNs3IdMap.find(id_tx) == rtIdToNs3IdMap.end(), "ID not found for TX!");
-        uint32_t nodeIdTx = rtIdToNs3IdMap.find(id_tx)->second;
-        NS_ABORT_MSG_IF(rtIdToNs3IdMap.find(id_rx) == rtIdToNs3IdMap.end(), "ID not found for RX!");
-        uint32_t nodeIdRx = rtIdToNs3IdMap.find(id_rx)->second;
+        if (m_cancelLoading)
+        {
+            NS_LOG_INFO("Loading of " << folder << " cancelled");
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
 
-        NS_LOG_DEBUG("id_tx: " << id_tx << ", id_rx: " << id_rx);
+        uint32_t nodeIdTx;
+        uint32_t nodeIdRx;
+        if (!GetQdFileNodes(fileName, rtIdToNs3IdMap, data, nodeIdTx, nodeIdRx))
+        {
+            continue;
+        }
 
         uint32_t key = GetKey(nodeIdTx, nodeIdRx);
         // std::pair<Ptr<const MobilityModel>, Ptr<const MobilityModel>> idPair
@@ -277,111 +1087,490 @@ QdChannelModel::ReadQdFiles(QdChannelModel::RtIdToNs3IdMap_t rtIdToNs3IdMap)
 
         std::ifstream qdFile{fileName.c_str()};
 
-        std::string line{};
         std::vector<QdInfo> qdInfoVector;
-
-        while (std::getline(qdFile, line))
+        qdInfoVector.reserve(data.totTimesteps);
+        uint64_t timestep{0};
+        uint64_t endTimestep{data.firstTimestep + data.totTimesteps};
+
+        QdInfo qdInfo{};
+        // timesteps before the window only need to be skipped, without parsing them
+        while (timestep < endTimestep &&
+               ReadQdInfo(qdFile, fileName, timestep, timestep >= data.firstTimestep, qdInfo))
         {
-            QdInfo qdInfo{};
-            // the file has a line with the number of multipath components
-            qdInfo.numMpcs = std::stoul(line, 0, 10);
-            NS_LOG_DEBUG("numMpcs " << qdInfo.numMpcs);
-
-            if (qdInfo.numMpcs > 0)
+            if (timestep >= data.firstTimestep)
             {
-                // a line with the delays
-                std::getline(qdFile, line);
-                auto pathDelays = ParseCsv(line);
-                NS_ABORT_MSG_IF(pathDelays.size() != qdInfo.numMpcs,
-                                "mismatch between number of path delays ("
-                                    << pathDelays.size() << ") and number of MPCs ("
-                                    << qdInfo.numMpcs << "), timestep=" << qdInfoVector.size() + 1
-                                    << ", fileName=" << fileName);
-                qdInfo.delay_s = pathDelays;
-                // a line with the path gains
-                std::getline(qdFile, line);
-                auto pathGains = ParseCsv(line);
-                NS_ABORT_MSG_IF(pathGains.size() != qdInfo.numMpcs,
-                                "mismatch between number of path gains ("
-                                    << pathGains.size() << ") and number of MPCs ("
-                                    << qdInfo.numMpcs << "), timestep=" << qdInfoVector.size() + 1
-                                    << ", fileName=" << fileName);
-                qdInfo.pathGain_dbpow = pathGains;
-                // a line with the path phases
-                std::getline(qdFile, line);
-                auto pathPhases = ParseCsv(line);
-                NS_ABORT_MSG_IF(pathPhases.size() != qdInfo.numMpcs,
-                                "mismatch between number of path phases ("
-                                    << pathPhases.size() << ") and number of MPCs ("
-                                    << qdInfo.numMpcs << "), timestep=" << qdInfoVector.size() + 1
-                                    << ", fileName=" << fileName);
-                qdInfo.phase_rad = pathPhases;
-                // a line with the elev AoD
-                std::getline(qdFile, line);
-                auto pathElevAod = ParseCsv(line, true);
-                NS_ABORT_MSG_IF(pathElevAod.size() != qdInfo.numMpcs,
-                                "mismatch between number of path elev AoDs ("
-                                    << pathElevAod.size() << ") and number of MPCs ("
-                                    << qdInfo.numMpcs << "), timestep=" << qdInfoVector.size() + 1
-                                    << ", fileName=" << fileName);
-                qdInfo.elAod_rad = pathElevAod;
-                // a line with the azimuth AoD
-                std::getline(qdFile, line);
-                auto pathAzAod = ParseCsv(line, true);
-                NS_ABORT_MSG_IF(pathAzAod.size() != qdInfo.numMpcs,
-                                "mismatch between number of path az AoDs ("
-                                    << pathAzAod.size() << ") and number of MPCs ("
-                                    << qdInfo.numMpcs << "), timestep=" << qdInfoVector.size() + 1
-                                    << ", fileName=" << fileName);
-                qdInfo.azAod_rad = pathAzAod;
-                // a line with the elev AoA
-                std::getline(qdFile, line);
-                auto pathElevAoa = ParseCsv(line, true);
-                NS_ABORT_MSG_IF(pathElevAoa.size() != qdInfo.numMpcs,
-                                "mismatch between number of path elev AoAs ("
-                                    << pathElevAoa.size() << ") and number of MPCs ("
-                                    << qdInfo.numMpcs << "), timestep=" << qdInfoVector.size() + 1
-                                    << ", fileName=" << fileName);
-                qdInfo.elAoa_rad = pathElevAoa;
-                // a line with the azimuth AoA
-                std::getline(qdFile, line);
-                auto pathAzAoa = ParseCsv(line, true);
-                NS_ABORT_MSG_IF(pathAzAoa.size() != qdInfo.numMpcs,
-                                "mismatch between number of path az AoAs ("
-                                    << pathAzAoa.size() << ") and number of MPCs ("
-                                    << qdInfo.numMpcs << "), timestep=" << qdInfoVector.size() + 1
-                                    << ", fileName=" << fileName);
-                qdInfo.azAoa_rad = pathAzAoa;
+                qdInfoVector.push_back(std::move(qdInfo));
             }
-            qdInfoVector.push_back(qdInfo);
+            qdInfo = QdInfo{};
+            ++timestep;
         }
         NS_LOG_DEBUG("qdInfoVector.size ()=" << qdInfoVector.size());
-        m_qdInfoMap.insert(std::make_pair(key, qdInfoVector));
+        auto inserted = data.qdInfoMap.insert(std::make_pair(key, qdInfoVector));
+        if (inserted.second)
+        {
+            AccountQdInfoMemory(nodeIdTx, nodeIdRx, inserted.first->second, data.report);
+        }
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        data.report.fileLoadTimes.emplace_back(fileName, elapsed.count());
+        data.report.qdFilesBytes += GetFileSize(fileName);
     }
 
-    NS_LOG_INFO("Imported files for " << m_qdInfoMap.size() << " tx/rx pairs");
+    AccountQdInfoMapMemory(data.qdInfoMap, data.report);
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - readStart;
+    data.report.qdFilesTime = elapsed.count();
+
+    NS_LOG_INFO("Imported files for " << data.qdInfoMap.size() << " tx/rx pairs");
 }
 
-void
-QdChannelModel::ReadAllInputFiles()
+bool
+QdChannelModel::GetQdFileNodes(const std::string& fileName,
+                               const RtIdToNs3IdMap_t& rtIdToNs3IdMap,
+                               const ScenarioData& data,
+                               uint32_t& nodeIdTx,
+                               uint32_t& nodeIdRx) const
+{
+    // get the nodes IDs from the file name
+    int txIndex = fileName.find("Tx");
+    int rxIndex = fileName.find("Rx");
+    int txtIndex = fileName.find(".txt");
+
+    int len{rxIndex - txIndex - 2};
+    int id_tx{::atoi(fileName.substr(txIndex + 2, len).c_str())};
+    len = txtIndex - rxIndex - 2;
+    int id_rx{::atoi(fileName.substr(rxIndex + 2, len).c_str())};
+
+    // when loading a subset of the nodes, only the channels between loaded nodes are needed
+    if ((m_loadMatchedNodesOnly || !m_loadedRtIds.empty()) &&
+        (rtIdToNs3IdMap.find(id_tx) == rtIdToNs3IdMap.end() ||
+         rtIdToNs3IdMap.find(id_rx) == rtIdToNs3IdMap.end()))
+    {
+        NS_LOG_LOGIC("Skipping the channel between qdIds " << id_tx << " and " << id_rx);
+        return false;
+    }
+
+    NS_ABORT_MSG_IF(rtIdToNs3IdMap.find(id_tx) == rtIdToNs3IdMap.end(), "ID not found for TX!");
+    nodeIdTx = rtIdToNs3IdMap.find(id_tx)->second;
+    NS_ABORT_MSG_IF(rtIdToNs3IdMap.find(id_rx) == rtIdToNs3IdMap.end(), "ID not found for RX!");
+    nodeIdRx = rtIdToNs3IdMap.find(id_rx)->second;
+
+    NS_LOG_DEBUG("id_tx: " << id_tx << ", id_rx: " << id_rx);
+
+    // with a distributed simulation, only the channels of the local nodes are needed
+    if (m_partitionBySystemId && data.localNodeIds.count(nodeIdTx) == 0 &&
+        data.localNodeIds.count(nodeIdRx) == 0)
+    {
+        NS_LOG_LOGIC("Skipping the channel between remote nodes " << nodeIdTx << " and "
+                                                                  << nodeIdRx);
+        return false;
+    }
+
+    return true;
+}
+
+bool
+QdChannelModel::ReadQdInfo(std::istream& qdFile,
+                           const std::string& fileName,
+                           uint64_t timestep,
+                           bool parse,
+                           QdInfo& qdInfo)
+{
+    std::string line{};
+    if (!std::getline(qdFile, line))
+    {
+        return false;
+    }
+
+    // the file has a line with the number of multipath components
+    qdInfo.numMpcs = std::stoul(line, 0, 10);
+    NS_LOG_DEBUG("numMpcs " << qdInfo.numMpcs);
+
+    if (!parse)
+    {
+        for (uint32_t i = 0; qdInfo.numMpcs > 0 && i < 7; i++)
+        {
+            qdFile.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        }
+        return true;
+    }
+
+    if (qdInfo.numMpcs > 0)
+    {
+        // a line with the delays
+        std::getline(qdFile, line);
+        auto pathDelays = ParseCsv(line);
+        NS_ABORT_MSG_IF(pathDelays.size() != qdInfo.numMpcs,
+                        "mismatch between number of path delays ("
+                            << pathDelays.size() << ") and number of MPCs ("
+                            << qdInfo.numMpcs << "), timestep=" << timestep + 1
+                            << ", fileName=" << fileName);
+        qdInfo.delay_s = pathDelays;
+        // a line with the path gains
+        std::getline(qdFile, line);
+        auto pathGains = ParseCsv(line);
+        NS_ABORT_MSG_IF(pathGains.size() != qdInfo.numMpcs,
+                        "mismatch between number of path gains ("
+                            << pathGains.size() << ") and number of MPCs ("
+                            << qdInfo.numMpcs << "), timestep=" << timestep + 1
+                            << ", fileName=" << fileName);
+        qdInfo.pathGain_dbpow = pathGains;
+        // a line with the path phases
+        std::getline(qdFile, line);
+        auto pathPhases = ParseCsv(line);
+        NS_ABORT_MSG_IF(pathPhases.size() != qdInfo.numMpcs,
+                        "mismatch between number of path phases ("
+                            << pathPhases.size() << ") and number of MPCs ("
+                            << qdInfo.numMpcs << "), timestep=" << timestep + 1
+                            << ", fileName=" << fileName);
+        qdInfo.phase_rad = pathPhases;
+        // a line with the elev AoD
+        std::getline(qdFile, line);
+        auto pathElevAod = ParseCsv(line, true);
+        NS_ABORT_MSG_IF(pathElevAod.size() != qdInfo.numMpcs,
+                        "mismatch between number of path elev AoDs ("
+                            << pathElevAod.size() << ") and number of MPCs ("
+                            << qdInfo.numMpcs << "), timestep=" << timestep + 1
+                            << ", fileName=" << fileName);
+        qdInfo.elAod_rad = pathElevAod;
+        // a line with the azimuth AoD
+        std::getline(qdFile, line);
+        auto pathAzAod = ParseCsv(line, true);
+        NS_ABORT_MSG_IF(pathAzAod.size() != qdInfo.numMpcs,
+                        "mismatch between number of path az AoDs ("
+                            << pathAzAod.size() << ") and number of MPCs ("
+                            << qdInfo.numMpcs << "), timestep=" << timestep + 1
+                            << ", fileName=" << fileName);
+        qdInfo.azAod_rad = pathAzAod;
+        // a line with the elev AoA
+        std::getline(qdFile, line);
+        auto pathElevAoa = ParseCsv(line, true);
+        NS_ABORT_MSG_IF(pathElevAoa.size() != qdInfo.numMpcs,
+                        "mismatch between number of path elev AoAs ("
+                            << pathElevAoa.size() << ") and number of MPCs ("
+                            << qdInfo.numMpcs << "), timestep=" << timestep + 1
+                            << ", fileName=" << fileName);
+        qdInfo.elAoa_rad = pathElevAoa;
+        // a line with the azimuth AoA
+        std::getline(qdFile, line);
+        auto pathAzAoa = ParseCsv(line, true);
+        NS_ABORT_MSG_IF(pathAzAoa.size() != qdInfo.numMpcs,
+                        "mismatch between number of path az AoAs ("
+                            << pathAzAoa.size() << ") and number of MPCs ("
+                            << qdInfo.numMpcs << "), timestep=" << timestep + 1
+                            << ", fileName=" << fileName);
+        qdInfo.azAoa_rad = pathAzAoa;
+    }
+    return true;
+}
+
+void
+QdChannelModel::AccountQdInfoMapMemory(const QdInfoMap_t& qdInfoMap, LoadReport& report)
+{
+    // the map nodes of the pairs
+    for (auto& pair : qdInfoMap)
+    {
+        uint64_t nodeBytes = sizeof(pair) + 4 * sizeof(void*); // color and links of the tree
+        report.qdInfoContainerBytes += nodeBytes;
+        report.qdInfoOverheadBytes += GetHeapBlockSize(nodeBytes) - nodeBytes;
+    }
+}
+
+void
+QdChannelModel::ReadAllInputFiles()
 {
     NS_LOG_FUNCTION(this);
     NS_LOG_INFO("ReadAllInputFiles for scenario " << m_scenario << " path " << m_path);
 
-    m_ns3IdToRtIdMap.clear();
-    m_qdInfoMap.clear();
+    // the files of the previous scenario may still be loading into the current map
+    WaitForLoadingCompletion();
+    if (m_asyncLoadingFuture.valid())
+    {
+        m_asyncLoadingFuture.get();
+    }
 
-    ReadParaCfgFile();
-    QdChannelModel::RtIdToNs3IdMap_t rtIdToNs3IdMap = ReadNodesPosition();
-    ReadQdFiles(rtIdToNs3IdMap);
+    std::string folder = m_path + m_scenario;
+    ScenarioData data;
+    ReadParaCfgFile(folder, data);
+    QdChannelModel::RtIdToNs3IdMap_t rtIdToNs3IdMap = ReadNodesPosition(folder, data);
+    if (m_asyncLoading)
+    {
+        StartAsyncLoading(folder, rtIdToNs3IdMap, data);
+        return;
+    }
+    ReadQdFiles(folder, rtIdToNs3IdMap, data);
 
-    // Setup simulation timings assuming constant periodicity
-    NS_ASSERT_MSG(m_totTimesteps == m_qdInfoMap.begin()->second.size(),
-                  "m_totTimesteps = " << m_totTimesteps << " != QdFiles size = "
-                                      << m_qdInfoMap.begin()->second.size());
+    InstallScenarioData(data, Seconds(0));
+}
+
+void
+QdChannelModel::StartAsyncLoading(const std::string& folder,
+                                  const RtIdToNs3IdMap_t& rtIdToNs3IdMap,
+                                  ScenarioData& data)
+{
+    NS_LOG_FUNCTION(this << folder);
+
+    // the links are known from the file names, and each of them gets an entry for every
+    // timestep, so that the map is never modified while the values are filled in
+    std::vector<AsyncQdFile> files;
+    for (const auto& fileName : GetQdFilesList(folder + "Output/Ns3/QdFiles/*"))
+    {
+        AsyncQdFile file;
+        if (!GetQdFileNodes(fileName, rtIdToNs3IdMap, data, file.nodeIdTx, file.nodeIdRx))
+        {
+            continue;
+        }
+        // as with the synchronous loading, the first file of each link is used
+        auto inserted = data.qdInfoMap.emplace(GetKey(file.nodeIdTx, file.nodeIdRx),
+                                               std::vector<QdInfo>(data.totTimesteps));
+        if (inserted.second)
+        {
+            file.fileName = fileName;
+            files.push_back(std::move(file));
+        }
+    }
+    NS_ABORT_MSG_IF(files.empty(), "No QD files to load in " << folder);
+
+    {
+        std::lock_guard<std::mutex> lock(m_loadingMutex);
+        m_loadingComplete = false;
+    }
+    InstallScenarioData(data, Seconds(0));
+    m_loadedTimesteps = 0;
+
+    // the vectors of the installed map do not move anymore
+    for (auto& file : files)
+    {
+        file.qdInfoVector = &m_qdInfoMap.at(GetKey(file.nodeIdTx, file.nodeIdRx));
+        file.slot = GetLinkSlot(file.nodeIdTx, file.nodeIdRx);
+    }
+
+    NS_LOG_INFO("Loading " << files.size() << " QD files in the background");
+    m_asyncLoadingFuture = std::async(std::launch::async,
+                                      &QdChannelModel::LoadQdFilesAsync,
+                                      this,
+                                      std::move(files),
+                                      m_firstTimestep);
+}
+
+void
+QdChannelModel::LoadQdFilesAsync(std::vector<AsyncQdFile> files, uint32_t firstTimestep)
+{
+    NS_LOG_FUNCTION(this << files.size() << firstTimestep);
+
+    auto readStart = std::chrono::steady_clock::now();
+    uint64_t endTimestep = firstTimestep + m_totTimesteps;
+    uint64_t blockSize = std::max(ASYNC_LOADING_MIN_BLOCK,
+                                  (endTimestep + ASYNC_LOADING_PASSES - 1) / ASYNC_LOADING_PASSES);
+
+    // the first files stay open for the whole loading, while the following ones are
+    // reopened at each pass where the previous one stopped, so that the number of open
+    // files stays bounded
+    for (size_t fileIndex = 0; fileIndex < std::min<size_t>(files.size(), m_asyncLoadingOpenFiles);
+         ++fileIndex)
+    {
+        files[fileIndex].stream = std::make_unique<std::ifstream>(files[fileIndex].fileName);
+        NS_ABORT_MSG_IF(!files[fileIndex].stream->is_open(),
+                        "Unable to open " << files[fileIndex].fileName);
+    }
+
+    for (uint64_t blockStart = 0; blockStart < endTimestep; blockStart += blockSize)
+    {
+        uint64_t blockEnd = std::min<uint64_t>(blockStart + blockSize, endTimestep);
+        for (auto& file : files)
+        {
+            if (m_cancelLoading)
+            {
+                NS_LOG_INFO("Loading of the QD files cancelled");
+                return;
+            }
+            if (file.position == std::streampos(-1))
+            {
+                continue; // the file has ended
+            }
+            auto start = std::chrono::steady_clock::now();
+
+            std::ifstream reopened;
+            std::ifstream* qdFile = file.stream.get();
+            if (!qdFile)
+            {
+                reopened.open(file.fileName);
+                NS_ABORT_MSG_IF(!reopened.is_open(), "Unable to open " << file.fileName);
+                reopened.seekg(file.position);
+                qdFile = &reopened;
+            }
+            for (uint64_t timestep = blockStart; timestep < blockEnd; ++timestep)
+            {
+                QdInfo qdInfo{};
+                bool parse = timestep >= firstTimestep;
+                if (!ReadQdInfo(*qdFile, file.fileName, timestep, parse, qdInfo))
+                {
+                    NS_LOG_WARN("The traces in " << file.fileName << " end at timestep "
+                                                 << timestep << ", the following ones have "
+                                                 << "no MPCs");
+                    break;
+                }
+                if (parse)
+                {
+                    (*file.qdInfoVector)[timestep - firstTimestep] = std::move(qdInfo);
+                }
+            }
+            if (!qdFile->good())
+            {
+                file.position = std::streampos(-1);
+                file.stream.reset();
+            }
+            else if (!file.stream)
+            {
+                file.position = qdFile->tellg();
+            }
+
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            file.loadTime += elapsed.count();
+
+            // the link can be used up to the end of the block, or entirely if its file has
+            // ended, before the other links are read
+            bool ended = file.position == std::streampos(-1);
+            if (file.slot != nullptr && (blockEnd > firstTimestep || ended))
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_loadingMutex);
+                    file.slot->loadedTimesteps.store(ended ? m_totTimesteps
+                                                           : blockEnd - firstTimestep,
+                                                     std::memory_order_release);
+                }
+                m_loadingCondition.notify_all();
+            }
+        }
+
+        if (blockEnd > firstTimestep)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_loadingMutex);
+                m_loadedTimesteps.store(blockEnd - firstTimestep, std::memory_order_release);
+            }
+            m_loadingCondition.notify_all();
+            NS_LOG_LOGIC("Loaded " << blockEnd - firstTimestep << " timesteps");
+        }
+    }
+
+    // the persistent cache of the channels is named after the loaded QD information
+    if (!m_channelCacheDirectory.empty())
+    {
+        std::atomic_store(&m_channelCache,
+                          QdChannelCache::Open(m_channelCacheDirectory, GetScenarioHash()));
+    }
+
+    {
+        std::lock_guard<std::mutex> statsLock(m_statsMutex);
+        for (const auto& file : files)
+        {
+            AccountQdInfoMemory(file.nodeIdTx,
+                                file.nodeIdRx,
+                                *file.qdInfoVector,
+                                m_loadReport);
+            m_loadReport.fileLoadTimes.emplace_back(file.fileName, file.loadTime);
+            m_loadReport.qdFilesBytes += GetFileSize(file.fileName);
+        }
+        AccountQdInfoMapMemory(m_qdInfoMap, m_loadReport);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - readStart;
+        m_loadReport.qdFilesTime = elapsed.count();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_loadingMutex);
+        m_loadingComplete = true;
+    }
+    m_loadingCondition.notify_all();
+    NS_LOG_INFO("Imported files for " << files.size() << " tx/rx pairs in the background");
+}
+
+void
+QdChannelModel::WaitForTimestep(const LinkSlot* slot, uint64_t timestep) const
+{
+    NS_LOG_FUNCTION(this << slot << timestep);
+
+    std::unique_lock<std::mutex> lock(m_loadingMutex);
+    m_loadingCondition.wait(lock, [this, slot, timestep]() {
+        return m_loadedTimesteps.load(std::memory_order_acquire) > timestep ||
+               (slot != nullptr &&
+                slot->loadedTimesteps.load(std::memory_order_acquire) > timestep);
+    });
+}
+
+void
+QdChannelModel::WaitForLoadingCompletion() const
+{
+    NS_LOG_FUNCTION(this);
+
+    std::unique_lock<std::mutex> lock(m_loadingMutex);
+    m_loadingCondition.wait(lock, [this]() { return m_loadingComplete; });
+}
+
+void
+QdChannelModel::InstallScenarioData(ScenarioData& data, Time startTime)
+{
+    NS_LOG_FUNCTION(this << startTime);
+
+    // a system or a subset of nodes may own no links, in which case an empty scenario is
+    // installed, and any channel request aborts
+    if (data.qdInfoMap.empty())
+    {
+        NS_LOG_WARN("No links loaded, the scenario is empty");
+    }
+    NS_ASSERT_MSG(data.qdInfoMap.empty() ||
+                      data.totTimesteps == data.qdInfoMap.begin()->second.size(),
+                  "m_totTimesteps = " << data.totTimesteps << " != QdFiles size = "
+                                      << data.qdInfoMap.begin()->second.size());
+
+    m_totTimesteps = data.totTimesteps;
+    m_totalTimeDuration = data.totalTimeDuration;
+    m_frequency = data.frequency;
+    m_nodePositionList = std::move(data.nodePositionList);
+    m_ns3IdToRtIdMap = std::move(data.ns3IdToRtIdMap);
+    m_localNodeIds = std::move(data.localNodeIds);
+    m_qdInfoMap = std::move(data.qdInfoMap);
+    m_loadReport = std::move(data.report);
+    m_scenarioStartTime = startTime;
+    m_firstTimestep = data.firstTimestep;
+    m_startOffset = data.startOffset;
+    m_updatePeriod = data.updatePeriod;
+
+    // the cached channels refer to the previous scenario, whose statistics are kept. The
+    // slots of the new links are created here, so that the map is not modified while the
+    // channels are requested
+    AddLinkStats(m_retiredLinkStats);
+    m_linkSlots.clear();
+    for (const auto& link : m_qdInfoMap)
+    {
+        m_linkSlots[link.first];
+    }
+    m_linkSlotsGeneration++;
+    {
+        std::lock_guard<std::mutex> poolLock(m_channelPoolMutex);
+        m_channelPool.clear();
+    }
+
+    // the aggregation lists of the nodes can only be accessed from the main thread
+    m_mobilityNodeIds.clear();
+    for (const auto& node : m_ns3IdToRtIdMap)
+    {
+        Ptr<MobilityModel> mm = NodeList::GetNode(node.first)->GetObject<MobilityModel>();
+        m_mobilityNodeIds[PeekPointer(mm)] = node.first;
+    }
+
+    m_loadedTimesteps = m_totTimesteps;
+
+    // with the asynchronous loading, the cache is opened once the QD files have been read,
+    // as its file is named after them
+    std::atomic_store(&m_channelCache, std::shared_ptr<QdChannelCache>());
+    std::lock_guard<std::mutex> lock(m_loadingMutex);
+    if (!m_channelCacheDirectory.empty() && m_loadingComplete)
+    {
+        std::atomic_store(&m_channelCache,
+                          QdChannelCache::Open(m_channelCacheDirectory, GetScenarioHash()));
+    }
 
-    m_updatePeriod =
-        NanoSeconds((double)m_totalTimeDuration.GetNanoSeconds() / (double)m_totTimesteps);
     NS_LOG_DEBUG("m_totalTimeDuration=" << m_totalTimeDuration.GetSeconds()
                                         << " s"
                                            ", m_updatePeriod="
@@ -391,11 +1580,423 @@ QdChannelModel::ReadAllInputFiles()
                                         << m_totTimesteps);
 }
 
-Time
-QdChannelModel::GetQdSimTime() const
+uint64_t
+QdChannelModel::GetScenarioHash() const
+{
+    NS_LOG_FUNCTION(this);
+
+    uint64_t hash = QdChannelCache::Hash(&m_frequency, sizeof(m_frequency));
+    for (const auto& node : m_ns3IdToRtIdMap)
+    {
+        uint32_t ids[2] = {node.first, node.second};
+        hash = QdChannelCache::Hash(ids, sizeof(ids), hash);
+    }
+    for (const auto& link : m_qdInfoMap)
+    {
+        hash = QdChannelCache::Hash(&link.first, sizeof(link.first), hash);
+        for (const auto& qdInfo : link.second)
+        {
+            hash = QdChannelCache::Hash(&qdInfo.numMpcs, sizeof(qdInfo.numMpcs), hash);
+            for (const std::vector<double>* values : {&qdInfo.delay_s,
+                                                      &qdInfo.pathGain_dbpow,
+                                                      &qdInfo.phase_rad,
+                                                      &qdInfo.elAod_rad,
+                                                      &qdInfo.azAod_rad,
+                                                      &qdInfo.elAoa_rad,
+                                                      &qdInfo.azAoa_rad})
+            {
+                hash = QdChannelCache::Hash(values->data(), values->size() * sizeof(double), hash);
+            }
+        }
+    }
+    return hash;
+}
+
+void
+QdChannelModel::PreloadScenario(std::string scenario, Time switchTime)
+{
+    NS_LOG_FUNCTION(this << scenario << switchTime);
+    NS_ABORT_MSG_IF(m_preloadedData, "A scenario is already being preloaded");
+    NS_ABORT_MSG_IF(switchTime < Simulator::Now(), "Cannot switch scenario in the past");
+    NS_ABORT_MSG_IF(scenario.empty() || m_path.empty(), "The path and scenario must be set");
+
+    TrimFolderName(scenario);
+    std::string folder = m_path + scenario;
+
+    m_preloadedScenario = scenario;
+    m_preloadedData = std::make_unique<ScenarioData>();
+
+    // the configuration is small and the nodes must be matched from the main thread
+    ReadParaCfgFile(folder, *m_preloadedData);
+    QdChannelModel::RtIdToNs3IdMap_t rtIdToNs3IdMap = ReadNodesPosition(folder, *m_preloadedData);
+
+    ScenarioData* data = m_preloadedData.get();
+    m_preloadFuture = std::async(std::launch::async, [this, folder, rtIdToNs3IdMap, data]() {
+        ReadQdFiles(folder, rtIdToNs3IdMap, *data);
+    });
+
+    m_scenarioSwitchEvent = Simulator::Schedule(switchTime - Simulator::Now(),
+                                                &QdChannelModel::SwitchToPreloadedScenario,
+                                                this);
+}
+
+void
+QdChannelModel::SwitchToPreloadedScenario()
+{
+    NS_LOG_FUNCTION(this);
+    NS_ASSERT_MSG(m_preloadedData, "No scenario has been preloaded");
+
+    // blocks only if the background loading is not over yet
+    m_preloadFuture.get();
+    WaitForLoadingCompletion();
+    if (m_asyncLoadingFuture.valid())
+    {
+        m_asyncLoadingFuture.get();
+    }
+
+    NS_LOG_INFO("Switching from scenario " << m_scenario << " to " << m_preloadedScenario);
+    m_scenario = m_preloadedScenario;
+    InstallScenarioData(*m_preloadedData, Simulator::Now());
+    m_preloadedData.reset();
+}
+
+Time
+QdChannelModel::GetQdSimTime() const
+{
+    NS_LOG_FUNCTION(this);
+    return m_totalTimeDuration;
+}
+
+uint32_t
+QdChannelModel::GetNumTimesteps() const
+{
+    NS_LOG_FUNCTION(this);
+    return m_totTimesteps;
+}
+
+Time
+QdChannelModel::GetUpdatePeriod() const
+{
+    NS_LOG_FUNCTION(this);
+    return m_updatePeriod;
+}
+
+const std::vector<std::pair<std::string, double>>&
+QdChannelModel::GetFileLoadTimes() const
+{
+    return m_loadReport.fileLoadTimes;
+}
+
+QdChannelModel::Stats
+QdChannelModel::GetStats() const
+{
+    Stats stats = m_retiredLinkStats;
+    stats.paramsMisses += m_paramsMisses.load();
+    AddLinkStats(stats);
+
+    std::lock_guard<std::mutex> beamformingLock(m_beamformingStatsMutex);
+    stats.beamformingComputations = m_beamformingStats.beamformingComputations;
+    stats.beamformingCacheHits = m_beamformingStats.beamformingCacheHits;
+    stats.beamformingLatency = m_beamformingStats.beamformingLatency;
+    return stats;
+}
+
+void
+QdChannelModel::AddLinkStats(Stats& stats) const
+{
+    for (auto& link : m_linkSlots)
+    {
+        LinkStats& linkStats = link.second.stats;
+        stats.getChannelCalls += linkStats.getChannelCalls.load(std::memory_order_relaxed);
+        stats.cacheHits += linkStats.cacheHits.load(std::memory_order_relaxed);
+        stats.beamformedRaysHits += linkStats.beamformedRaysHits.load(std::memory_order_relaxed);
+        stats.beamformedRaysMisses +=
+            linkStats.beamformedRaysMisses.load(std::memory_order_relaxed);
+        stats.prunedBeamformedRays +=
+            linkStats.prunedBeamformedRays.load(std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> regenerationLock(link.second.regenerationMutex);
+        stats.regenerations += linkStats.regenerations;
+        stats.diskCacheHits += linkStats.diskCacheHits;
+        stats.diskCacheWrites += linkStats.diskCacheWrites;
+        stats.prunedChannels += linkStats.prunedChannels;
+        stats.reusedChannels += linkStats.reusedChannels;
+        stats.pooledChannels += linkStats.pooledChannels;
+        stats.newChannelLatency.Merge(linkStats.newChannelLatency);
+        if (linkStats.regenerations > 0)
+        {
+            auto nodeIds = std::make_pair(std::min(linkStats.aNodeId, linkStats.bNodeId),
+                                          std::max(linkStats.aNodeId, linkStats.bNodeId));
+            stats.linkRegenerations[nodeIds] += linkStats.regenerations;
+        }
+    }
+}
+
+void
+QdChannelModel::PrintStats(std::ostream& os) const
+{
+    Stats stats = GetStats();
+    os << "GetChannel calls: " << stats.getChannelCalls << std::endl;
+    os << "Cache hits: " << stats.cacheHits << std::endl;
+    os << "Regenerations: " << stats.regenerations << std::endl;
+    os << "GetParams misses: " << stats.paramsMisses << std::endl;
+    os << "Beamformed gains cache hits: " << stats.beamformedRaysHits << std::endl;
+    os << "Beamformed gains cache misses: " << stats.beamformedRaysMisses << std::endl;
+    os << "Disk cache hits: " << stats.diskCacheHits << std::endl;
+    os << "Disk cache writes: " << stats.diskCacheWrites << std::endl;
+    os << "Pruned channels: " << stats.prunedChannels << std::endl;
+    os << "Pruned beamformed gains: " << stats.prunedBeamformedRays << std::endl;
+    os << "Channels in reused buffers: " << stats.reusedChannels << std::endl;
+    os << "Channels in pooled buffers: " << stats.pooledChannels << std::endl;
+    os << "GetNewChannel latency (total " << stats.newChannelLatency.GetTotal().GetSeconds()
+       << " s):" << std::endl;
+    stats.newChannelLatency.Print(os);
+    os << "Beamforming computations: " << stats.beamformingComputations << std::endl;
+    os << "Beamforming cache hits: " << stats.beamformingCacheHits << std::endl;
+    os << "Beamforming latency (total " << stats.beamformingLatency.GetTotal().GetSeconds()
+       << " s):" << std::endl;
+    stats.beamformingLatency.Print(os);
+    os << "Regenerations per link:" << std::endl;
+    for (const auto& link : stats.linkRegenerations)
+    {
+        os << link.first.first << "-" << link.first.second << ": " << link.second << std::endl;
+    }
+}
+
+void
+QdChannelModel::ResetStats()
+{
+    NS_LOG_FUNCTION(this);
+
+    m_retiredLinkStats = Stats();
+    m_paramsMisses = 0;
+    for (auto& link : m_linkSlots)
+    {
+        LinkStats& linkStats = link.second.stats;
+        linkStats.getChannelCalls = 0;
+        linkStats.cacheHits = 0;
+        linkStats.beamformedRaysHits = 0;
+        linkStats.beamformedRaysMisses = 0;
+        linkStats.prunedBeamformedRays = 0;
+
+        std::lock_guard<std::mutex> regenerationLock(link.second.regenerationMutex);
+        linkStats.regenerations = 0;
+        linkStats.diskCacheHits = 0;
+        linkStats.diskCacheWrites = 0;
+        linkStats.prunedChannels = 0;
+        linkStats.reusedChannels = 0;
+        linkStats.pooledChannels = 0;
+        linkStats.newChannelLatency.Reset();
+    }
+    m_getChannelCallsTrace = 0;
+    m_cacheHitsTrace = 0;
+    m_regenerationsTrace = 0;
+    m_paramsMissesTrace = 0;
+
+    std::lock_guard<std::mutex> beamformingLock(m_beamformingStatsMutex);
+    m_beamformingStats = Stats();
+}
+
+void
+QdChannelModel::NotifyBeamforming(bool cacheHit, Time latency)
+{
+    NS_LOG_FUNCTION(this << cacheHit << latency);
+
+    {
+        std::lock_guard<std::mutex> beamformingLock(m_beamformingStatsMutex);
+        if (cacheHit)
+        {
+            m_beamformingStats.beamformingCacheHits++;
+        }
+        else
+        {
+            m_beamformingStats.beamformingComputations++;
+            m_beamformingStats.beamformingLatency.Add(latency);
+        }
+    }
+
+    if (!cacheHit && IsSimulationThread())
+    {
+        m_beamformingComputedTrace(latency);
+    }
+}
+
+bool
+QdChannelModel::IsSimulationThread() const
+{
+    return std::this_thread::get_id() == m_simulationThreadId;
+}
+
+void
+QdChannelModel::SetStatsFile(std::string statsFile)
+{
+    NS_LOG_FUNCTION(this << statsFile);
+
+    m_statsFile = statsFile;
+    m_statsDumpEvent.Cancel();
+    if (!m_statsFile.empty())
+    {
+        m_statsDumpEvent = Simulator::ScheduleDestroy(&QdChannelModel::DumpStats, this);
+    }
+}
+
+std::string
+QdChannelModel::GetStatsFile() const
+{
+    return m_statsFile;
+}
+
+void
+QdChannelModel::DumpStats() const
+{
+    NS_LOG_FUNCTION(this);
+
+    std::ofstream f(m_statsFile);
+    NS_ABORT_MSG_IF(!f.is_open(), "Unable to write the statistics to " << m_statsFile);
+    PrintStats(f);
+}
+
+void
+QdChannelModel::AccountQdInfoMemory(uint32_t aNodeId,
+                                    uint32_t bNodeId,
+                                    const std::vector<QdInfo>& qdInfoVector,
+                                    LoadReport& report)
+{
+    uint64_t containerBytes = qdInfoVector.capacity() * sizeof(QdInfo);
+    uint64_t payloadBytes = 0;
+    uint64_t overheadBytes = GetHeapBlockSize(containerBytes) - containerBytes;
+    for (const auto& qdInfo : qdInfoVector)
+    {
+        for (const auto* values : {&qdInfo.delay_s,
+                                   &qdInfo.pathGain_dbpow,
+                                   &qdInfo.phase_rad,
+                                   &qdInfo.elAod_rad,
+                                   &qdInfo.azAod_rad,
+                                   &qdInfo.elAoa_rad,
+                                   &qdInfo.azAoa_rad})
+        {
+            payloadBytes += values->size() * sizeof(double);
+            overheadBytes += GetVectorHeapSize(*values) - values->size() * sizeof(double);
+        }
+        report.numMpcs += qdInfo.numMpcs;
+    }
+
+    report.numTimesteps += qdInfoVector.size();
+    report.qdInfoPayloadBytes += payloadBytes;
+    report.qdInfoContainerBytes += containerBytes;
+    report.qdInfoOverheadBytes += overheadBytes;
+    report.qdInfoBytesPerPair[std::make_pair(std::min(aNodeId, bNodeId),
+                                             std::max(aNodeId, bNodeId))] =
+        payloadBytes + containerBytes + overheadBytes;
+}
+
+void
+QdChannelModel::UpdateCacheMemory(uint64_t oldBytes,
+                                  uint64_t newBytes,
+                                  uint64_t& current,
+                                  uint64_t& peak)
+{
+    current += newBytes - oldBytes;
+    peak = std::max(peak, current);
+}
+
+const QdChannelModel::LoadReport&
+QdChannelModel::GetLoadReport() const
+{
+    // the QD files loaded in the background are accounted at the end
+    WaitForLoadingCompletion();
+    return m_loadReport;
+}
+
+void
+QdChannelModel::PrintLoadReport(std::ostream& os) const
+{
+    const LoadReport& report = GetLoadReport();
+    uint64_t qdInfoBytes =
+        report.qdInfoPayloadBytes + report.qdInfoContainerBytes + report.qdInfoOverheadBytes;
+
+    os << "Scenario: " << m_path << m_scenario << std::endl;
+    os << "ReadParaCfgFile: " << report.paraCfgTime << " s, " << report.paraCfgBytes << " bytes"
+       << std::endl;
+    os << "ReadNodesPosition: " << report.nodesPositionTime << " s, "
+       << report.nodesPositionBytes << " bytes" << std::endl;
+    os << "ReadQdFiles: " << report.qdFilesTime << " s, " << report.qdFilesBytes << " bytes"
+       << std::endl;
+    os << "QD information: " << qdInfoBytes << " bytes for " << report.qdInfoBytesPerPair.size()
+       << " pairs, " << report.numTimesteps << " timesteps, " << report.numMpcs << " MPCs"
+       << std::endl;
+    os << "  payload: " << report.qdInfoPayloadBytes << " bytes" << std::endl;
+    os << "  containers: " << report.qdInfoContainerBytes << " bytes" << std::endl;
+    os << "  allocator overhead: " << report.qdInfoOverheadBytes << " bytes" << std::endl;
+    if (report.numTimesteps > 0)
+    {
+        os << "  per pair and timestep: " << (double)qdInfoBytes / report.numTimesteps
+           << " bytes" << std::endl;
+    }
+    for (const auto& pair : report.qdInfoBytesPerPair)
+    {
+        os << "  pair " << pair.first.first << "-" << pair.first.second << ": " << pair.second
+           << " bytes" << std::endl;
+    }
+    os << "Channel matrices: " << report.channelMapBytes << " bytes, peak "
+       << report.peakChannelMapBytes << " bytes" << std::endl;
+    os << "Channel parameters: " << report.channelParamsMapBytes << " bytes, peak "
+       << report.peakChannelParamsMapBytes << " bytes" << std::endl;
+}
+
+void
+QdChannelModel::SetLoadReportFile(std::string loadReportFile)
+{
+    NS_LOG_FUNCTION(this << loadReportFile);
+
+    m_loadReportFile = loadReportFile;
+    m_loadReportDumpEvent.Cancel();
+    if (!m_loadReportFile.empty())
+    {
+        m_loadReportDumpEvent = Simulator::ScheduleDestroy(&QdChannelModel::DumpLoadReport, this);
+    }
+}
+
+std::string
+QdChannelModel::GetLoadReportFile() const
+{
+    return m_loadReportFile;
+}
+
+void
+QdChannelModel::DumpLoadReport() const
+{
+    NS_LOG_FUNCTION(this);
+
+    std::ofstream f(m_loadReportFile);
+    NS_ABORT_MSG_IF(!f.is_open(), "Unable to write the load report to " << m_loadReportFile);
+    PrintLoadReport(f);
+}
+
+bool
+QdChannelModel::IsLinkAvailable(uint32_t aNodeId, uint32_t bNodeId) const
 {
-    NS_LOG_FUNCTION(this);
-    return m_totalTimeDuration;
+    NS_LOG_FUNCTION(this << aNodeId << bNodeId);
+    return m_qdInfoMap.find(GetKey(aNodeId, bNodeId)) != m_qdInfoMap.end();
+}
+
+bool
+QdChannelModel::IsLinkPruned(Ptr<const MobilityModel> aMob, Ptr<const MobilityModel> bMob) const
+{
+    NS_LOG_FUNCTION(this << aMob << bMob);
+    return IsBelowPathGainThreshold(GetQdInfo(GetNodeId(aMob), GetNodeId(bMob), GetTimestep()));
+}
+
+bool
+QdChannelModel::IsBelowPathGainThreshold(const QdInfo& qdInfo) const
+{
+    if (qdInfo.numMpcs == 0)
+    {
+        return false;
+    }
+    double maxPathGain =
+        *std::max_element(qdInfo.pathGain_dbpow.begin(), qdInfo.pathGain_dbpow.end());
+    return maxPathGain < m_pathGainThreshold;
 }
 
 void
@@ -414,6 +2015,12 @@ QdChannelModel::GetFrequency() const
 void
 QdChannelModel::TrimFolderName(std::string& folder)
 {
+    // an empty name, e.g., of a model created without a scenario, is left empty
+    if (folder.empty())
+    {
+        return;
+    }
+
     // avoid starting with multiple '/'
     while (folder.front() == '/' && folder.substr(1, folder.size()).front() == '/')
     {
@@ -433,12 +2040,17 @@ void
 QdChannelModel::SetScenario(std::string scenario)
 {
     NS_LOG_FUNCTION(this << scenario);
+
+    // nothing to load, e.g., for a model created without a scenario, which is set afterwards
+    if (scenario.empty())
+    {
+        return;
+    }
     NS_ABORT_MSG_IF(m_path == "", "m_path empty, use SetPath first");
 
     TrimFolderName(scenario);
 
-    if (scenario != m_scenario // avoid re-reading input files
-        && scenario != "")
+    if (scenario != m_scenario) // avoid re-reading input files
     {
         m_scenario = scenario;
         // read the information for this scenario
@@ -469,33 +2081,14 @@ QdChannelModel::GetPath() const
 }
 
 bool
-QdChannelModel::ChannelMatrixNeedsUpdate(
-    Ptr<const MatrixBasedChannelModel::ChannelMatrix> channelMatrix) const
+QdChannelModel::ChannelMatrixNeedsUpdate(const LinkChannel& channel, uint64_t timestep) const
 {
-    NS_LOG_FUNCTION(this << channelMatrix);
-
-    uint64_t nowTimestep = GetTimestep();
-    uint64_t lastChanUpdateTimestep = GetTimestep(channelMatrix->m_generatedTime);
+    NS_LOG_FUNCTION(this << channel.timestep << timestep);
 
-    NS_ASSERT_MSG(nowTimestep >= lastChanUpdateTimestep,
-                  "Current timestep=" << nowTimestep << ", last channel update timestep="
-                                      << lastChanUpdateTimestep);
-
-    bool update = false;
-    // if the coherence time is over the channel has to be updated
-    if (lastChanUpdateTimestep < nowTimestep)
-    {
-        NS_LOG_LOGIC("Generation time " << channelMatrix->m_generatedTime.GetNanoSeconds()
-                                        << " now " << Simulator::Now().GetNanoSeconds()
-                                        << " update needed");
-        update = true;
-    }
-    else
-    {
-        NS_LOG_LOGIC("Generation time " << channelMatrix->m_generatedTime.GetNanoSeconds()
-                                        << " now " << Simulator::Now().GetNanoSeconds()
-                                        << " update not needed");
-    }
+    // with concurrent threads, the channel may have been generated by a thread ahead in time
+    bool update = channel.timestep != timestep;
+    NS_LOG_LOGIC("Generation timestep " << channel.timestep << " now " << timestep
+                                        << (update ? " update needed" : " update not needed"));
 
     return update;
 }
@@ -509,71 +2102,321 @@ QdChannelModel::GetChannel(Ptr<const MobilityModel> aMob,
     NS_LOG_FUNCTION(this << aMob << bMob << aAntenna << bAntenna);
 
     // Compute the channel keys
-    uint32_t aId = aMob->GetObject<Node>()->GetId();
-    uint32_t bId = bMob->GetObject<Node>()->GetId();
+    uint32_t aId = GetNodeId(aMob);
+    uint32_t bId = GetNodeId(bMob);
+
+    std::shared_ptr<const LinkChannel> channel =
+        GetLinkChannel(aId, bId, GetLinkSlot(aId, bId), aAntenna, bAntenna);
+    // the ns-3 pointer is not tracked by the shared ownership, see AcquireChannelBuffers
+    channel->lent.store(true, std::memory_order_relaxed);
+    return channel->matrix;
+}
+
+QdChannelModel::LinkHandle
+QdChannelModel::ResolveLink(Ptr<const MobilityModel> aMob,
+                            Ptr<const MobilityModel> bMob,
+                            Ptr<const PhasedArrayModel> aAntenna,
+                            Ptr<const PhasedArrayModel> bAntenna) const
+{
+    NS_LOG_FUNCTION(this << aMob << bMob << aAntenna << bAntenna);
 
+    LinkHandle handle;
+    handle.aNodeId = GetNodeId(aMob);
+    handle.bNodeId = GetNodeId(bMob);
+    handle.aAntenna = aAntenna;
+    handle.bAntenna = bAntenna;
+    handle.slot = GetLinkSlot(handle.aNodeId, handle.bNodeId);
+    handle.generation = m_linkSlotsGeneration;
+    return handle;
+}
+
+Ptr<const MatrixBasedChannelModel::ChannelMatrix>
+QdChannelModel::GetChannel(const LinkHandle& handle)
+{
+    NS_LOG_FUNCTION(this << handle.aNodeId << handle.bNodeId);
+
+    std::shared_ptr<const LinkChannel> channel = GetLinkChannel(handle.aNodeId,
+                                                                handle.bNodeId,
+                                                                GetLinkSlot(handle),
+                                                                handle.aAntenna,
+                                                                handle.bAntenna);
+    channel->lent.store(true, std::memory_order_relaxed);
+    return channel->matrix;
+}
+
+std::shared_ptr<const MatrixBasedChannelModel::ChannelMatrix>
+QdChannelModel::GetSharedChannel(const LinkHandle& handle)
+{
+    std::shared_ptr<const LinkChannel> channel = GetLinkChannel(handle.aNodeId,
+                                                                handle.bNodeId,
+                                                                GetLinkSlot(handle),
+                                                                handle.aAntenna,
+                                                                handle.bAntenna);
+    // the matrix is owned by the channel, which is shared with the caller
+    return std::shared_ptr<const MatrixBasedChannelModel::ChannelMatrix>(
+        channel,
+        PeekPointer(channel->matrix));
+}
+
+QdChannelModel::LinkSlot*
+QdChannelModel::GetLinkSlot(const LinkHandle& handle) const
+{
+    // the slots are rebuilt when the scenario changes, so that older handles are looked
+    // up again
+    return handle.generation == m_linkSlotsGeneration
+               ? handle.slot
+               : GetLinkSlot(handle.aNodeId, handle.bNodeId);
+}
+
+std::shared_ptr<const QdChannelModel::LinkChannel>
+QdChannelModel::GetLinkChannel(uint32_t aId,
+                               uint32_t bId,
+                               LinkSlot* slot,
+                               const Ptr<const PhasedArrayModel>& aAntenna,
+                               const Ptr<const PhasedArrayModel>& bAntenna)
+{
     uint32_t channelId = GetKey(aId, bId);
 
-    NS_LOG_DEBUG("channelId " << channelId << ", ns-3 aId=" << aId << " bId=" << bId
-                              << ", RT sim. aId=" << m_ns3IdToRtIdMap[aId]
-                              << " bId=" << m_ns3IdToRtIdMap[bId]);
+    NS_LOG_DEBUG("channelId " << channelId << ", ns-3 aId=" << aId << " bId=" << bId);
+
+    uint64_t timestep = GetTimestep();
+    if (slot == nullptr)
+    {
+        // GetQdInfo aborts explaining why the link is not loaded
+        GetQdInfo(aId, bId, timestep);
+    }
+    NS_ASSERT(slot != nullptr);
+
+    // the statistics are kept by each link, and only the thread running the simulation
+    // fires the traces, so that the sinks are never called concurrently
+    bool simulationThread = IsSimulationThread();
+    slot->stats.getChannelCalls.fetch_add(1, std::memory_order_relaxed);
+    if (simulationThread)
+    {
+        m_getChannelCallsTrace++;
+    }
 
-    // Check if the channel is present in the map and return it, otherwise
-    // generate a new channel
-    bool update = false;
-    bool notFound = false;
-    Ptr<MatrixBasedChannelModel::ChannelMatrix> channelMatrix;
-    if (m_channelMap.find(channelId) != m_channelMap.end())
+    // Check if the channel is present in the slot and return it, without locking
+    std::shared_ptr<const LinkChannel> channel = std::atomic_load(&slot->channel);
+    if (channel && !ChannelMatrixNeedsUpdate(*channel, timestep))
     {
-        // channel matrix present in the map
         NS_LOG_LOGIC("channel matrix present in the map");
-        channelMatrix = m_channelMap[channelId];
+        slot->stats.cacheHits.fetch_add(1, std::memory_order_relaxed);
+        if (simulationThread)
+        {
+            m_cacheHitsTrace++;
+        }
+        return channel;
+    }
+
+    // Otherwise generate a new channel. Only one thread regenerates the link, while the
+    // other ones requesting it wait and then find the new channel
+    std::shared_ptr<const LinkChannel> newChannel;
+    Time latency;
+    {
+        std::lock_guard<std::mutex> regenerationLock(slot->regenerationMutex);
+        channel = std::atomic_load(&slot->channel);
+        if (channel && !ChannelMatrixNeedsUpdate(*channel, timestep))
+        {
+            NS_LOG_LOGIC("channel matrix generated by another thread");
+            slot->stats.cacheHits.fetch_add(1, std::memory_order_relaxed);
+            if (simulationThread)
+            {
+                m_cacheHitsTrace++;
+            }
+            return channel;
+        }
 
-        // check if it has to be updated
-        update = ChannelMatrixNeedsUpdate(channelMatrix);
+        NS_LOG_LOGIC("channelMatrix notFound=" << !channel << " || update=" << (bool)channel);
+        auto start = std::chrono::steady_clock::now();
+        newChannel = GetNewChannel(aId, bId, aAntenna, bAntenna, timestep, *slot);
+        latency = NanoSeconds(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                  std::chrono::steady_clock::now() - start)
+                                  .count());
+
+        LinkStats& stats = slot->stats;
+        stats.aNodeId = aId;
+        stats.bNodeId = bId;
+        stats.regenerations++;
+        stats.newChannelLatency.Add(latency);
+
+        // the memory of the cached channels is shared by all the links, but it only changes
+        // when the dimensions of a channel do, e.g., not when its buffers are reused
+        uint64_t oldMatrixBytes = channel ? GetChannelMatrixMemory(*channel->matrix) : 0;
+        uint64_t newMatrixBytes = GetChannelMatrixMemory(*newChannel->matrix);
+        uint64_t oldParamsBytes = channel ? GetChannelParamsMemory(*channel->params) : 0;
+        uint64_t newParamsBytes = GetChannelParamsMemory(*newChannel->params);
+        if (oldMatrixBytes != newMatrixBytes || oldParamsBytes != newParamsBytes)
+        {
+            std::lock_guard<std::mutex> statsLock(m_statsMutex);
+            UpdateCacheMemory(oldMatrixBytes,
+                              newMatrixBytes,
+                              m_loadReport.channelMapBytes,
+                              m_loadReport.peakChannelMapBytes);
+            UpdateCacheMemory(oldParamsBytes,
+                              newParamsBytes,
+                              m_loadReport.channelParamsMapBytes,
+                              m_loadReport.peakChannelParamsMapBytes);
+        }
+
+        // publish the new channel. The previous one is released by its last reader, or kept
+        // as the spare of the link, whose buffers are reused by the next regeneration
+        std::atomic_store(&slot->channel, newChannel);
+        if (m_reuseChannelBuffers && channel)
+        {
+            slot->spare = std::const_pointer_cast<LinkChannel>(channel);
+        }
     }
-    else
+
+    // the traces are fired without holding the lock of the link, so that their sinks can
+    // query the model
+    if (simulationThread)
     {
-        NS_LOG_LOGIC("channel matrix not found");
-        notFound = true;
+        m_regenerationsTrace++;
+        m_channelRegeneratedTrace(aId, bId, latency);
     }
+    return newChannel;
+}
 
-    // If the channel is not present in the map or if it has to be updated
-    // generate a new channel
-    if (notFound || update)
+std::shared_ptr<QdChannelModel::LinkChannel>
+QdChannelModel::AcquireChannelBuffers(LinkSlot& slot,
+                                      uint64_t bSize,
+                                      uint64_t aSize,
+                                      uint64_t numPages)
+{
+    NS_LOG_FUNCTION(this << bSize << aSize << numPages);
+
+    // the retired channels are no longer published, so that the references to them can
+    // only be released, and a channel with no other holders stays free. The reference
+    // counts of the ns-3 pointers are not atomic, thus those of the channels lent to the
+    // simulation thread are only checked by the simulation thread itself
+    bool simulationThread = IsSimulationThread();
+    auto isFree = [simulationThread](const std::shared_ptr<LinkChannel>& channel) {
+        if (channel.use_count() != 1)
+        {
+            return false;
+        }
+        // synchronizes with the release of the last reference by another thread
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (!channel->lent.load(std::memory_order_relaxed))
+        {
+            return true;
+        }
+        if (!simulationThread || channel->matrix->GetReferenceCount() != 1 ||
+            channel->params->GetReferenceCount() != 1)
+        {
+            return false;
+        }
+        channel->lent.store(false, std::memory_order_relaxed);
+        return true;
+    };
+    auto hasDimensions = [bSize, aSize](const std::shared_ptr<LinkChannel>& channel) {
+        const MatrixBasedChannelModel::Complex3DVector& H = channel->matrix->m_channel;
+        return H.GetNumRows() == bSize && H.GetNumCols() == aSize;
+    };
+
+    if (m_reuseChannelBuffers)
     {
-        NS_LOG_LOGIC("channelMatrix notFound=" << notFound << " || update=" << update);
-        channelMatrix = GetNewChannel(aMob, bMob, aAntenna, bAntenna);
+        std::shared_ptr<LinkChannel> spare = std::move(slot.spare);
+        bool spareFree = spare && isFree(spare) && hasDimensions(spare);
+        if (spareFree && spare->matrix->m_channel.GetNumPages() == numPages)
+        {
+            NS_LOG_LOGIC("reusing the buffers of the retired channel of the link");
+            slot.stats.reusedChannels++;
+            return spare;
+        }
 
-        channelMatrix->m_antennaPair =
-            std::make_pair(aAntenna->GetId(),
-                           bAntenna->GetId()); // save antenna pair, with the exact order of s and u
-                                               // antennas at the moment of the channel generation
+        std::shared_ptr<LinkChannel> pooled;
+        {
+            std::lock_guard<std::mutex> poolLock(m_channelPoolMutex);
+            auto range = m_channelPool.equal_range(std::make_tuple(bSize, aSize, numPages));
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                if (isFree(it->second))
+                {
+                    pooled = std::move(it->second);
+                    m_channelPool.erase(it);
+                    break;
+                }
+            }
+        }
 
-        // store the channel matrix in the channel map
-        m_channelMap[channelId] = channelMatrix;
+        if (!pooled && spareFree)
+        {
+            // only the matrix is reallocated, while the parameters keep their capacity
+            NS_LOG_LOGIC("reusing the buffers of the retired channel of the link, resized");
+            slot.stats.reusedChannels++;
+            return spare;
+        }
+        // the spare, still held or with other dimensions, is pooled after the lookup, so
+        // that it does not take the place of a free channel
+        if (spare)
+        {
+            ReleaseChannelBuffers(std::move(spare));
+        }
+        if (pooled)
+        {
+            NS_LOG_LOGIC("reusing the buffers of a pooled channel");
+            slot.stats.pooledChannels++;
+            return pooled;
+        }
     }
 
-    return channelMatrix;
+    auto channel = std::make_shared<LinkChannel>();
+    channel->matrix = Create<QdChannelMatrix>();
+    channel->params = Create<MatrixBasedChannelModel::ChannelParams>();
+    return channel;
 }
 
-Ptr<MatrixBasedChannelModel::ChannelMatrix>
-QdChannelModel::GetNewChannel(Ptr<const MobilityModel> aMob,
-                              Ptr<const MobilityModel> bMob,
-                              Ptr<const PhasedArrayModel> aAntenna,
-                              Ptr<const PhasedArrayModel> bAntenna)
+void
+QdChannelModel::ReleaseChannelBuffers(std::shared_ptr<LinkChannel> channel)
 {
-    NS_LOG_FUNCTION(this << aMob << bMob << aAntenna << bAntenna);
+    NS_LOG_FUNCTION(this);
+
+    const MatrixBasedChannelModel::Complex3DVector& H = channel->matrix->m_channel;
+    auto key = std::make_tuple(H.GetNumRows(), H.GetNumCols(), H.GetNumPages());
+    std::lock_guard<std::mutex> poolLock(m_channelPoolMutex);
+    m_channelPool.emplace(key, std::move(channel));
+    if (m_channelPool.size() > m_linkSlots.size())
+    {
+        // drop the channel with the same dimensions retired first, possibly the new one
+        m_channelPool.erase(m_channelPool.lower_bound(key));
+    }
+}
+
+QdChannelModel::LinkSlot*
+QdChannelModel::GetLinkSlot(uint32_t aId, uint32_t bId) const
+{
+    auto it = m_linkSlots.find(GetKey(aId, bId));
+    return it != m_linkSlots.end() ? &it->second : nullptr;
+}
+
+uint32_t
+QdChannelModel::GetNodeId(const Ptr<const MobilityModel>& mob) const
+{
+    auto it = m_mobilityNodeIds.find(PeekPointer(mob));
+    if (it != m_mobilityNodeIds.end())
+    {
+        return it->second;
+    }
+    // the node was not matched to a position of the scenario
+    return mob->GetObject<Node>()->GetId();
+}
 
-    Ptr<MatrixBasedChannelModel::ChannelMatrix> channelMatrix =
-        Create<MatrixBasedChannelModel::ChannelMatrix>();
+std::shared_ptr<const QdChannelModel::LinkChannel>
+QdChannelModel::GetNewChannel(uint32_t aId,
+                              uint32_t bId,
+                              const Ptr<const PhasedArrayModel>& aAntenna,
+                              const Ptr<const PhasedArrayModel>& bAntenna,
+                              uint64_t timestep,
+                              LinkSlot& slot)
+{
+    NS_LOG_FUNCTION(this << aId << bId << aAntenna << bAntenna << timestep);
 
-    uint32_t timestep = GetTimestep();
-    uint32_t aId = aMob->GetObject<Node>()->GetId();
-    uint32_t bId = bMob->GetObject<Node>()->GetId();
+    LinkStats& stats = slot.stats;
     uint32_t channelId = GetKey(aId, bId);
 
-    QdInfo qdInfo = m_qdInfoMap.at(channelId)[timestep];
+    const QdInfo& qdInfo = GetQdInfo(aId, bId, timestep);
 
     uint64_t bSize = bAntenna->GetNumberOfElements();
     uint64_t aSize = aAntenna->GetNumberOfElements();
@@ -584,78 +2427,110 @@ QdChannelModel::GetNewChannel(Ptr<const MobilityModel> aMob,
                              << ", channelId=" << channelId << ", bSize=" << bSize
                              << ", aSize=" << aSize);
 
-    // channel coffecient H[u][s][n];
-    // considering only 1 cluster for retrocompatibility -> n=1
-    MatrixBasedChannelModel::Complex3DVector H(bSize, aSize, qdInfo.numMpcs);
+    // the links whose strongest ray is below the threshold get an empty channel, without
+    // rays, which is skipped by the beamforming and the PSD computations
+    bool pruned = IsBelowPathGainThreshold(qdInfo);
 
-    for (uint64_t mpcIndex = 0; mpcIndex < qdInfo.numMpcs; ++mpcIndex)
+    std::shared_ptr<LinkChannel> channel =
+        AcquireChannelBuffers(slot, bSize, aSize, pruned ? 0 : qdInfo.numMpcs);
+    const Ptr<QdChannelMatrix>& channelMatrix = channel->matrix;
+    const Ptr<MatrixBasedChannelModel::ChannelParams>& channelParams = channel->params;
+    if (!slot.scratch)
+    {
+        slot.scratch = std::make_unique<RegenerationScratch>();
+    }
+    RegenerationScratch& scratch = *slot.scratch;
+
+    // the channels of previous runs are read back from the disk cache, if enabled. The
+    // matrix is generated in place, in the buffer of a retired channel if reused
+    MatrixBasedChannelModel::Complex3DVector& H = channelMatrix->m_channel;
+    std::shared_ptr<QdChannelCache> channelCache = std::atomic_load(&m_channelCache);
+    QdChannelCache::Key cacheKey;
+    bool cached = false;
+    if (pruned)
+    {
+        NS_LOG_LOGIC("link pruned, strongest ray below " << m_pathGainThreshold << " dB");
+        ResetChannelMatrix(H, bSize, aSize, 0);
+        stats.prunedChannels++;
+    }
+    else if (channelCache)
+    {
+        cacheKey.aAntennaHash =
+            GetCachedAntennaHash(scratch.antennas, aAntenna, bAntenna->GetId());
+        cacheKey.bAntennaHash =
+            GetCachedAntennaHash(scratch.antennas, bAntenna, aAntenna->GetId());
+        cacheKey.aNodeId = aId;
+        cacheKey.bNodeId = bId;
+        cacheKey.timestep = timestep;
+        cached = channelCache->Read(cacheKey, H) && H.GetNumRows() == bSize &&
+                 H.GetNumCols() == aSize && H.GetNumPages() == qdInfo.numMpcs;
+    }
+
+    if (cached)
+    {
+        NS_LOG_LOGIC("channel matrix read from the disk cache");
+        stats.diskCacheHits++;
+    }
+    else if (!pruned)
     {
-        double initialPhase =
-            -2 * M_PI * qdInfo.delay_s[mpcIndex] * m_frequency + qdInfo.phase_rad[mpcIndex];
-        double pathGain = pow(10, qdInfo.pathGain_dbpow[mpcIndex] / 20);
-
-        Angles bAngle = Angles(qdInfo.azAoa_rad[mpcIndex], qdInfo.elAoa_rad[mpcIndex]);
-        Angles aAngle = Angles(qdInfo.azAod_rad[mpcIndex], qdInfo.elAod_rad[mpcIndex]);
-        NS_LOG_DEBUG("aAngle: " << aAngle << ", bAngle: " << bAngle);
-
-        // ignore polarization
-        double bFieldPattH, bFieldPattV, aFieldPattH, aFieldPattV;
-        std::tie(bFieldPattH, bFieldPattV) = bAntenna->GetElementFieldPattern(bAngle);
-        double bElementGain = std::sqrt(bFieldPattH * bFieldPattH + bFieldPattV * bFieldPattV);
-        std::tie(aFieldPattH, aFieldPattV) = aAntenna->GetElementFieldPattern(aAngle);
-        double aElementGain = std::sqrt(aFieldPattH * aFieldPattH + aFieldPattV * aFieldPattV);
-
-        double pgTimesGains = pathGain * bElementGain * aElementGain;
-        std::complex<double> complexRay = pgTimesGains * std::polar(1.0, initialPhase);
-
-        NS_LOG_DEBUG("qdInfo.delay_s[mpcIndex]="
-                     << qdInfo.delay_s[mpcIndex]
-                     << ", qdInfo.phase_rad[mpcIndex]=" << qdInfo.phase_rad[mpcIndex]
-                     << ", qdInfo.pathGain_dbpow[mpcIndex]=" << qdInfo.pathGain_dbpow[mpcIndex]
-                     << ", bAngle=" << bAngle << ", aAngle=" << aAngle
-                     << ", initialPhase=" << initialPhase << ", pathGain=" << pathGain
-                     << ", bElementGain=" << bElementGain << ", aElementGain=" << aElementGain
-                     << ", pgTimesGains=" << pgTimesGains << ", complexRay=" << complexRay);
+        // the rays are computed in the buffers of the link, without allocating
+        ComputeChannelRays(qdInfo, aAntenna, bAntenna, scratch);
+        const RayBuffers& rays = scratch.rays;
 
-        for (uint64_t bIndex = 0; bIndex < bSize; ++bIndex)
-        {
-            Vector uLoc = bAntenna->GetElementLocation(bIndex);
-            double bPhaseElementPhase =
-                2 * M_PI *
-                (sin(qdInfo.elAoa_rad[mpcIndex]) * cos(qdInfo.azAoa_rad[mpcIndex]) * uLoc.x +
-                 sin(qdInfo.elAoa_rad[mpcIndex]) * sin(qdInfo.azAoa_rad[mpcIndex]) * uLoc.y +
-                 cos(qdInfo.elAoa_rad[mpcIndex]) * uLoc.z);
-            std::complex<double> bWeight = std::polar(1.0, bPhaseElementPhase);
+        // channel coffecient H[u][s][n];
+        // considering only 1 cluster for retrocompatibility -> n=1
+        ResetChannelMatrix(H, bSize, aSize, qdInfo.numMpcs);
 
-            for (uint64_t aIndex = 0; aIndex < aSize; ++aIndex)
+        if (!SynthesizeFixedSizeChannel(rays, H))
+        {
+            for (uint64_t mpcIndex = 0; mpcIndex < qdInfo.numMpcs; ++mpcIndex)
             {
-                Vector sLoc = aAntenna->GetElementLocation(aIndex);
-                // minus sign: complex conjugate for TX steering vector
-                double aPhaseElementPhase =
-                    2 * M_PI *
-                    (sin(qdInfo.elAod_rad[mpcIndex]) * cos(qdInfo.azAod_rad[mpcIndex]) * sLoc.x +
-                     sin(qdInfo.elAod_rad[mpcIndex]) * sin(qdInfo.azAod_rad[mpcIndex]) * sLoc.y +
-                     cos(qdInfo.elAod_rad[mpcIndex]) * sLoc.z);
-                std::complex<double> aWeight = std::polar(1.0, aPhaseElementPhase);
-
-                std::complex<double> ray = complexRay * bWeight * aWeight;
-                H(bIndex, aIndex, 0) += ray;
+                for (uint64_t bIndex = 0; bIndex < bSize; ++bIndex)
+                {
+                    std::complex<double> bRay =
+                        rays.rayGain[mpcIndex] * rays.bSteering[mpcIndex * bSize + bIndex];
+
+                    for (uint64_t aIndex = 0; aIndex < aSize; ++aIndex)
+                    {
+                        std::complex<double> ray = bRay * rays.aSteering[mpcIndex * aSize + aIndex];
+                        H(bIndex, aIndex, 0) += ray;
+                    }
+                }
             }
         }
-    }
 
-    Ptr<MatrixBasedChannelModel::ChannelParams> channelParams =
-        Create<MatrixBasedChannelModel::ChannelParams>();
+        if (channelCache && channelCache->Write(cacheKey, H))
+        {
+            stats.diskCacheWrites++;
+        }
+    }
 
-    channelMatrix->m_channel = H;
     channelMatrix->m_generatedTime = Simulator::Now();
-
-    channelParams->m_delay = qdInfo.delay_s;
-    channelParams->m_angle.clear();
-    channelParams->m_angle.push_back(qdInfo.azAoa_rad);
-    channelParams->m_angle.push_back(qdInfo.elAoa_rad);
-    channelParams->m_angle.push_back(qdInfo.azAod_rad);
-    channelParams->m_angle.push_back(qdInfo.elAod_rad);
+    channelMatrix->m_realizationId = ++g_lastRealizationId;
+    channelMatrix->m_antennaPair =
+        std::make_pair(aAntenna->GetId(),
+                       bAntenna->GetId()); // save antenna pair, with the exact order of s and u
+                                           // antennas at the moment of the channel generation
+
+    // the vectors are assigned rather than rebuilt, so that reused buffers keep their
+    // capacity
+    channelParams->m_angle.resize(4);
+    if (pruned)
+    {
+        channelParams->m_delay.clear();
+        for (auto& angle : channelParams->m_angle)
+        {
+            angle.clear();
+        }
+    }
+    else
+    {
+        channelParams->m_delay = qdInfo.delay_s;
+        channelParams->m_angle[0] = qdInfo.azAoa_rad;
+        channelParams->m_angle[1] = qdInfo.elAoa_rad;
+        channelParams->m_angle[2] = qdInfo.azAod_rad;
+        channelParams->m_angle[3] = qdInfo.elAod_rad;
+    }
     channelParams->m_generatedTime = Simulator::Now();
     channelParams->m_nodeIds = std::make_pair(aId, bId);
 
@@ -670,22 +2545,345 @@ QdChannelModel::GetNewChannel(Ptr<const MobilityModel> aMob,
     // By default, m_vScatt is set to 0, so there is no additional Doppler
     // contribution.
 
-    DoubleVector dopplerTermAlpha;
-    DoubleVector dopplerTermD;
-    for (uint8_t cIndex = 0; cIndex < H.GetNumPages(); cIndex++)
+    // Set the alpha and D as described in 3GPP TR 37.885 v15.3.0, Sec. 6.2.3,
+    // both to 0, to avoid introducing additional scatter terms
+    channelParams->m_alpha.assign(H.GetNumPages(), 0.0);
+    channelParams->m_D.assign(H.GetNumPages(), 0.0);
+
+    channel->timestep = timestep;
+
+    return channel;
+}
+
+std::complex<double>
+QdChannelModel::ComputeRayGain(const QdInfo& qdInfo,
+                               uint64_t mpcIndex,
+                               const Ptr<const PhasedArrayModel>& aAntenna,
+                               const Ptr<const PhasedArrayModel>& bAntenna) const
+{
+    double initialPhase =
+        -2 * M_PI * qdInfo.delay_s[mpcIndex] * m_frequency + qdInfo.phase_rad[mpcIndex];
+    double pathGain = pow(10, qdInfo.pathGain_dbpow[mpcIndex] / 20);
+
+    Angles bAngle = Angles(qdInfo.azAoa_rad[mpcIndex], qdInfo.elAoa_rad[mpcIndex]);
+    Angles aAngle = Angles(qdInfo.azAod_rad[mpcIndex], qdInfo.elAod_rad[mpcIndex]);
+    NS_LOG_DEBUG("aAngle: " << aAngle << ", bAngle: " << bAngle);
+
+    // ignore polarization
+    double bFieldPattH, bFieldPattV, aFieldPattH, aFieldPattV;
+    std::tie(bFieldPattH, bFieldPattV) = bAntenna->GetElementFieldPattern(bAngle);
+    double bElementGain = std::sqrt(bFieldPattH * bFieldPattH + bFieldPattV * bFieldPattV);
+    std::tie(aFieldPattH, aFieldPattV) = aAntenna->GetElementFieldPattern(aAngle);
+    double aElementGain = std::sqrt(aFieldPattH * aFieldPattH + aFieldPattV * aFieldPattV);
+
+    double pgTimesGains = pathGain * bElementGain * aElementGain;
+    std::complex<double> complexRay = pgTimesGains * std::polar(1.0, initialPhase);
+
+    NS_LOG_DEBUG("qdInfo.delay_s[mpcIndex]="
+                 << qdInfo.delay_s[mpcIndex]
+                 << ", qdInfo.phase_rad[mpcIndex]=" << qdInfo.phase_rad[mpcIndex]
+                 << ", qdInfo.pathGain_dbpow[mpcIndex]=" << qdInfo.pathGain_dbpow[mpcIndex]
+                 << ", bAngle=" << bAngle << ", aAngle=" << aAngle
+                 << ", initialPhase=" << initialPhase << ", pathGain=" << pathGain
+                 << ", bElementGain=" << bElementGain << ", aElementGain=" << aElementGain
+                 << ", pgTimesGains=" << pgTimesGains << ", complexRay=" << complexRay);
+
+    return complexRay;
+}
+
+Ptr<QdChannelModel::ChannelRays>
+QdChannelModel::ComputeChannelRays(const QdInfo& qdInfo,
+                                   const Ptr<const PhasedArrayModel>& aAntenna,
+                                   const Ptr<const PhasedArrayModel>& bAntenna) const
+{
+    NS_LOG_FUNCTION(this << aAntenna << bAntenna);
+
+    RegenerationScratch scratch;
+    ComputeChannelRays(qdInfo, aAntenna, bAntenna, scratch);
+    const RayBuffers& buffers = scratch.rays;
+
+    Ptr<ChannelRays> rays = Create<ChannelRays>();
+    rays->m_rayGain = buffers.rayGain;
+    rays->m_aSteering = MatrixBasedChannelModel::Complex2DVector(buffers.aSize, qdInfo.numMpcs);
+    rays->m_bSteering = MatrixBasedChannelModel::Complex2DVector(buffers.bSize, qdInfo.numMpcs);
+    // both are column-major, with the steering vector of each ray in a column
+    for (size_t i = 0; i < buffers.aSteering.size(); ++i)
+    {
+        rays->m_aSteering[i] = buffers.aSteering[i];
+    }
+    for (size_t i = 0; i < buffers.bSteering.size(); ++i)
+    {
+        rays->m_bSteering[i] = buffers.bSteering[i];
+    }
+    rays->m_delay = qdInfo.delay_s;
+
+    return rays;
+}
+
+void
+QdChannelModel::ComputeChannelRays(const QdInfo& qdInfo,
+                                   const Ptr<const PhasedArrayModel>& aAntenna,
+                                   const Ptr<const PhasedArrayModel>& bAntenna,
+                                   RegenerationScratch& scratch) const
+{
+    NS_LOG_FUNCTION(this << aAntenna << bAntenna);
+
+    RayBuffers& rays = scratch.rays;
+    rays.bSize = bAntenna->GetNumberOfElements();
+    rays.aSize = aAntenna->GetNumberOfElements();
+    rays.rayGain.resize(qdInfo.numMpcs);
+    rays.aSteering.resize(rays.aSize * qdInfo.numMpcs);
+    rays.bSteering.resize(rays.bSize * qdInfo.numMpcs);
+
+    const ArrayGeometry& bGeometry =
+        GetCachedArrayGeometry(scratch.antennas, bAntenna, aAntenna->GetId());
+    const ArrayGeometry& aGeometry =
+        GetCachedArrayGeometry(scratch.antennas, aAntenna, bAntenna->GetId());
+
+    for (uint64_t mpcIndex = 0; mpcIndex < qdInfo.numMpcs; ++mpcIndex)
+    {
+        rays.rayGain[mpcIndex] = ComputeRayGain(qdInfo, mpcIndex, aAntenna, bAntenna);
+        ComputeSteeringVector(qdInfo.azAoa_rad[mpcIndex],
+                              qdInfo.elAoa_rad[mpcIndex],
+                              bGeometry,
+                              &rays.bSteering[mpcIndex * rays.bSize]);
+        ComputeSteeringVector(qdInfo.azAod_rad[mpcIndex],
+                              qdInfo.elAod_rad[mpcIndex],
+                              aGeometry,
+                              &rays.aSteering[mpcIndex * rays.aSize]);
+    }
+}
+
+Ptr<const QdChannelModel::ChannelRays>
+QdChannelModel::GetChannelRays(Ptr<const MobilityModel> aMob,
+                               Ptr<const MobilityModel> bMob,
+                               Ptr<const PhasedArrayModel> aAntenna,
+                               Ptr<const PhasedArrayModel> bAntenna) const
+{
+    NS_LOG_FUNCTION(this << aMob << bMob << aAntenna << bAntenna);
+
+    uint32_t aId = GetNodeId(aMob);
+    uint32_t bId = GetNodeId(bMob);
+
+    return GetChannelRays(aId, bId, aAntenna, bAntenna, GetTimestep());
+}
+
+Ptr<const QdChannelModel::ChannelRays>
+QdChannelModel::GetChannelRays(uint32_t aNodeId,
+                               uint32_t bNodeId,
+                               Ptr<const PhasedArrayModel> aAntenna,
+                               Ptr<const PhasedArrayModel> bAntenna,
+                               uint64_t timestep) const
+{
+    NS_LOG_FUNCTION(this << aNodeId << bNodeId << aAntenna << bAntenna << timestep);
+
+    return ComputeChannelRays(GetQdInfo(aNodeId, bNodeId, timestep), aAntenna, bAntenna);
+}
+
+const QdChannelModel::QdInfo&
+QdChannelModel::GetQdInfo(uint32_t aNodeId, uint32_t bNodeId, uint64_t timestep) const
+{
+    auto it = m_qdInfoMap.find(GetKey(aNodeId, bNodeId));
+    if (it == m_qdInfoMap.end())
+    {
+        NS_ABORT_MSG_IF(m_partitionBySystemId && m_localNodeIds.count(aNodeId) == 0 &&
+                            m_localNodeIds.count(bNodeId) == 0,
+                        "Nodes " << aNodeId << " and " << bNodeId << " are not owned by system "
+                                 << Simulator::GetSystemId()
+                                 << ", the QD information of their channel is not loaded");
+        NS_ABORT_MSG_IF(m_ns3IdToRtIdMap.count(aNodeId) == 0 ||
+                            m_ns3IdToRtIdMap.count(bNodeId) == 0,
+                        "Node " << (m_ns3IdToRtIdMap.count(aNodeId) == 0 ? aNodeId : bNodeId)
+                                << " is not matched to a loaded position of the scenario");
+        NS_ABORT_MSG("No QD information for nodes " << aNodeId << " and " << bNodeId);
+    }
+    NS_ABORT_MSG_IF(timestep >= it->second.size(),
+                    "Timestep " << timestep << " out of range, the QD traces contain "
+                                << it->second.size() << " timesteps");
+    if (timestep >= m_loadedTimesteps.load(std::memory_order_acquire))
+    {
+        // the QD files are being loaded in the background, and the link may have been
+        // read further than the other ones
+        const LinkSlot* slot = GetLinkSlot(aNodeId, bNodeId);
+        if (slot == nullptr || timestep >= slot->loadedTimesteps.load(std::memory_order_acquire))
+        {
+            WaitForTimestep(slot, timestep);
+        }
+    }
+
+    return it->second[timestep];
+}
+
+uint64_t
+QdChannelModel::GetBeamformingVectorHash(const PhasedArrayModel::ComplexVector& w)
+{
+    // FNV-1a over the bytes of the entries, so that any change of the weights, even in the
+    // last bit, changes the fingerprint with overwhelming probability
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < w.GetSize(); ++i)
+    {
+        double parts[2] = {w[i].real(), w[i].imag()};
+        const auto* bytes = reinterpret_cast<const unsigned char*>(parts);
+        for (size_t byte = 0; byte < sizeof(parts); ++byte)
+        {
+            hash ^= bytes[byte];
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+std::shared_ptr<const QdChannelModel::BeamformedRays>
+QdChannelModel::GetBeamformedRays(Ptr<const MobilityModel> aMob,
+                                  Ptr<const MobilityModel> bMob,
+                                  Ptr<const PhasedArrayModel> aAntenna,
+                                  Ptr<const PhasedArrayModel> bAntenna,
+                                  const PhasedArrayModel::ComplexVector& aW,
+                                  const PhasedArrayModel::ComplexVector& bW) const
+{
+    NS_LOG_FUNCTION(this << aMob << bMob << aAntenna << bAntenna);
+
+    uint32_t aId = GetNodeId(aMob);
+    uint32_t bId = GetNodeId(bMob);
+    uint64_t timestep = GetTimestep();
+    // GetQdInfo aborts if the link is not loaded, thus the slot exists afterwards
+    const QdInfo& qdInfo = GetQdInfo(aId, bId, timestep);
+    LinkSlot* slot = GetLinkSlot(aId, bId);
+    NS_ASSERT(slot != nullptr);
+
+    uint64_t aWeightsHash = GetBeamformingVectorHash(aW);
+    uint64_t bWeightsHash = GetBeamformingVectorHash(bW);
+    std::shared_ptr<const BeamformedRays>& cached = slot->beamformedRays[aId < bId ? 0 : 1];
+    std::shared_ptr<const BeamformedRays> rays = std::atomic_load(&cached);
+    if (rays && rays->m_timestep == timestep && rays->m_aNodeId == aId &&
+        rays->m_aAntennaId == aAntenna->GetId() && rays->m_bAntennaId == bAntenna->GetId() &&
+        rays->m_aWeightsHash == aWeightsHash && rays->m_bWeightsHash == bWeightsHash)
+    {
+        NS_LOG_LOGIC("beamformed gains present in the cache");
+        slot->stats.beamformedRaysHits.fetch_add(1, std::memory_order_relaxed);
+        return rays;
+    }
+
+    // Concurrent misses on the same link compute the same gains, and the last one is kept
+    auto newRays = std::make_shared<BeamformedRays>();
+    newRays->m_timestep = timestep;
+    newRays->m_aNodeId = aId;
+    newRays->m_aAntennaId = aAntenna->GetId();
+    newRays->m_bAntennaId = bAntenna->GetId();
+    newRays->m_aWeightsHash = aWeightsHash;
+    newRays->m_bWeightsHash = bWeightsHash;
+    if (IsBelowPathGainThreshold(qdInfo))
     {
-        // Set the alpha and D as described in 3GPP TR 37.885 v15.3.0, Sec. 6.2.3,
-        // both to 0, to avoid introducing additional scatter terms
-        dopplerTermAlpha.push_back(0.0);
-        dopplerTermD.push_back(0.0);
+        // pruned link, without rays
+        slot->stats.prunedBeamformedRays.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        newRays->m_gains = ComputeBeamformedRayGains(qdInfo, aAntenna, bAntenna, aW, bW);
+        newRays->m_delay = qdInfo.delay_s;
+    }
+    slot->stats.beamformedRaysMisses.fetch_add(1, std::memory_order_relaxed);
+
+    rays = newRays;
+    std::atomic_store(&cached, rays);
+    return rays;
+}
+
+std::vector<std::complex<double>>
+QdChannelModel::GetBeamformedRayGains(Ptr<const MobilityModel> aMob,
+                                      Ptr<const MobilityModel> bMob,
+                                      Ptr<const PhasedArrayModel> aAntenna,
+                                      Ptr<const PhasedArrayModel> bAntenna,
+                                      const PhasedArrayModel::ComplexVector& aW,
+                                      const PhasedArrayModel::ComplexVector& bW) const
+{
+    NS_LOG_FUNCTION(this << aMob << bMob << aAntenna << bAntenna);
+
+    return GetBeamformedRays(aMob, bMob, aAntenna, bAntenna, aW, bW)->m_gains;
+}
+
+std::vector<std::complex<double>>
+QdChannelModel::ComputeBeamformedRayGains(const QdInfo& qdInfo,
+                                          const Ptr<const PhasedArrayModel>& aAntenna,
+                                          const Ptr<const PhasedArrayModel>& bAntenna,
+                                          const PhasedArrayModel::ComplexVector& aW,
+                                          const PhasedArrayModel::ComplexVector& bW) const
+{
+    uint64_t bSize = bAntenna->GetNumberOfElements();
+    uint64_t aSize = aAntenna->GetNumberOfElements();
+    NS_ASSERT_MSG(aW.GetSize() == aSize && bW.GetSize() == bSize,
+                  "The size of the beamforming vectors does not match the antenna arrays");
+
+    ArrayGeometry bGeometry = GetArrayGeometry(bAntenna);
+    ArrayGeometry aGeometry = GetArrayGeometry(aAntenna);
+    PhasedArrayModel::ComplexVector bSteering(bSize);
+    PhasedArrayModel::ComplexVector aSteering(aSize);
+
+    std::vector<std::complex<double>> gains(qdInfo.numMpcs);
+    for (uint64_t mpcIndex = 0; mpcIndex < qdInfo.numMpcs; ++mpcIndex)
+    {
+        ComputeSteeringVector(qdInfo.azAoa_rad[mpcIndex],
+                              qdInfo.elAoa_rad[mpcIndex],
+                              bGeometry,
+                              &bSteering[0]);
+        std::complex<double> bResponse(0, 0);
+        for (uint64_t bIndex = 0; bIndex < bSize; ++bIndex)
+        {
+            bResponse += bW[bIndex] * bSteering[bIndex];
+        }
+
+        ComputeSteeringVector(qdInfo.azAod_rad[mpcIndex],
+                              qdInfo.elAod_rad[mpcIndex],
+                              aGeometry,
+                              &aSteering[0]);
+        std::complex<double> aResponse(0, 0);
+        for (uint64_t aIndex = 0; aIndex < aSize; ++aIndex)
+        {
+            aResponse += aW[aIndex] * aSteering[aIndex];
+        }
+
+        gains[mpcIndex] =
+            ComputeRayGain(qdInfo, mpcIndex, aAntenna, bAntenna) * bResponse * aResponse;
+    }
+
+    return gains;
+}
+
+std::vector<std::complex<double>>
+QdChannelModel::GetBeamformedDelayBinGains(Ptr<const MobilityModel> aMob,
+                                           Ptr<const MobilityModel> bMob,
+                                           Ptr<const PhasedArrayModel> aAntenna,
+                                           Ptr<const PhasedArrayModel> bAntenna,
+                                           const PhasedArrayModel::ComplexVector& aW,
+                                           const PhasedArrayModel::ComplexVector& bW,
+                                           Time binWidth) const
+{
+    NS_LOG_FUNCTION(this << aMob << bMob << aAntenna << bAntenna << binWidth);
+    NS_ASSERT_MSG(binWidth.IsStrictlyPositive(), "The delay bin width must be positive");
+
+    std::shared_ptr<const BeamformedRays> rays =
+        GetBeamformedRays(aMob, bMob, aAntenna, bAntenna, aW, bW);
+
+    std::vector<std::complex<double>> binGains;
+    for (size_t mpcIndex = 0; mpcIndex < rays->m_gains.size(); ++mpcIndex)
+    {
+        auto bin = static_cast<size_t>(rays->m_delay[mpcIndex] / binWidth.GetSeconds());
+        if (bin >= binGains.size())
+        {
+            binGains.resize(bin + 1);
+        }
+        binGains[bin] += rays->m_gains[mpcIndex];
     }
-    channelParams->m_alpha = dopplerTermAlpha;
-    channelParams->m_D = dopplerTermD;
 
-    // Store channel parameters
-    m_channelParamsMap[channelId] = channelParams;
+    return binGains;
+}
+
+std::vector<double>
+QdChannelModel::GetRayDelays(Ptr<const MobilityModel> aMob, Ptr<const MobilityModel> bMob) const
+{
+    NS_LOG_FUNCTION(this << aMob << bMob);
 
-    return channelMatrix;
+    return GetQdInfo(GetNodeId(aMob), GetNodeId(bMob), GetTimestep()).delay_s;
 }
 
 Ptr<const MatrixBasedChannelModel::ChannelParams>
@@ -693,19 +2891,65 @@ QdChannelModel::GetParams(Ptr<const MobilityModel> aMob, Ptr<const MobilityModel
 {
     NS_LOG_FUNCTION(this);
 
-    // Compute the channel key. The key is reciprocal, i.e., key (a, b) = key (b, a)
-    uint64_t channelParamsKey =
-        GetKey(aMob->GetObject<Node>()->GetId(), bMob->GetObject<Node>()->GetId());
+    // The slot is found by the channel key, which is reciprocal, i.e., key (a, b) = key (b, a)
+    std::shared_ptr<const LinkChannel> channel =
+        GetPublishedChannel(GetLinkSlot(GetNodeId(aMob), GetNodeId(bMob)));
+    if (!channel)
+    {
+        return nullptr;
+    }
+    // the ns-3 pointer is not tracked by the shared ownership, see AcquireChannelBuffers
+    channel->lent.store(true, std::memory_order_relaxed);
+    return channel->params;
+}
+
+Ptr<const MatrixBasedChannelModel::ChannelParams>
+QdChannelModel::GetParams(const LinkHandle& handle) const
+{
+    NS_LOG_FUNCTION(this << handle.aNodeId << handle.bNodeId);
+
+    std::shared_ptr<const LinkChannel> channel = GetPublishedChannel(GetLinkSlot(handle));
+    if (!channel)
+    {
+        return nullptr;
+    }
+    channel->lent.store(true, std::memory_order_relaxed);
+    return channel->params;
+}
 
-    if (m_channelParamsMap.find(channelParamsKey) != m_channelParamsMap.end())
+std::shared_ptr<const MatrixBasedChannelModel::ChannelParams>
+QdChannelModel::GetSharedParams(const LinkHandle& handle) const
+{
+    std::shared_ptr<const LinkChannel> channel = GetPublishedChannel(GetLinkSlot(handle));
+    if (!channel)
     {
-        return m_channelParamsMap.find(channelParamsKey)->second;
+        return nullptr;
     }
-    else
+    // the params are owned by the channel, which is shared with the caller
+    return std::shared_ptr<const MatrixBasedChannelModel::ChannelParams>(
+        channel,
+        PeekPointer(channel->params));
+}
+
+std::shared_ptr<const QdChannelModel::LinkChannel>
+QdChannelModel::GetPublishedChannel(LinkSlot* slot) const
+{
+    std::shared_ptr<const LinkChannel> channel;
+    if (slot != nullptr)
+    {
+        channel = std::atomic_load(&slot->channel);
+    }
+
+    if (!channel)
     {
         NS_LOG_WARN("Channel params map not found. Returning a nullptr.");
-        return nullptr;
+        m_paramsMisses.fetch_add(1, std::memory_order_relaxed);
+        if (IsSimulationThread())
+        {
+            m_paramsMissesTrace++;
+        }
     }
+    return channel;
 }
 
 uint64_t
@@ -721,7 +2965,13 @@ QdChannelModel::GetTimestep(Time t) const
     NS_ASSERT_MSG(m_updatePeriod.GetNanoSeconds() > 0.0,
                   "QdChannelModel update period not set correctly");
 
-    uint64_t timestep = t.GetNanoSeconds() / m_updatePeriod.GetNanoSeconds();
+    NS_ASSERT_MSG(t >= m_scenarioStartTime,
+                  "Time " << t.GetSeconds() << " s precedes the start of the scenario");
+    // the scenario starts at the beginning of the loaded window
+    uint64_t timestep =
+        (t - m_scenarioStartTime + m_startOffset).GetNanoSeconds() /
+            m_updatePeriod.GetNanoSeconds() -
+        m_firstTimestep;
     NS_LOG_DEBUG("t = " << t.GetNanoSeconds() << " ns"
                         << ", updatePeriod = " << m_updatePeriod.GetNanoSeconds() << " ns"
                         << ", timestep = " << timestep);
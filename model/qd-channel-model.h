@@ -22,14 +22,28 @@
 
 #include "ns3/angles.h"
 #include "ns3/boolean.h"
+#include "ns3/event-id.h"
 #include "ns3/nstime.h"
 #include "ns3/object.h"
+#include "ns3/phased-array-model.h"
+#include "ns3/qd-channel-cache.h"
 #include "ns3/random-variable-stream.h"
+#include "ns3/traced-callback.h"
+#include "ns3/traced-value.h"
 #include <ns3/matrix-based-channel-model.h>
 #include <ns3/three-gpp-channel-model.h>
 
+#include <array>
+#include <atomic>
 #include <complex.h>
+#include <condition_variable>
+#include <future>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <tuple>
 
 namespace ns3
 {
@@ -38,6 +52,72 @@ class PhasedArrayModel;
 class MatrixBasedChannelModel;
 class MobilityModel;
 
+/**
+ * \ingroup spectrum
+ *
+ * Histogram of latencies with logarithmically spaced bins, cheap enough to be always
+ * enabled. Bin i counts the latencies in [2^i, 2^(i+1)) ns, and bin 0 also counts
+ * latencies shorter than 1 ns.
+ */
+class QdLatencyHistogram
+{
+  public:
+    static constexpr uint32_t NUM_BINS = 64; //!< number of bins
+
+    /**
+     * Add a latency sample
+     *
+     * \param latency the latency
+     */
+    void Add(Time latency);
+
+    /**
+     * Get the number of samples
+     *
+     * \return the number of samples
+     */
+    uint64_t GetCount() const;
+
+    /**
+     * Get the number of samples in a bin
+     *
+     * \param bin the bin index, i.e., latencies in [2^bin, 2^(bin+1)) ns
+     * \return the number of samples in the bin
+     */
+    uint64_t GetBinCount(uint32_t bin) const;
+
+    /**
+     * Get the sum of all the samples
+     *
+     * \return the sum of all the samples
+     */
+    Time GetTotal() const;
+
+    /**
+     * Print the non-empty bins, one per line
+     *
+     * \param os the output stream
+     */
+    void Print(std::ostream& os) const;
+
+    /**
+     * Add the samples of another histogram
+     *
+     * \param other the other histogram
+     */
+    void Merge(const QdLatencyHistogram& other);
+
+    /**
+     * Remove all the samples
+     */
+    void Reset();
+
+  private:
+    std::array<uint64_t, NUM_BINS> m_bins{}; //!< number of samples in each bin
+    uint64_t m_count{0};                     //!< number of samples
+    Time m_total;                            //!< sum of all the samples
+};
+
 /**
  * \ingroup spectrum
  *
@@ -67,6 +147,9 @@ class QdChannelModel : public MatrixBasedChannelModel
     /**
      * Returns a matrix with a realization of the channel between
      * the nodes with mobility objects passed as input parameters.
+     * The returned ns-3 pointer has a non-atomic reference count, thus this method is meant
+     * for the thread running the simulation; other threads can request the same channels
+     * at the same time with GetSharedChannel.
      *
      * \param aMob mobility model of the a device
      * \param bMob mobility model of the b device
@@ -82,7 +165,8 @@ class QdChannelModel : public MatrixBasedChannelModel
 
     /**
      * Looks for the channel params associated to the aMob and bMob pair in
-     * m_channelParamsMap. If not found it will return a nullptr.
+     * the link slots. If not found it will return a nullptr.
+     * As GetChannel, it is meant for the thread running the simulation, see GetSharedParams.
      *
      * \param aMob mobility model of the a device
      * \param bMob mobility model of the b device
@@ -92,6 +176,82 @@ class QdChannelModel : public MatrixBasedChannelModel
         Ptr<const MobilityModel> aMob,
         Ptr<const MobilityModel> bMob) const override;
 
+  private:
+    struct LinkSlot;
+
+  public:
+    /**
+     * Link between two devices resolved once by ResolveLink, so that the callers querying
+     * the same link many times skip the lookup of the nodes and of the link slot
+     */
+    struct LinkHandle
+    {
+        uint32_t aNodeId{0};                  //!< ns-3 ID of the a node
+        uint32_t bNodeId{0};                  //!< ns-3 ID of the b node
+        Ptr<const PhasedArrayModel> aAntenna; //!< antenna of the a device
+        Ptr<const PhasedArrayModel> bAntenna; //!< antenna of the b device
+        LinkSlot* slot{nullptr}; //!< cache slot of the link, nullptr if not loaded
+        uint64_t generation{0};  //!< generation of the link slots the slot belongs to
+    };
+
+    /**
+     * Resolve the link between two devices into a handle, to be passed to the
+     * GetChannel and GetParams overloads. The handle stays valid across scenario switches,
+     * which only make its next uses look the link up again
+     *
+     * \param aMob mobility model of the a device
+     * \param bMob mobility model of the b device
+     * \param aAntenna antenna of the a device
+     * \param bAntenna antenna of the b device
+     * \return the link handle
+     */
+    LinkHandle ResolveLink(Ptr<const MobilityModel> aMob,
+                           Ptr<const MobilityModel> bMob,
+                           Ptr<const PhasedArrayModel> aAntenna,
+                           Ptr<const PhasedArrayModel> bAntenna) const;
+
+    /**
+     * Returns a matrix with a realization of the channel of a resolved link, as the
+     * GetChannel overload taking the mobility models, but without looking the link up
+     *
+     * \param handle the link handle, see ResolveLink
+     * \return the channel matrix
+     */
+    Ptr<const MatrixBasedChannelModel::ChannelMatrix> GetChannel(const LinkHandle& handle);
+
+    /**
+     * Looks for the channel params of a resolved link, as the GetParams overload taking
+     * the mobility models, but without looking the link up
+     *
+     * \param handle the link handle, see ResolveLink
+     * \return the channel params, or nullptr if not found
+     */
+    Ptr<const MatrixBasedChannelModel::ChannelParams> GetParams(const LinkHandle& handle) const;
+
+    /**
+     * Returns the channel matrix of a resolved link, as GetChannel, but sharing the
+     * ownership of the published channel through the atomic reference count of a
+     * std::shared_ptr rather than through an ns-3 pointer. Thus, it can be called by
+     * concurrent threads, also for the same link: cached channels are looked up without
+     * locking, and each link is regenerated only once per timestep. The handles are to be
+     * resolved by the thread running the simulation
+     *
+     * \param handle the link handle, see ResolveLink
+     * \return the channel matrix
+     */
+    std::shared_ptr<const MatrixBasedChannelModel::ChannelMatrix> GetSharedChannel(
+        const LinkHandle& handle);
+
+    /**
+     * Looks for the channel params of a resolved link, as GetParams, sharing their
+     * ownership as GetSharedChannel, so that it can be called by concurrent threads
+     *
+     * \param handle the link handle, see ResolveLink
+     * \return the channel params, or nullptr if not found
+     */
+    std::shared_ptr<const MatrixBasedChannelModel::ChannelParams> GetSharedParams(
+        const LinkHandle& handle) const;
+
     /*
      * Set the folder path containing the scenario of interest
      *
@@ -122,6 +282,24 @@ class QdChannelModel : public MatrixBasedChannelModel
      */
     std::string GetScenario() const;
 
+    /**
+     * Load a scenario in the background, while the current one keeps being used, and
+     * switch to it at the given simulation time.
+     * Nodes are matched to the positions listed by the new scenario when this method is
+     * called, while the QD files are parsed by a separate thread. At the switch time, the
+     * new scenario replaces the current one, waiting for the loading to complete only if
+     * it is not over yet, and all the cached channels are invalidated.
+     * The timesteps of the new scenario are counted starting from the switch time, e.g.,
+     * to chain the traces of consecutive rooms in a walk-through.
+     * Only one scenario can be preloaded at a time, and the switch is cancelled if the
+     * model is destroyed before, as is the loading, after the QD file being read.
+     *
+     * \param scenario folder name, containg the Input/ and the Output/Ns3/ folders, relative
+     *        to the current path
+     * \param switchTime the simulation time at which the new scenario is used
+     */
+    void PreloadScenario(std::string scenario, Time switchTime);
+
     /**
      * Just a dummy setter for compatibility reasons.
      * NOTE: the carrier frequency is imported from the QD input
@@ -140,41 +318,728 @@ class QdChannelModel : public MatrixBasedChannelModel
     double GetFrequency(void) const;
 
     /**
-     * Get the total simulation time
+     * Get the total simulation time, i.e., the duration of the loaded time window
      * \return the simulation time considered in the qd files
      */
     Time GetQdSimTime() const;
 
+    /**
+     * Get the number of timesteps of the QD traces in the loaded time window
+     * \return the number of timesteps
+     */
+    uint32_t GetNumTimesteps() const;
+
+    /**
+     * Get the duration of a timestep, i.e., the channel update period
+     * \return the duration of a timestep
+     */
+    Time GetUpdatePeriod() const;
+
+    /**
+     * Check whether the QD traces contain the channel between two nodes
+     *
+     * \param aNodeId ns-3 ID of the a node
+     * \param bNodeId ns-3 ID of the b node
+     * \return true if the channel between the two nodes is available
+     */
+    bool IsLinkAvailable(uint32_t aNodeId, uint32_t bNodeId) const;
+
+    /**
+     * Check whether the channel between two devices is pruned at the current timestep,
+     * i.e., whether the strongest ray of the QD traces is below the PathGainThreshold
+     * attribute. The channel of a pruned link has no rays, thus its matrix has no pages
+     * and its beamformed gains are empty, and can be skipped by the caller
+     *
+     * \param aMob mobility model of the a device
+     * \param bMob mobility model of the b device
+     * \return true if the link is pruned
+     */
+    bool IsLinkPruned(Ptr<const MobilityModel> aMob, Ptr<const MobilityModel> bMob) const;
+
+    /**
+     * Get the wall-clock time spent reading each input file of the current scenario
+     *
+     * \return the list of (file name, load time [s]) pairs, in reading order
+     */
+    const std::vector<std::pair<std::string, double>>& GetFileLoadTimes() const;
+
+    /**
+     * Report on the loading of the current scenario and on the memory used by the model.
+     * Memory sizes include an estimate of the overhead of a typical heap allocator, i.e.,
+     * 8 bytes of header per block and 16-byte alignment
+     */
+    struct LoadReport
+    {
+        double paraCfgTime{0};          //!< wall-clock time spent in ReadParaCfgFile [s]
+        double nodesPositionTime{0};    //!< wall-clock time spent in ReadNodesPosition [s]
+        double qdFilesTime{0};          //!< wall-clock time spent in ReadQdFiles [s]
+        uint64_t paraCfgBytes{0};       //!< bytes read by ReadParaCfgFile
+        uint64_t nodesPositionBytes{0}; //!< bytes read by ReadNodesPosition
+        uint64_t qdFilesBytes{0};       //!< bytes read by ReadQdFiles
+        std::vector<std::pair<std::string, double>> fileLoadTimes; //!< load time of each file [s]
+        uint64_t numTimesteps{0};         //!< total number of timesteps over all node pairs
+        uint64_t numMpcs{0};              //!< total number of MPCs over all node pairs
+        uint64_t qdInfoPayloadBytes{0};   //!< memory of the MPC values of the QD information
+        uint64_t qdInfoContainerBytes{0}; //!< memory of the containers of the QD information
+        uint64_t qdInfoOverheadBytes{0};  //!< allocator overhead of the QD information
+        std::map<std::pair<uint32_t, uint32_t>, uint64_t>
+            qdInfoBytesPerPair;              //!< memory of the QD information of each node pair
+        uint64_t channelMapBytes{0};         //!< memory of the cached channel matrices
+        uint64_t channelParamsMapBytes{0};   //!< memory of the cached channel parameters
+        uint64_t peakChannelMapBytes{0};     //!< peak memory of the cached channel matrices
+        uint64_t peakChannelParamsMapBytes{0}; //!< peak memory of the cached channel parameters
+    };
+
+    /**
+     * Get the report on the loading of the current scenario, including the current and
+     * peak memory used by the cached channels
+     *
+     * \return the load report
+     */
+    const LoadReport& GetLoadReport() const;
+
+    /**
+     * Block until the QD files loaded in the background, if any, have been completely read.
+     * GetChannel does not need to call it, as it only waits for the timestep it needs
+     */
+    void WaitForLoadingCompletion() const;
+
+    /**
+     * Print the load report in a human-readable format
+     *
+     * \param os the output stream
+     */
+    void PrintLoadReport(std::ostream& os) const;
+
+    /**
+     * TracedCallback signature for the generation of a channel matrix
+     *
+     * \param [in] aNodeId ns-3 ID of the a node
+     * \param [in] bNodeId ns-3 ID of the b node
+     * \param [in] latency wall-clock time spent generating the channel matrix
+     */
+    typedef void (*ChannelRegeneratedTracedCallback)(uint32_t aNodeId,
+                                                     uint32_t bNodeId,
+                                                     Time latency);
+
+    /**
+     * TracedCallback signature for the computation of beamforming vectors
+     *
+     * \param [in] latency wall-clock time spent computing the beamforming vectors
+     */
+    typedef void (*BeamformingComputedTracedCallback)(Time latency);
+
+    /**
+     * Runtime statistics of the channel model
+     */
+    struct Stats
+    {
+        uint64_t getChannelCalls{0}; //!< number of GetChannel calls
+        uint64_t cacheHits{0};       //!< number of GetChannel calls served by the cache
+        uint64_t regenerations{0};   //!< number of channel matrices generated
+        uint64_t paramsMisses{0};    //!< number of GetParams calls not finding the parameters
+        uint64_t beamformedRaysHits{0};   //!< number of beamformed gains served by the cache
+        uint64_t beamformedRaysMisses{0}; //!< number of beamformed gains computed
+        uint64_t diskCacheHits{0};   //!< number of channel matrices read from the disk cache
+        uint64_t diskCacheWrites{0}; //!< number of channel matrices written to the disk cache
+        uint64_t prunedChannels{0};  //!< number of channel matrices skipped by the threshold
+        uint64_t prunedBeamformedRays{0}; //!< number of beamformed gains skipped by the threshold
+        uint64_t reusedChannels{0}; //!< number of channels generated in the link's retired buffers
+        uint64_t pooledChannels{0}; //!< number of channels generated in pooled buffers
+        QdLatencyHistogram newChannelLatency; //!< wall-clock latency of GetNewChannel
+        uint64_t beamformingComputations{0}; //!< number of beamforming vectors computed
+        uint64_t beamformingCacheHits{0}; //!< number of memoized beamforming vectors returned
+        QdLatencyHistogram beamformingLatency; //!< wall-clock latency of the beamforming
+        std::map<std::pair<uint32_t, uint32_t>, uint64_t>
+            linkRegenerations; //!< number of regenerations of each link, by node IDs
+    };
+
+    /**
+     * Get the runtime statistics collected since the creation of the model or the
+     * last call to ResetStats
+     *
+     * \return the runtime statistics
+     */
+    Stats GetStats() const;
+
+    /**
+     * Print the runtime statistics in a human-readable format
+     *
+     * \param os the output stream
+     */
+    void PrintStats(std::ostream& os) const;
+
+    /**
+     * Reset the runtime statistics
+     */
+    void ResetStats();
+
+    /**
+     * Record a beamforming computation in the runtime statistics.
+     * Called by the beamformers attached to the model, e.g., see
+     * SvdBeamformer::SetChannelModel, possibly from several threads
+     *
+     * \param cacheHit whether memoized beamforming vectors were returned
+     * \param latency wall-clock time spent computing the beamforming vectors
+     */
+    void NotifyBeamforming(bool cacheHit, Time latency);
+
+    /**
+     * Channel matrix generated by QdChannelModel.
+     * The buffers of the retired channels are reused, and a channel may be regenerated at
+     * the same simulation time, e.g., at a scenario switch, so neither the address nor the
+     * generation time identify a realization of the channel, while m_realizationId does
+     */
+    struct QdChannelMatrix : public MatrixBasedChannelModel::ChannelMatrix
+    {
+        uint64_t m_realizationId{0}; //!< ID of the realization, unique within the process
+    };
+
+    /**
+     * Decomposition of the channel matrix into its rays, i.e.,
+     * H(b, a) = sum_k m_rayGain[k] * m_bSteering(b, k) * m_aSteering(a, k),
+     * where the complex gain of each ray includes the path gain, the phase, and the
+     * element field patterns of both devices
+     */
+    struct ChannelRays : public SimpleRefCount<ChannelRays>
+    {
+        std::vector<std::complex<double>> m_rayGain; //!< complex gain of each ray
+        MatrixBasedChannelModel::Complex2DVector
+            m_aSteering; //!< steering vectors of the a device, aSize x numRays
+        MatrixBasedChannelModel::Complex2DVector
+            m_bSteering;             //!< steering vectors of the b device, bSize x numRays
+        std::vector<double> m_delay; //!< delay of each ray [s]
+    };
+
+    /**
+     * Get the rays composing the channel between the nodes with mobility objects
+     * passed as input parameters, for the current timestep.
+     * This allows combining the channel with arbitrary beamforming vectors without
+     * building the channel matrix.
+     *
+     * \param aMob mobility model of the a device
+     * \param bMob mobility model of the b device
+     * \param aAntenna antenna of the a device
+     * \param bAntenna antenna of the b device
+     * \return the channel rays
+     */
+    Ptr<const ChannelRays> GetChannelRays(Ptr<const MobilityModel> aMob,
+                                          Ptr<const MobilityModel> bMob,
+                                          Ptr<const PhasedArrayModel> aAntenna,
+                                          Ptr<const PhasedArrayModel> bAntenna) const;
+
+    /**
+     * Get the rays composing the channel between two nodes for a given timestep.
+     * Since it does not depend on the simulation time nor on the aggregation of the
+     * nodes, this method can be called concurrently from multiple threads, e.g., to
+     * process the traces offline, as long as each thread uses its own antenna objects.
+     *
+     * \param aNodeId ns-3 ID of the a node
+     * \param bNodeId ns-3 ID of the b node
+     * \param aAntenna antenna of the a device
+     * \param bAntenna antenna of the b device
+     * \param timestep the QD timestep
+     * \return the channel rays
+     */
+    Ptr<const ChannelRays> GetChannelRays(uint32_t aNodeId,
+                                          uint32_t bNodeId,
+                                          Ptr<const PhasedArrayModel> aAntenna,
+                                          Ptr<const PhasedArrayModel> bAntenna,
+                                          uint64_t timestep) const;
+
+    /**
+     * Beamformed gains of the rays of a link, for a QD timestep and a pair of beamforming
+     * vectors, see GetBeamformedRays
+     */
+    struct BeamformedRays
+    {
+        uint64_t m_timestep{0};                    //!< QD timestep of the rays
+        uint32_t m_aNodeId{0};                     //!< ns-3 ID of the a node
+        uint32_t m_aAntennaId{0};                  //!< ID of the antenna of the a device
+        uint32_t m_bAntennaId{0};                  //!< ID of the antenna of the b device
+        uint64_t m_aWeightsHash{0};                //!< fingerprint of the a beamforming vector
+        uint64_t m_bWeightsHash{0};                //!< fingerprint of the b beamforming vector
+        std::vector<std::complex<double>> m_gains; //!< beamformed complex gain of each ray
+        std::vector<double> m_delay;               //!< delay of each ray [s]
+    };
+
+    /**
+     * Get the beamformed gains of the rays of the channel between the nodes with mobility
+     * objects passed as input parameters, for the current timestep, see
+     * GetBeamformedRayGains.
+     * The gains are cached for each link and direction, and recomputed only when the
+     * timestep, the antennas, or the fingerprint of either beamforming vector change.
+     * The returned object is never modified, thus its address identifies the gains as long
+     * as it is held, allowing callers to cache quantities derived from them.
+     *
+     * \param aMob mobility model of the a device
+     * \param bMob mobility model of the b device
+     * \param aAntenna antenna of the a device
+     * \param bAntenna antenna of the b device
+     * \param aW beamforming vector of the a device
+     * \param bW beamforming vector of the b device
+     * \return the beamformed gains and the delays of the rays
+     */
+    std::shared_ptr<const BeamformedRays> GetBeamformedRays(
+        Ptr<const MobilityModel> aMob,
+        Ptr<const MobilityModel> bMob,
+        Ptr<const PhasedArrayModel> aAntenna,
+        Ptr<const PhasedArrayModel> bAntenna,
+        const PhasedArrayModel::ComplexVector& aW,
+        const PhasedArrayModel::ComplexVector& bW) const;
+
+    /**
+     * Compute a 64-bit fingerprint of a beamforming vector, i.e., the FNV-1a hash of
+     * the bit patterns of its entries
+     *
+     * \param w the beamforming vector
+     * \return the fingerprint
+     */
+    static uint64_t GetBeamformingVectorHash(const PhasedArrayModel::ComplexVector& w);
+
+    /**
+     * Compute the beamformed complex gain of each ray of the channel between the nodes
+     * with mobility objects passed as input parameters, for the current timestep, i.e.,
+     * g_k (bW^T b_k) (a_k^T aW), where g_k is the complex gain of the k-th ray and a_k, b_k
+     * are its steering vectors.
+     * The cost is O(K (Na + Nb)), as the channel matrix is never built, and the gains are
+     * cached as described in GetBeamformedRays.
+     *
+     * \param aMob mobility model of the a device
+     * \param bMob mobility model of the b device
+     * \param aAntenna antenna of the a device
+     * \param bAntenna antenna of the b device
+     * \param aW beamforming vector of the a device
+     * \param bW beamforming vector of the b device
+     * \return the beamformed complex gain of each ray
+     */
+    std::vector<std::complex<double>> GetBeamformedRayGains(
+        Ptr<const MobilityModel> aMob,
+        Ptr<const MobilityModel> bMob,
+        Ptr<const PhasedArrayModel> aAntenna,
+        Ptr<const PhasedArrayModel> bAntenna,
+        const PhasedArrayModel::ComplexVector& aW,
+        const PhasedArrayModel::ComplexVector& bW) const;
+
+    /**
+     * Compute the beamformed complex gain of the channel between the nodes with mobility
+     * objects passed as input parameters, for the current timestep, grouping the rays in
+     * delay bins. The k-th ray falls in the bin floor(delay_k / binWidth).
+     * See GetBeamformedRayGains.
+     *
+     * \param aMob mobility model of the a device
+     * \param bMob mobility model of the b device
+     * \param aAntenna antenna of the a device
+     * \param bAntenna antenna of the b device
+     * \param aW beamforming vector of the a device
+     * \param bW beamforming vector of the b device
+     * \param binWidth the width of the delay bins
+     * \return the beamformed complex gain of each delay bin, up to the last non-empty one
+     */
+    std::vector<std::complex<double>> GetBeamformedDelayBinGains(
+        Ptr<const MobilityModel> aMob,
+        Ptr<const MobilityModel> bMob,
+        Ptr<const PhasedArrayModel> aAntenna,
+        Ptr<const PhasedArrayModel> bAntenna,
+        const PhasedArrayModel::ComplexVector& aW,
+        const PhasedArrayModel::ComplexVector& bW,
+        Time binWidth) const;
+
+    /**
+     * Get the delay of each ray of the channel between the nodes with mobility objects
+     * passed as input parameters, for the current timestep, in the same order as the
+     * gains returned by GetBeamformedRayGains
+     *
+     * \param aMob mobility model of the a device
+     * \param bMob mobility model of the b device
+     * \return the delay of each ray [s]
+     */
+    std::vector<double> GetRayDelays(Ptr<const MobilityModel> aMob,
+                                     Ptr<const MobilityModel> bMob) const;
+
   private:
     using RtIdToNs3IdMap_t = std::map<uint32_t, uint32_t>;
     using Ns3IdToRtIdMap_t = std::map<uint32_t, uint32_t>;
 
+    /*
+     * Structure containing information parsed from QdFiles
+     */
+    struct QdInfo
+    {
+        uint64_t numMpcs;
+        std::vector<double> delay_s;
+        std::vector<double> pathGain_dbpow;
+        std::vector<double> phase_rad;
+        std::vector<double> elAod_rad;
+        std::vector<double> azAod_rad;
+        std::vector<double> elAoa_rad;
+        std::vector<double> azAoa_rad;
+    };
+
+    using QdInfoMap_t = std::map<uint32_t, std::vector<QdInfo>>;
+
+    /**
+     * Data imported from the files of a scenario
+     */
+    struct ScenarioData
+    {
+        uint32_t totTimesteps{0};  //!< number of timesteps of the loaded window
+        Time totalTimeDuration;    //!< duration of the loaded window
+        Time updatePeriod;         //!< duration of a timestep
+        uint32_t firstTimestep{0}; //!< first timestep of the traces in the loaded window
+        Time startOffset;          //!< trace time corresponding to the start of the scenario
+        double frequency{0};      //!< the operating frequency [Hz]
+        std::vector<Vector3D> nodePositionList; //!< initial position of each node
+        Ns3IdToRtIdMap_t ns3IdToRtIdMap; //!< conversion from ns-3 node id to qd-realization node id
+        QdInfoMap_t qdInfoMap;           //!< QD-related information for each node pair
+        LoadReport report;               //!< timing and memory accounting of the loading
+        std::set<uint32_t> localNodeIds; //!< ns-3 IDs of the nodes owned by this system
+    };
+
+    /**
+     * Read paraCfgCurrent.txt file and imports the scenario configuration
+     *
+     * \param folder the scenario folder, including the path
+     * \param data the scenario data to fill
+     */
+    void ReadParaCfgFile(const std::string& folder, ScenarioData& data);
+
+    /**
+     * Channel of a link, published by the thread that generated it and never modified
+     * while published, so that it can be read without locking. Once retired, its buffers
+     * are only reused when no one else holds them
+     */
+    struct LinkChannel
+    {
+        Ptr<QdChannelMatrix> matrix;                        //!< the channel matrix
+        Ptr<MatrixBasedChannelModel::ChannelParams> params; //!< the channel parameters
+        uint64_t timestep{0};                               //!< QD timestep of the channel
+        mutable std::atomic<bool> lent{
+            false}; //!< whether the matrix or the parameters were returned as ns-3 pointers,
+                    //!< whose non-atomic reference counts only the simulation thread reads
+    };
+
+    /**
+     * Runtime statistics of a link, updated by the threads requesting it and aggregated by
+     * GetStats, so that the threads working on different links do not share any counter
+     */
+    struct LinkStats
+    {
+        std::atomic<uint64_t> getChannelCalls{0};      //!< number of GetChannel calls
+        std::atomic<uint64_t> cacheHits{0};            //!< number of GetChannel cache hits
+        std::atomic<uint64_t> beamformedRaysHits{0};   //!< number of beamformed gains cache hits
+        std::atomic<uint64_t> beamformedRaysMisses{0}; //!< number of beamformed gains computed
+        std::atomic<uint64_t> prunedBeamformedRays{0}; //!< number of pruned beamformed gains
+        // the following ones are protected by the regeneration mutex of the link
+        uint32_t aNodeId{0};           //!< ns-3 ID of the a node of the last regeneration
+        uint32_t bNodeId{0};           //!< ns-3 ID of the b node of the last regeneration
+        uint64_t regenerations{0};     //!< number of channel matrices generated
+        uint64_t diskCacheHits{0};     //!< number of channels read from the disk cache
+        uint64_t diskCacheWrites{0};   //!< number of channels written to the disk cache
+        uint64_t prunedChannels{0};    //!< number of channels skipped by the threshold
+        uint64_t reusedChannels{0};    //!< number of channels in the link's retired buffers
+        uint64_t pooledChannels{0};    //!< number of channels in pooled buffers
+        QdLatencyHistogram newChannelLatency; //!< wall-clock latency of GetNewChannel
+    };
+
     /**
-     * Read paraCfgCurrent.txt file and imports necessary member variables
+     * Buffers reused by the regenerations of a link, i.e., the ray decomposition of the
+     * channel and the geometry of its antennas, defined in the implementation file
      */
-    void ReadParaCfgFile(void);
+    struct RegenerationScratch;
+
+    /**
+     * Cache slot of a link. The slots of all the loaded links are created when the
+     * scenario is installed, so that the map of the slots is never modified while
+     * the channels are requested
+     */
+    struct LinkSlot
+    {
+        std::shared_ptr<const LinkChannel>
+            channel; //!< current channel, only accessed with std::atomic_load/store
+        std::mutex regenerationMutex; //!< serializes the regeneration of the channel
+        LinkStats stats;              //!< runtime statistics of the link
+        std::shared_ptr<const BeamformedRays>
+            beamformedRays[2]; //!< beamformed gains for each direction, from the node with the
+                               //!< lower and the higher ID, only accessed atomically
+        std::shared_ptr<LinkChannel>
+            spare; //!< channel retired by the previous regeneration, no longer published, whose
+                   //!< buffers are reused by the next one, protected by regenerationMutex
+        std::unique_ptr<RegenerationScratch>
+            scratch; //!< buffers of the regenerations, protected by regenerationMutex
+        std::atomic<uint64_t> loadedTimesteps{
+            0}; //!< number of timesteps of the link read by the asynchronous loading, which
+                //!< may be ahead of those of all the links
+    };
 
     /**
      * Get the channel matrix between a and b using the ray tracer data
      *
-     * \param aMob mobility model of the a device
-     * \param bMob mobility model of the b device
+     * \param aId ns-3 ID of the a node
+     * \param bId ns-3 ID of the b node
      * \param aAntenna antenna of the a device
      * \param bAntenna antenna of the b device
-     * \return the channel matrix
+     * \param timestep the QD timestep
+     * \param slot the cache slot of the link, whose regeneration mutex must be held, providing
+     *        the buffers of the new channel, see AcquireChannelBuffers
+     * \return the channel matrix and parameters
+     */
+    std::shared_ptr<const LinkChannel> GetNewChannel(uint32_t aId,
+                                                     uint32_t bId,
+                                                     const Ptr<const PhasedArrayModel>& aAntenna,
+                                                     const Ptr<const PhasedArrayModel>& bAntenna,
+                                                     uint64_t timestep,
+                                                     LinkSlot& slot);
+
+    /**
+     * Get the buffers where a new channel of a link is generated. If ReuseChannelBuffers
+     * is enabled, these are the buffers of the channel retired by the previous
+     * regeneration of the link, or of a pooled channel with the same dimensions, provided
+     * that no one else still holds its matrix or parameters; otherwise, new buffers are
+     * allocated. As the channel matrix cannot change its number of pages in place, the
+     * retired channel of the link is only preferred to a pooled one if it has the same
+     * number of rays
+     *
+     * \param slot the cache slot of the link, whose regeneration mutex must be held
+     * \param bSize number of elements of the antenna of the b device
+     * \param aSize number of elements of the antenna of the a device
+     * \param numPages number of pages of the channel matrix, i.e., of rays
+     * \return the buffers of the new channel
+     */
+    std::shared_ptr<LinkChannel> AcquireChannelBuffers(LinkSlot& slot,
+                                                       uint64_t bSize,
+                                                       uint64_t aSize,
+                                                       uint64_t numPages);
+
+    /**
+     * Add a retired channel to the pool, so that its buffers can be reused by any link
+     * with the same dimensions once no one else holds them. The pool holds at most one
+     * channel for each loaded link, dropping the oldest one with the same dimensions when
+     * full
+     *
+     * \param channel the retired channel
+     */
+    void ReleaseChannelBuffers(std::shared_ptr<LinkChannel> channel);
+
+    /**
+     * Get the channel of a link, from its cache slot if up to date, or generating it
+     * otherwise. It does not copy any ns-3 pointer, so that it can be called by concurrent
+     * threads
+     *
+     * \param aId ns-3 ID of the a node
+     * \param bId ns-3 ID of the b node
+     * \param slot the cache slot of the link, or nullptr if the link is not loaded
+     * \param aAntenna antenna of the a device
+     * \param bAntenna antenna of the b device
+     * \return the channel matrix and parameters
+     */
+    std::shared_ptr<const LinkChannel> GetLinkChannel(
+        uint32_t aId,
+        uint32_t bId,
+        LinkSlot* slot,
+        const Ptr<const PhasedArrayModel>& aAntenna,
+        const Ptr<const PhasedArrayModel>& bAntenna);
+
+    /**
+     * Get the channel published in the cache slot of a link, without updating it
+     *
+     * \param slot the cache slot of the link, or nullptr if the link is not loaded
+     * \return the channel, or nullptr if not found
+     */
+    std::shared_ptr<const LinkChannel> GetPublishedChannel(LinkSlot* slot) const;
+
+    /**
+     * Get the cache slot of a resolved link, looking it up again if the link slots have
+     * been rebuilt since the handle was resolved
+     *
+     * \param handle the link handle
+     * \return the slot, or nullptr if the link is not loaded
+     */
+    LinkSlot* GetLinkSlot(const LinkHandle& handle) const;
+
+    /**
+     * Add the runtime statistics of the links of the current scenario to the given ones
+     *
+     * \param [in,out] stats the statistics
+     */
+    void AddLinkStats(Stats& stats) const;
+
+    /**
+     * Check whether the caller is the thread running the simulation, which is the only one
+     * firing the trace sources
+     *
+     * \return true if called by the thread running the simulation
+     */
+    bool IsSimulationThread() const;
+
+    /**
+     * Get the cache slot of a link
+     *
+     * \param aId ns-3 ID of the a node
+     * \param bId ns-3 ID of the b node
+     * \return the slot, or nullptr if the link is not loaded
+     */
+    LinkSlot* GetLinkSlot(uint32_t aId, uint32_t bId) const;
+
+    /**
+     * Get the ns-3 ID of the node of a mobility model, without accessing the
+     * aggregation list of the matched nodes, which is not thread safe
+     *
+     * \param mob the mobility model
+     * \return the node ID
+     */
+    uint32_t GetNodeId(const Ptr<const MobilityModel>& mob) const;
+
+    /**
+     * Compute the complex gain of a ray, including the path gain, the phase, and the
+     * element field patterns of both devices
+     *
+     * \param qdInfo the QD information of the link for the timestep of interest
+     * \param mpcIndex the index of the ray
+     * \param aAntenna antenna of the a device
+     * \param bAntenna antenna of the b device
+     * \return the complex gain of the ray
      */
-    Ptr<MatrixBasedChannelModel::ChannelMatrix> GetNewChannel(Ptr<const MobilityModel> aMob,
-                                                              Ptr<const MobilityModel> bMob,
-                                                              Ptr<const PhasedArrayModel> aAntenna,
-                                                              Ptr<const PhasedArrayModel> bAntenna);
+    std::complex<double> ComputeRayGain(const QdInfo& qdInfo,
+                                        uint64_t mpcIndex,
+                                        const Ptr<const PhasedArrayModel>& aAntenna,
+                                        const Ptr<const PhasedArrayModel>& bAntenna) const;
 
     /**
-     * Check if the channel matrix has to be updated
-     * \param channelMatrix channel matrix
-     * \return true if the channel matrix has to be updated, false otherwise
+     * Compute the beamformed complex gain of each ray, see GetBeamformedRayGains
+     *
+     * \param qdInfo the QD information of the link for the timestep of interest
+     * \param aAntenna antenna of the a device
+     * \param bAntenna antenna of the b device
+     * \param aW beamforming vector of the a device
+     * \param bW beamforming vector of the b device
+     * \return the beamformed complex gain of each ray
      */
-    bool ChannelMatrixNeedsUpdate(
-        Ptr<const MatrixBasedChannelModel::ChannelMatrix> channelMatrix) const;
+    std::vector<std::complex<double>> ComputeBeamformedRayGains(
+        const QdInfo& qdInfo,
+        const Ptr<const PhasedArrayModel>& aAntenna,
+        const Ptr<const PhasedArrayModel>& bAntenna,
+        const PhasedArrayModel::ComplexVector& aW,
+        const PhasedArrayModel::ComplexVector& bW) const;
+
+    /**
+     * Compute the ray decomposition of the channel for the given QD information
+     *
+     * \param qdInfo the QD information of the link for the timestep of interest
+     * \param aAntenna antenna of the a device
+     * \param bAntenna antenna of the b device
+     * \return the channel rays
+     */
+    Ptr<ChannelRays> ComputeChannelRays(const QdInfo& qdInfo,
+                                        const Ptr<const PhasedArrayModel>& aAntenna,
+                                        const Ptr<const PhasedArrayModel>& bAntenna) const;
+
+    /**
+     * Compute the ray decomposition of the channel for the given QD information into the
+     * buffers of a link, which keep their capacity across the regenerations. The steering
+     * vectors are stored column-major, i.e., those of each ray are contiguous
+     *
+     * \param qdInfo the QD information of the link for the timestep of interest
+     * \param aAntenna antenna of the a device
+     * \param bAntenna antenna of the b device
+     * \param [in,out] scratch the buffers of the link, including the cached array geometries
+     */
+    void ComputeChannelRays(const QdInfo& qdInfo,
+                            const Ptr<const PhasedArrayModel>& aAntenna,
+                            const Ptr<const PhasedArrayModel>& bAntenna,
+                            RegenerationScratch& scratch) const;
+
+    /**
+     * Set the file where the runtime statistics are written at Simulator::Destroy
+     *
+     * \param statsFile the file name, or an empty string to disable the output
+     */
+    void SetStatsFile(std::string statsFile);
+
+    /**
+     * Get the file where the runtime statistics are written at Simulator::Destroy
+     *
+     * \return the file name
+     */
+    std::string GetStatsFile() const;
+
+    /**
+     * Write the runtime statistics to the statistics file
+     */
+    void DumpStats() const;
+
+    /**
+     * Set the file where the load report is written at Simulator::Destroy
+     *
+     * \param loadReportFile the file name, or an empty string to disable the output
+     */
+    void SetLoadReportFile(std::string loadReportFile);
+
+    /**
+     * Get the file where the load report is written at Simulator::Destroy
+     *
+     * \return the file name
+     */
+    std::string GetLoadReportFile() const;
+
+    /**
+     * Write the load report to the load report file
+     */
+    void DumpLoadReport() const;
+
+    /**
+     * Account the memory used by the QD information of a node pair in a load report
+     *
+     * \param aNodeId ns-3 ID of the a node
+     * \param bNodeId ns-3 ID of the b node
+     * \param qdInfoVector the QD information of the node pair
+     * \param report the load report
+     */
+    static void AccountQdInfoMemory(uint32_t aNodeId,
+                                    uint32_t bNodeId,
+                                    const std::vector<QdInfo>& qdInfoVector,
+                                    LoadReport& report);
+
+    /**
+     * Update the memory accounting of the cached channels when a cached object is
+     * replaced
+     *
+     * \param oldBytes memory of the replaced object, 0 if none
+     * \param newBytes memory of the new object
+     * \param current the current memory of the cache
+     * \param peak the peak memory of the cache
+     */
+    static void UpdateCacheMemory(uint64_t oldBytes,
+                                  uint64_t newBytes,
+                                  uint64_t& current,
+                                  uint64_t& peak);
+
+    /**
+     * Get the QD information of a link, aborting if it is not available
+     *
+     * \param aNodeId ns-3 ID of the a node
+     * \param bNodeId ns-3 ID of the b node
+     * \param timestep the QD timestep
+     * \return the QD information of the link at the given timestep
+     */
+    const QdInfo& GetQdInfo(uint32_t aNodeId, uint32_t bNodeId, uint64_t timestep) const;
+
+    /**
+     * Check whether the strongest ray of a link is below the PathGainThreshold attribute.
+     * Links without rays are not considered pruned, as their channel is empty anyway
+     *
+     * \param qdInfo the QD information of the link at a timestep
+     * \return true if the synthesis of the channel can be skipped
+     */
+    bool IsBelowPathGainThreshold(const QdInfo& qdInfo) const;
+
+    /**
+     * Check if the channel of a link has to be updated
+     * \param channel channel of the link
+     * \param timestep the current QD timestep
+     * \return true if the channel has to be updated, false otherwise
+     */
+    bool ChannelMatrixNeedsUpdate(const LinkChannel& channel, uint64_t timestep) const;
 
     /**
      * Get qd-channel time-step of current time
@@ -195,15 +1060,135 @@ class QdChannelModel : public MatrixBasedChannelModel
     void ReadAllInputFiles();
 
     /**
-     * Read all NodesPosition for the given scenario
+     * Read all NodesPosition for the given scenario and match them to the ns-3 nodes
+     *
+     * \param folder the scenario folder, including the path
+     * \param data the scenario data to fill
+     * \return a map between user file name to ns-3 user ID
      */
-    RtIdToNs3IdMap_t ReadNodesPosition(void);
+    RtIdToNs3IdMap_t ReadNodesPosition(const std::string& folder, ScenarioData& data);
 
     /**
-     * Read all QdFiles for the given scenario
+     * Read all QdFiles for the given scenario, stopping after the current file if the
+     * loading is cancelled
+     * \param folder the scenario folder, including the path
      * \param rtIdToNs3IdMap a map between user file name to ns-3 user ID
+     * \param data the scenario data to fill
      */
-    void ReadQdFiles(RtIdToNs3IdMap_t rtIdToNs3IdMap);
+    void ReadQdFiles(const std::string& folder,
+                     const RtIdToNs3IdMap_t& rtIdToNs3IdMap,
+                     ScenarioData& data);
+
+    /**
+     * Get the ns-3 IDs of the nodes of a QD file, and check whether the file has to be
+     * loaded, according to the node subset and the partitioning of the scenario
+     *
+     * \param fileName the QD file name, including the path
+     * \param rtIdToNs3IdMap a map between user file name to ns-3 user ID
+     * \param data the scenario data
+     * \param [out] nodeIdTx the ns-3 ID of the transmitter
+     * \param [out] nodeIdRx the ns-3 ID of the receiver
+     * \return true if the file has to be loaded
+     */
+    bool GetQdFileNodes(const std::string& fileName,
+                        const RtIdToNs3IdMap_t& rtIdToNs3IdMap,
+                        const ScenarioData& data,
+                        uint32_t& nodeIdTx,
+                        uint32_t& nodeIdRx) const;
+
+    /**
+     * Read the QD information of a timestep from a QD file
+     *
+     * \param qdFile the QD file, positioned at the start of the timestep
+     * \param fileName the QD file name, for the error messages
+     * \param timestep the timestep of the traces, for the error messages
+     * \param parse if false, the timestep is skipped without parsing its values
+     * \param [out] qdInfo the QD information of the timestep
+     * \return false if the end of the file has been reached
+     */
+    bool ReadQdInfo(std::istream& qdFile,
+                    const std::string& fileName,
+                    uint64_t timestep,
+                    bool parse,
+                    QdInfo& qdInfo);
+
+    /**
+     * Account the memory of the nodes of the map of the QD information in a load report
+     *
+     * \param qdInfoMap the map of the QD information
+     * \param report the load report to update
+     */
+    static void AccountQdInfoMapMemory(const QdInfoMap_t& qdInfoMap, LoadReport& report);
+
+    /**
+     * A QD file being loaded in the background
+     */
+    struct AsyncQdFile
+    {
+        std::string fileName;                  //!< the QD file name, including the path
+        uint32_t nodeIdTx{0};                  //!< ns-3 ID of the transmitter
+        uint32_t nodeIdRx{0};                  //!< ns-3 ID of the receiver
+        std::vector<QdInfo>* qdInfoVector{};   //!< the QD information of the link, to fill
+        LinkSlot* slot{};                      //!< cache slot of the link, to publish its progress
+        std::unique_ptr<std::ifstream> stream; //!< the file, if kept open
+        std::streampos position{0};            //!< position of the next timestep, if closed
+        double loadTime{0};                    //!< time spent reading the file [s]
+    };
+
+    /**
+     * Start loading the QD files in the background. The map of the QD information,
+     * with an empty entry for each timestep of each link, must already be installed
+     *
+     * \param folder the scenario folder, including the path
+     * \param rtIdToNs3IdMap a map between user file name to ns-3 user ID
+     * \param data the scenario data, whose links are loaded
+     */
+    void StartAsyncLoading(const std::string& folder,
+                           const RtIdToNs3IdMap_t& rtIdToNs3IdMap,
+                           ScenarioData& data);
+
+    /**
+     * Load the QD files in timestep order, publishing the loaded timesteps of each link
+     * and of all the links after each block, run in a background thread. The blocks are
+     * proportional to the number of timesteps, and a bounded number of files are kept
+     * open between the blocks, while the other ones are reopened at each block.
+     * The loading stops after the current file if it is cancelled
+     *
+     * \param files the QD files to load
+     * \param firstTimestep the first timestep of the traces in the loaded window
+     */
+    void LoadQdFilesAsync(std::vector<AsyncQdFile> files, uint32_t firstTimestep);
+
+    /**
+     * Block until the given timestep of a link has been loaded
+     *
+     * \param slot the cache slot of the link, or nullptr to wait for all the links
+     * \param timestep the timestep
+     */
+    void WaitForTimestep(const LinkSlot* slot, uint64_t timestep) const;
+
+    /**
+     * Replace the current scenario with the given data and invalidate all the
+     * cached channels
+     *
+     * \param data the scenario data, which is moved into the member variables
+     * \param startTime the simulation time corresponding to the first timestep
+     */
+    void InstallScenarioData(ScenarioData& data, Time startTime);
+
+    /**
+     * Compute the hash of the installed scenario, covering the carrier frequency, the
+     * node mapping, and the QD information of all the loaded links and timesteps
+     *
+     * \return the hash
+     */
+    uint64_t GetScenarioHash() const;
+
+    /**
+     * Switch to the scenario loaded by PreloadScenario, waiting for the loading
+     * to complete if needed
+     */
+    void SwitchToPreloadedScenario();
 
     /**
      * Get the list of QD file names in the given path
@@ -224,30 +1209,17 @@ class QdChannelModel : public MatrixBasedChannelModel
 
     /**
      * Trim folder name in order to avoid '/' at the beginning of the file name
-     * and have exactly one '/' at the end
+     * and have exactly one '/' at the end. An empty name is left empty
      *
      * \param folder string containing the folder name
      */
     static void TrimFolderName(std::string& folder);
 
-    /*
-     * Structure containing information parsed from QdFiles
-     */
-    struct QdInfo
-    {
-        uint64_t numMpcs;
-        std::vector<double> delay_s;
-        std::vector<double> pathGain_dbpow;
-        std::vector<double> phase_rad;
-        std::vector<double> elAod_rad;
-        std::vector<double> azAod_rad;
-        std::vector<double> elAoa_rad;
-        std::vector<double> azAoa_rad;
-    };
-
-    std::map<uint32_t, Ptr<MatrixBasedChannelModel::ChannelMatrix>>
-        m_channelMap; //!< map containing the channel realizations indexed by channel key
-    std::map<uint64_t, Ptr<MatrixBasedChannelModel::ChannelParams>> m_channelParamsMap;
+    mutable std::map<uint32_t, LinkSlot>
+        m_linkSlots; //!< map containing the channel realizations indexed by channel key
+    uint64_t m_linkSlotsGeneration; //!< incremented whenever the link slots are rebuilt
+    std::map<const MobilityModel*, uint32_t>
+        m_mobilityNodeIds; //!< ns-3 node IDs of the mobility models of the matched nodes
     Time m_updatePeriod;                      //!< the channel update period
     uint32_t m_totTimesteps;                  //!< total number of timesteps for the simulation
     Time m_totalTimeDuration;                 //!< duration of the simulation
@@ -256,14 +1228,67 @@ class QdChannelModel : public MatrixBasedChannelModel
                                                    as the frequency is parsed from the channel traces instead. */
     std::vector<Vector3D> m_nodePositionList; //!< initial position of each node
 
-    std::map<uint32_t, std::vector<QdInfo>>
-        m_qdInfoMap;                   //!< map containing QD-related information for each node pair
+    QdInfoMap_t m_qdInfoMap;           //!< map containing QD-related information for each node pair
     Ns3IdToRtIdMap_t m_ns3IdToRtIdMap; //!< map containing a conversion from ns-3 node id to
                                        //!< qd-realization node id
+    LoadReport m_loadReport; //!< report on the loading of the current scenario
+    bool m_partitionBySystemId;        //!< whether only the channels of local nodes are loaded
+    std::set<uint32_t> m_localNodeIds; //!< ns-3 IDs of the nodes owned by this system
+    bool m_loadMatchedNodesOnly;       //!< whether unmatched positions are ignored
+    Time m_windowStartOffset;          //!< trace time of the start of the window to load
+    Time m_windowDuration;             //!< duration of the window to load, 0 until the end
+    uint32_t m_firstTimestep;          //!< first timestep of the traces in the loaded window
+    Time m_startOffset;                //!< trace time corresponding to the start of the scenario
+    std::string m_loadedRtIds;         //!< list of the ray-tracer IDs to load, if not empty
 
     std::string m_path; //!< folder path containing the scenario of interest
     std::string
         m_scenario; //!< scenario folder name, containg the Input/ and the Output/Ns3/ folders
+    Time m_scenarioStartTime; //!< simulation time corresponding to the first timestep
+
+    std::string m_preloadedScenario; //!< scenario folder name of the preloaded scenario
+    std::unique_ptr<ScenarioData> m_preloadedData; //!< data of the preloaded scenario
+    std::future<void> m_preloadFuture; //!< completion of the background loading
+    EventId m_scenarioSwitchEvent;     //!< event switching to the preloaded scenario
+    bool m_asyncLoading;               //!< whether the QD files are loaded in the background
+    uint32_t m_asyncLoadingOpenFiles;  //!< maximum number of QD files kept open while loading
+    std::future<void> m_asyncLoadingFuture; //!< completion of the asynchronous loading
+    std::atomic<bool> m_cancelLoading; //!< whether the background loading must stop, if any
+    std::atomic<uint64_t> m_loadedTimesteps; //!< number of timesteps loaded for all the links
+    bool m_loadingComplete; //!< whether all the QD files have been read, protected by the mutex
+    mutable std::mutex m_loadingMutex; //!< protects the progress of the asynchronous loading
+    mutable std::condition_variable
+        m_loadingCondition; //!< notified when the asynchronous loading makes progress
+
+    mutable std::atomic<uint64_t> m_paramsMisses; //!< number of GetParams misses
+    Stats m_retiredLinkStats; //!< statistics of the links of the previously installed scenarios
+    std::thread::id m_simulationThreadId; //!< thread running the simulation
+    TracedValue<uint64_t>
+        m_getChannelCallsTrace; //!< number of GetChannel calls of the simulation thread
+    TracedValue<uint64_t> m_cacheHitsTrace; //!< number of cache hits of the simulation thread
+    TracedValue<uint64_t>
+        m_regenerationsTrace; //!< number of regenerations of the simulation thread
+    mutable TracedValue<uint64_t>
+        m_paramsMissesTrace; //!< number of GetParams misses of the simulation thread
+    TracedCallback<uint32_t, uint32_t, Time>
+        m_channelRegeneratedTrace; //!< trace fired when a channel matrix is generated
+    TracedCallback<Time>
+        m_beamformingComputedTrace; //!< trace fired when beamforming vectors are computed
+    mutable std::mutex m_beamformingStatsMutex; //!< protects the beamforming statistics
+    Stats m_beamformingStats; //!< statistics of the beamformers attached to the model
+    std::mutex m_statsMutex; //!< protects the load report, including the memory of the channels
+    std::string m_statsFile;       //!< file where the statistics are written at the end
+    EventId m_statsDumpEvent;      //!< event writing the statistics at Simulator::Destroy
+    std::string m_loadReportFile;  //!< file where the load report is written at the end
+    std::string m_channelCacheDirectory; //!< directory of the persistent channel cache
+    double m_pathGainThreshold; //!< path gain of the strongest ray below which links are pruned
+    bool m_reuseChannelBuffers; //!< whether the buffers of the retired channels are reused
+    std::multimap<std::tuple<uint64_t, uint64_t, uint64_t>, std::shared_ptr<LinkChannel>>
+        m_channelPool; //!< retired channels, by rows, columns, and pages of their matrix
+    std::mutex m_channelPoolMutex; //!< protects the pool of the retired channels
+    std::shared_ptr<QdChannelCache>
+        m_channelCache; //!< persistent channel cache of the scenario, if any, accessed atomically
+    EventId m_loadReportDumpEvent; //!< event writing the load report at Simulator::Destroy
 };
 
 } // namespace ns3
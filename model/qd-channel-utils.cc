@@ -23,17 +23,97 @@
 
 #include "ns3/qd-channel-utils.h"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <thread>
+#include <type_traits>
+
 NS_LOG_COMPONENT_DEFINE("QdChannelUtils");
 
 namespace ns3
 {
 
-PhasedArrayModel::ComplexVector
-GetFirstEigenvector(MatrixBasedChannelModel::Complex2DVector A, uint32_t nIter, double threshold)
+namespace
 {
-    uint16_t arraySize = A.GetNumCols();
-    PhasedArrayModel::ComplexVector antennaWeights(arraySize);
-    for (uint16_t eIndex = 0; eIndex < arraySize; eIndex++)
+
+/**
+ * Vector of compile-time size, allocated on the stack
+ */
+template <size_t N>
+using FixedSizeVector = std::array<std::complex<double>, N>;
+
+/**
+ * Get the number of elements of a vector
+ *
+ * \param v the vector
+ * \return the number of elements
+ */
+size_t
+GetVectorSize(const PhasedArrayModel::ComplexVector& v)
+{
+    return v.GetSize();
+}
+
+/**
+ * Get the number of elements of a vector of compile-time size
+ *
+ * \return the number of elements
+ */
+template <size_t N>
+constexpr size_t
+GetVectorSize(const FixedSizeVector<N>& /* v */)
+{
+    return N;
+}
+
+/**
+ * Compute the product between a square matrix and a vector, one row at a time
+ *
+ * \param A the matrix
+ * \param v the vector, either a PhasedArrayModel::ComplexVector or a FixedSizeVector
+ *        with the size of A, in which case the loop bounds are known at compile time
+ * \return the product
+ */
+template <class ComplexVector>
+ComplexVector
+MultiplySquareMatrix(const MatrixBasedChannelModel::Complex2DVector& A, const ComplexVector& v)
+{
+    const size_t size = GetVectorSize(v);
+    const std::complex<double>* a = &A[0];
+    ComplexVector av = v;
+    for (size_t row = 0; row < size; row++)
+    {
+        std::complex<double> sum(0, 0);
+        for (size_t col = 0; col < size; col++)
+        {
+            sum += a[row + col * size] * v[col];
+        }
+        av[row] = sum;
+    }
+    return av;
+}
+
+/**
+ * Compute the eigenvector associated to the largest eigenvalue with the power iteration,
+ * starting from the first row of A, see GetFirstEigenvector
+ *
+ * \param A complex 2D matrix
+ * \param nIter maximum number of iterations
+ * \param threshold difference threshold for consecutive iterations
+ * \return the eigenvector associated to the largest eigenvalue
+ */
+template <class ComplexVector>
+ComplexVector
+IteratePower(const MatrixBasedChannelModel::Complex2DVector& A, uint32_t nIter, double threshold)
+{
+    ComplexVector antennaWeights;
+    if constexpr (std::is_same_v<ComplexVector, PhasedArrayModel::ComplexVector>)
+    {
+        antennaWeights = ComplexVector(A.GetNumCols());
+    }
+    const size_t arraySize = GetVectorSize(antennaWeights);
+    for (size_t eIndex = 0; eIndex < arraySize; eIndex++)
     {
         antennaWeights[eIndex] = A(0, eIndex);
     }
@@ -42,55 +122,73 @@ GetFirstEigenvector(MatrixBasedChannelModel::Complex2DVector A, uint32_t nIter,
     double diff = 1;
     while (iter < nIter && diff > threshold)
     {
-        PhasedArrayModel::ComplexVector antennaWeightsNew(arraySize);
+        ComplexVector antennaWeightsNew = MultiplySquareMatrix(A, antennaWeights);
 
-        for (uint16_t row = 0; row < arraySize; row++)
-        {
-            std::complex<double> sum(0, 0);
-            for (uint16_t col = 0; col < arraySize; col++)
-            {
-                sum += A(row, col) * antennaWeights[col];
-            }
-
-            antennaWeightsNew[row] = sum;
-        }
         // Normalize antennaWeights;
         double weighbSum = 0;
-        for (uint16_t i = 0; i < arraySize; i++)
+        for (size_t i = 0; i < arraySize; i++)
         {
             weighbSum += norm(antennaWeightsNew[i]);
         }
-        for (uint16_t i = 0; i < arraySize; i++)
+        for (size_t i = 0; i < arraySize; i++)
         {
             antennaWeightsNew[i] = antennaWeightsNew[i] / sqrt(weighbSum);
         }
         diff = 0;
-        for (uint16_t i = 0; i < arraySize; i++)
+        for (size_t i = 0; i < arraySize; i++)
         {
             diff += std::norm(antennaWeightsNew[i] - antennaWeights[i]);
         }
         iter++;
         antennaWeights = antennaWeightsNew;
     }
-    // NS_LOG_DEBUG ("antennaWeigths stopped after " << iter << " iterations with diff=" << diff <<
-    // std::endl);
 
     return antennaWeights;
 }
 
-std::pair<PhasedArrayModel::ComplexVector, PhasedArrayModel::ComplexVector>
-ComputeSvdBeamformingVectors(Ptr<const MatrixBasedChannelModel::ChannelMatrix> params)
+/**
+ * Copy a PhasedArrayModel::ComplexVector into a vector of compile-time size
+ *
+ * \param v the vector, with N elements
+ * \return the copy
+ */
+template <size_t N>
+FixedSizeVector<N>
+ToFixedSizeVector(const PhasedArrayModel::ComplexVector& v)
 {
-    // params
-    uint32_t svdIter = 30;
-    double svdThresh = 1e-8;
+    FixedSizeVector<N> copy;
+    std::copy(&v[0], &v[0] + N, copy.begin());
+    return copy;
+}
 
-    // Generate transmitter side spatial correlation matrix
+/**
+ * Copy a vector of compile-time size into a PhasedArrayModel::ComplexVector
+ *
+ * \param v the vector
+ * \return the copy
+ */
+template <size_t N>
+PhasedArrayModel::ComplexVector
+ToComplexVector(const FixedSizeVector<N>& v)
+{
+    PhasedArrayModel::ComplexVector copy(N);
+    std::copy(v.begin(), v.end(), &copy[0]);
+    return copy;
+}
+
+/**
+ * Compute the narrowband channel by summing the channel matrix over the tap index
+ *
+ * \param params the channel matrix
+ * \return the narrowband channel matrix
+ */
+MatrixBasedChannelModel::Complex2DVector
+ComputeNarrowbandChannel(Ptr<const MatrixBasedChannelModel::ChannelMatrix> params)
+{
     uint16_t aSize = params->m_channel.GetNumRows();
     uint16_t bSize = params->m_channel.GetNumCols();
     uint16_t clusterSize = params->m_channel.GetNumPages();
 
-    // Compute narrowband channel by summing over the tap index
     MatrixBasedChannelModel::Complex2DVector narrowbandChannel(aSize, bSize);
 
     for (uint16_t aIndex = 0; aIndex < aSize; aIndex++)
@@ -106,8 +204,21 @@ ComputeSvdBeamformingVectors(Ptr<const MatrixBasedChannelModel::ChannelMatrix> p
         }
     }
 
-    // Compute the transmitter side spatial correlation matrix bQ = H*H, where H is the sum of H_n
-    // over n taps. The * operator is the transponse conjugate
+    return narrowbandChannel;
+}
+
+/**
+ * Compute the transmitter side spatial correlation matrix bQ = H*H.
+ * The * operator is the transponse conjugate
+ *
+ * \param narrowbandChannel the narrowband channel matrix H
+ * \return the spatial correlation matrix
+ */
+MatrixBasedChannelModel::Complex2DVector
+ComputeBCorrelation(const MatrixBasedChannelModel::Complex2DVector& narrowbandChannel)
+{
+    uint16_t aSize = narrowbandChannel.GetNumRows();
+    uint16_t bSize = narrowbandChannel.GetNumCols();
     MatrixBasedChannelModel::Complex2DVector bQ(bSize, bSize);
 
     for (uint16_t b1Index = 0; b1Index < bSize; b1Index++)
@@ -124,11 +235,21 @@ ComputeSvdBeamformingVectors(Ptr<const MatrixBasedChannelModel::ChannelMatrix> p
         }
     }
 
-    // Calculate beamforming vector from spatial correlation matrix
-    PhasedArrayModel::ComplexVector bW = GetFirstEigenvector(bQ, svdIter, svdThresh);
+    return bQ;
+}
 
-    // Compute the receiver side spatial correlation matrix aQ = HH*, where H is the sum of H_n over
-    // n clusters.
+/**
+ * Compute the receiver side spatial correlation matrix aQ = HH*.
+ * The * operator is the transponse conjugate
+ *
+ * \param narrowbandChannel the narrowband channel matrix H
+ * \return the spatial correlation matrix
+ */
+MatrixBasedChannelModel::Complex2DVector
+ComputeACorrelation(const MatrixBasedChannelModel::Complex2DVector& narrowbandChannel)
+{
+    uint16_t aSize = narrowbandChannel.GetNumRows();
+    uint16_t bSize = narrowbandChannel.GetNumCols();
     MatrixBasedChannelModel::Complex2DVector aQ(aSize, aSize);
 
     for (uint16_t a1Index = 0; a1Index < aSize; a1Index++)
@@ -145,6 +266,350 @@ ComputeSvdBeamformingVectors(Ptr<const MatrixBasedChannelModel::ChannelMatrix> p
         }
     }
 
+    return aQ;
+}
+
+/**
+ * Compute the eigenvector associated to the largest eigenvalue of a Hermitian operator
+ * by maximizing the Rayleigh quotient over the plane spanned by the current estimate x
+ * and its residual r = Ax - rho x, where rho = x*Ax.
+ * Since the residual is orthogonal to x, the projection of the operator on the plane is
+ * the real 2x2 matrix [rho, |r|; |r|, q*Aq], with q = r/|r|, whose dominant eigenvector
+ * gives the next estimate. Only one application of the operator per iteration is needed,
+ * since Ax is updated as a linear combination of the previous Ax and Aq.
+ *
+ * \param applyA function computing the product between the operator and a vector
+ * \param x the initial guess, either a PhasedArrayModel::ComplexVector or a FixedSizeVector
+ * \param nIter maximum number of applications of the operator
+ * \param threshold relative residual threshold
+ * \param [out] iterations the number of applications of the operator
+ * \return the eigenvector associated to the largest eigenvalue
+ */
+template <class ComplexVector, class MatVec>
+ComplexVector
+MaximizeRayleighQuotient(MatVec applyA,
+                         ComplexVector x,
+                         uint32_t nIter,
+                         double threshold,
+                         uint32_t& iterations)
+{
+    const size_t size = GetVectorSize(x);
+    iterations = 0;
+
+    double xNorm = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        xNorm += std::norm(x[i]);
+    }
+    if (xNorm == 0)
+    {
+        return x;
+    }
+    xNorm = std::sqrt(xNorm);
+    for (size_t i = 0; i < size; i++)
+    {
+        x[i] /= xNorm;
+    }
+
+    ComplexVector ax = applyA(x);
+    iterations++;
+
+    ComplexVector q = x;
+    while (true)
+    {
+        // Rayleigh quotient and residual of the current estimate
+        double rho = 0;
+        for (size_t i = 0; i < size; i++)
+        {
+            rho += std::real(std::conj(x[i]) * ax[i]);
+        }
+        double rNorm = 0;
+        for (size_t i = 0; i < size; i++)
+        {
+            q[i] = ax[i] - rho * x[i];
+            rNorm += std::norm(q[i]);
+        }
+
+        if (rNorm <= threshold * rho * rho || iterations >= nIter)
+        {
+            break;
+        }
+
+        rNorm = std::sqrt(rNorm);
+        for (size_t i = 0; i < size; i++)
+        {
+            q[i] /= rNorm;
+        }
+        ComplexVector aq = applyA(q);
+        iterations++;
+
+        double d = 0;
+        for (size_t i = 0; i < size; i++)
+        {
+            d += std::real(std::conj(q[i]) * aq[i]);
+        }
+
+        // Dominant eigenvector (c, s) of the projected matrix [rho, rNorm; rNorm, d]
+        double lambda = (rho + d) / 2 + std::hypot((rho - d) / 2, rNorm);
+        double c = rNorm;
+        double s = lambda - rho;
+        double cs = std::hypot(c, s);
+        c /= cs;
+        s /= cs;
+
+        xNorm = 0;
+        for (size_t i = 0; i < size; i++)
+        {
+            x[i] = c * x[i] + s * q[i];
+            ax[i] = c * ax[i] + s * aq[i];
+            xNorm += std::norm(x[i]);
+        }
+        // Compensate for the loss of orthogonality between x and q
+        xNorm = std::sqrt(xNorm);
+        for (size_t i = 0; i < size; i++)
+        {
+            x[i] /= xNorm;
+            ax[i] /= xNorm;
+        }
+    }
+
+    return x;
+}
+
+/**
+ * Compute the dominant right singular vector v of H by iterating on H*(Hv), and derive the
+ * corresponding receive beamforming vector from Hv.
+ *
+ * \param narrowbandChannel the narrowband channel matrix H
+ * \param initialGuess the initial guess for v. If its size does not match the number of
+ *        columns of H, the first row of H*H is used instead
+ * \param nIter maximum number of iterations
+ * \param threshold relative residual threshold
+ * \param [out] iterations the number of iterations
+ * \return the beamforming vectors for the second and first dimension, respectively
+ */
+std::pair<PhasedArrayModel::ComplexVector, PhasedArrayModel::ComplexVector>
+ComputeMatrixFreeSvd(const MatrixBasedChannelModel::Complex2DVector& narrowbandChannel,
+                     const PhasedArrayModel::ComplexVector& initialGuess,
+                     uint32_t nIter,
+                     double threshold,
+                     uint32_t& iterations)
+{
+    uint16_t aSize = narrowbandChannel.GetNumRows();
+    uint16_t bSize = narrowbandChannel.GetNumCols();
+
+    auto applyH = [&narrowbandChannel, aSize, bSize](const PhasedArrayModel::ComplexVector& v) {
+        PhasedArrayModel::ComplexVector hv(aSize);
+        for (uint16_t bIndex = 0; bIndex < bSize; bIndex++)
+        {
+            for (uint16_t aIndex = 0; aIndex < aSize; aIndex++)
+            {
+                hv[aIndex] += narrowbandChannel(aIndex, bIndex) * v[bIndex];
+            }
+        }
+        return hv;
+    };
+
+    auto applyHh = [&narrowbandChannel, aSize, bSize](const PhasedArrayModel::ComplexVector& u) {
+        PhasedArrayModel::ComplexVector hhu(bSize);
+        for (uint16_t bIndex = 0; bIndex < bSize; bIndex++)
+        {
+            std::complex<double> aSum(0, 0);
+            for (uint16_t aIndex = 0; aIndex < aSize; aIndex++)
+            {
+                aSum += std::conj(narrowbandChannel(aIndex, bIndex)) * u[aIndex];
+            }
+            hhu[bIndex] = aSum;
+        }
+        return hhu;
+    };
+
+    PhasedArrayModel::ComplexVector x(bSize);
+    if (initialGuess.GetSize() == bSize)
+    {
+        x = initialGuess;
+    }
+    else
+    {
+        // first row of H*H, i.e., the conjugate of H* applied to the first column of H
+        PhasedArrayModel::ComplexVector firstCol(aSize);
+        for (uint16_t aIndex = 0; aIndex < aSize; aIndex++)
+        {
+            firstCol[aIndex] = narrowbandChannel(aIndex, 0);
+        }
+        x = applyHh(firstCol);
+        for (uint16_t bIndex = 0; bIndex < bSize; bIndex++)
+        {
+            x[bIndex] = std::conj(x[bIndex]);
+        }
+    }
+
+    PhasedArrayModel::ComplexVector bW = MaximizeRayleighQuotient(
+        [&applyH, &applyHh](const PhasedArrayModel::ComplexVector& v) {
+            return applyHh(applyH(v));
+        },
+        x,
+        nIter,
+        threshold,
+        iterations);
+
+    // Hv is proportional to the left singular vector u, and the receive beamforming
+    // vector is its conjugate
+    PhasedArrayModel::ComplexVector aW = applyH(bW);
+    double uNorm = 0;
+    for (uint16_t aIndex = 0; aIndex < aSize; aIndex++)
+    {
+        uNorm += std::norm(aW[aIndex]);
+    }
+    uNorm = std::sqrt(uNorm);
+    if (uNorm > 0)
+    {
+        for (uint16_t aIndex = 0; aIndex < aSize; aIndex++)
+        {
+            aW[aIndex] = std::conj(aW[aIndex]) / uNorm;
+        }
+    }
+
+    return std::make_pair(bW, aW);
+}
+
+/**
+ * Compute the response of each beam of a codebook towards each ray, i.e.,
+ * the product between the beamforming vector and the steering vector of the ray
+ *
+ * \param steering the steering vectors, arraySize x numRays
+ * \param codebook the codebook
+ * \param numThreads the number of threads
+ * \return the responses, indexed as [beam][ray]
+ */
+std::vector<std::vector<std::complex<double>>>
+ComputeBeamResponses(const MatrixBasedChannelModel::Complex2DVector& steering,
+                     const BeamCodebook& codebook,
+                     uint32_t numThreads)
+{
+    size_t arraySize = steering.GetNumRows();
+    size_t numRays = steering.GetNumCols();
+    std::vector<std::vector<std::complex<double>>> responses(
+        codebook.size(),
+        std::vector<std::complex<double>>(numRays));
+
+    ParallelFor(codebook.size(), numThreads, [&](uint32_t beam) {
+        const PhasedArrayModel::ComplexVector& w = codebook[beam];
+        NS_ASSERT_MSG(w.GetSize() == arraySize,
+                      "Beam " << beam << " has size " << w.GetSize() << " instead of "
+                              << arraySize);
+        for (size_t ray = 0; ray < numRays; ray++)
+        {
+            std::complex<double> sum(0, 0);
+            for (size_t eIndex = 0; eIndex < arraySize; eIndex++)
+            {
+                sum += w[eIndex] * steering(eIndex, ray);
+            }
+            responses[beam][ray] = sum;
+        }
+    });
+
+    return responses;
+}
+
+} // namespace
+
+PhasedArrayModel::ComplexVector
+GetFirstEigenvector(MatrixBasedChannelModel::Complex2DVector A, uint32_t nIter, double threshold)
+{
+    // the common array sizes use vectors of compile-time size, on the stack
+    switch (A.GetNumCols())
+    {
+    case 1:
+        return ToComplexVector(IteratePower<FixedSizeVector<1>>(A, nIter, threshold));
+    case 4:
+        return ToComplexVector(IteratePower<FixedSizeVector<4>>(A, nIter, threshold));
+    case 16:
+        return ToComplexVector(IteratePower<FixedSizeVector<16>>(A, nIter, threshold));
+    case 64:
+        return ToComplexVector(IteratePower<FixedSizeVector<64>>(A, nIter, threshold));
+    default:
+        return IteratePower<PhasedArrayModel::ComplexVector>(A, nIter, threshold);
+    }
+}
+
+PhasedArrayModel::ComplexVector
+GetFirstEigenvector(const MatrixBasedChannelModel::Complex2DVector& A,
+                    const PhasedArrayModel::ComplexVector& initialGuess,
+                    uint32_t nIter,
+                    double threshold,
+                    uint32_t& iterations)
+{
+    uint16_t arraySize = A.GetNumCols();
+
+    PhasedArrayModel::ComplexVector x(arraySize);
+    if (initialGuess.GetSize() == arraySize)
+    {
+        x = initialGuess;
+    }
+    else
+    {
+        for (uint16_t eIndex = 0; eIndex < arraySize; eIndex++)
+        {
+            x[eIndex] = A(0, eIndex);
+        }
+    }
+
+    auto applyA = [&A](const auto& v) { return MultiplySquareMatrix(A, v); };
+
+    // the common array sizes use vectors of compile-time size, on the stack
+    switch (arraySize)
+    {
+    case 1:
+        return ToComplexVector(MaximizeRayleighQuotient(applyA,
+                                                        ToFixedSizeVector<1>(x),
+                                                        nIter,
+                                                        threshold,
+                                                        iterations));
+    case 4:
+        return ToComplexVector(MaximizeRayleighQuotient(applyA,
+                                                        ToFixedSizeVector<4>(x),
+                                                        nIter,
+                                                        threshold,
+                                                        iterations));
+    case 16:
+        return ToComplexVector(MaximizeRayleighQuotient(applyA,
+                                                        ToFixedSizeVector<16>(x),
+                                                        nIter,
+                                                        threshold,
+                                                        iterations));
+    case 64:
+        return ToComplexVector(MaximizeRayleighQuotient(applyA,
+                                                        ToFixedSizeVector<64>(x),
+                                                        nIter,
+                                                        threshold,
+                                                        iterations));
+    default:
+        return MaximizeRayleighQuotient(applyA, x, nIter, threshold, iterations);
+    }
+}
+
+std::pair<PhasedArrayModel::ComplexVector, PhasedArrayModel::ComplexVector>
+ComputeSvdBeamformingVectors(Ptr<const MatrixBasedChannelModel::ChannelMatrix> params)
+{
+    // params
+    uint32_t svdIter = 30;
+    double svdThresh = 1e-8;
+
+    // Compute narrowband channel by summing over the tap index
+    MatrixBasedChannelModel::Complex2DVector narrowbandChannel = ComputeNarrowbandChannel(params);
+
+    // Compute the transmitter side spatial correlation matrix bQ = H*H, where H is the sum of H_n
+    // over n taps. The * operator is the transponse conjugate
+    MatrixBasedChannelModel::Complex2DVector bQ = ComputeBCorrelation(narrowbandChannel);
+
+    // Calculate beamforming vector from spatial correlation matrix
+    PhasedArrayModel::ComplexVector bW = GetFirstEigenvector(bQ, svdIter, svdThresh);
+
+    // Compute the receiver side spatial correlation matrix aQ = HH*, where H is the sum of H_n over
+    // n clusters.
+    MatrixBasedChannelModel::Complex2DVector aQ = ComputeACorrelation(narrowbandChannel);
+
     // Calculate beamforming vector from spatial correlation matrix.
     PhasedArrayModel::ComplexVector aW = GetFirstEigenvector(aQ, svdIter, svdThresh);
 
@@ -156,4 +621,368 @@ ComputeSvdBeamformingVectors(Ptr<const MatrixBasedChannelModel::ChannelMatrix> p
     return std::make_pair(bW, aW);
 }
 
+std::pair<PhasedArrayModel::ComplexVector, PhasedArrayModel::ComplexVector>
+ComputeSvdBeamformingVectorsMatrixFree(Ptr<const MatrixBasedChannelModel::ChannelMatrix> params)
+{
+    // params
+    uint32_t svdIter = 30;
+    double svdThresh = 1e-8;
+
+    uint32_t iterations;
+    return ComputeMatrixFreeSvd(ComputeNarrowbandChannel(params),
+                                PhasedArrayModel::ComplexVector(),
+                                svdIter,
+                                svdThresh,
+                                iterations);
+}
+
+void
+ParallelFor(uint32_t n, uint32_t numThreads, const std::function<void(uint32_t)>& f)
+{
+    if (numThreads == 0)
+    {
+        numThreads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    numThreads = std::min(numThreads, n);
+
+    if (numThreads <= 1)
+    {
+        for (uint32_t i = 0; i < n; i++)
+        {
+            f(i);
+        }
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads);
+    for (uint32_t t = 0; t < numThreads; t++)
+    {
+        uint32_t begin = (uint64_t)n * t / numThreads;
+        uint32_t end = (uint64_t)n * (t + 1) / numThreads;
+        threads.emplace_back([&f, begin, end]() {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                f(i);
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+BeamCodebook
+CreateSineSpaceCodebook(Ptr<const PhasedArrayModel> antenna,
+                        uint32_t numAzimuth,
+                        uint32_t numInclination)
+{
+    NS_ASSERT_MSG(numAzimuth > 0 && numInclination > 0, "The codebook cannot be empty");
+
+    size_t arraySize = antenna->GetNumberOfElements();
+    std::vector<Vector> locs(arraySize);
+    for (size_t eIndex = 0; eIndex < arraySize; eIndex++)
+    {
+        locs[eIndex] = antenna->GetElementLocation(eIndex);
+    }
+    double norm = 1 / std::sqrt(arraySize);
+
+    BeamCodebook codebook;
+    codebook.reserve(numAzimuth * numInclination);
+    for (uint32_t incIndex = 0; incIndex < numInclination; incIndex++)
+    {
+        double cosInc = -1 + (2.0 * incIndex + 1) / numInclination;
+        double sinInc = std::sqrt(1 - cosInc * cosInc);
+        for (uint32_t azIndex = 0; azIndex < numAzimuth; azIndex++)
+        {
+            double sinAz = -1 + (2.0 * azIndex + 1) / numAzimuth;
+            double cosAz = std::sqrt(1 - sinAz * sinAz);
+
+            PhasedArrayModel::ComplexVector beam(arraySize);
+            for (size_t eIndex = 0; eIndex < arraySize; eIndex++)
+            {
+                // conjugate of the steering vector towards the beam direction
+                double phase = -2 * M_PI *
+                               (sinInc * cosAz * locs[eIndex].x + sinInc * sinAz * locs[eIndex].y +
+                                cosInc * locs[eIndex].z);
+                beam[eIndex] = std::polar(norm, phase);
+            }
+            codebook.push_back(beam);
+        }
+    }
+
+    return codebook;
+}
+
+MatrixBasedChannelModel::Double2DVector
+ComputeBeamSweepGains(Ptr<const QdChannelModel::ChannelRays> rays,
+                      const BeamCodebook& aCodebook,
+                      const BeamCodebook& bCodebook,
+                      uint32_t numThreads)
+{
+    NS_LOG_FUNCTION(rays << aCodebook.size() << bCodebook.size() << numThreads);
+
+    size_t numRays = rays->m_rayGain.size();
+
+    // weight the responses of the a device by the ray gains, so that the gain of each
+    // pair is the inner product between the responses of the two devices
+    auto aResponses = ComputeBeamResponses(rays->m_aSteering, aCodebook, numThreads);
+    for (auto& aResponse : aResponses)
+    {
+        for (size_t ray = 0; ray < numRays; ray++)
+        {
+            aResponse[ray] *= rays->m_rayGain[ray];
+        }
+    }
+    auto bResponses = ComputeBeamResponses(rays->m_bSteering, bCodebook, numThreads);
+
+    MatrixBasedChannelModel::Double2DVector gains(aCodebook.size(),
+                                                  MatrixBasedChannelModel::DoubleVector(
+                                                      bCodebook.size()));
+    ParallelFor(aCodebook.size(), numThreads, [&](uint32_t aBeam) {
+        const auto& aResponse = aResponses[aBeam];
+        for (size_t bBeam = 0; bBeam < bCodebook.size(); bBeam++)
+        {
+            const auto& bResponse = bResponses[bBeam];
+            std::complex<double> sum(0, 0);
+            for (size_t ray = 0; ray < numRays; ray++)
+            {
+                sum += aResponse[ray] * bResponse[ray];
+            }
+            gains[aBeam][bBeam] = std::norm(sum);
+        }
+    });
+
+    return gains;
+}
+
+std::vector<BeamPairGain>
+GetBestBeamPairs(Ptr<const QdChannelModel::ChannelRays> rays,
+                 const BeamCodebook& aCodebook,
+                 const BeamCodebook& bCodebook,
+                 uint32_t k,
+                 uint32_t numThreads)
+{
+    NS_LOG_FUNCTION(rays << aCodebook.size() << bCodebook.size() << k << numThreads);
+
+    auto gains = ComputeBeamSweepGains(rays, aCodebook, bCodebook, numThreads);
+
+    std::vector<BeamPairGain> pairs;
+    pairs.reserve(aCodebook.size() * bCodebook.size());
+    for (uint32_t aBeam = 0; aBeam < aCodebook.size(); aBeam++)
+    {
+        for (uint32_t bBeam = 0; bBeam < bCodebook.size(); bBeam++)
+        {
+            pairs.push_back({aBeam, bBeam, gains[aBeam][bBeam]});
+        }
+    }
+
+    k = std::min<size_t>(k, pairs.size());
+    std::partial_sort(pairs.begin(),
+                      pairs.begin() + k,
+                      pairs.end(),
+                      [](const BeamPairGain& lhs, const BeamPairGain& rhs) {
+                          return lhs.gain > rhs.gain;
+                      });
+    pairs.resize(k);
+
+    return pairs;
+}
+
+std::vector<std::complex<double>>
+ComputeFrequencyResponse(const std::vector<std::complex<double>>& gains,
+                         const std::vector<double>& delays,
+                         double f0,
+                         double df,
+                         size_t numFreqs)
+{
+    NS_LOG_FUNCTION(gains.size() << f0 << df << numFreqs);
+    NS_ASSERT_MSG(gains.size() == delays.size(), "Each ray needs a gain and a delay");
+
+    // number of consecutive frequencies updated together
+    constexpr size_t BLOCK = 8;
+    size_t paddedFreqs = (numFreqs + BLOCK - 1) / BLOCK * BLOCK;
+    std::vector<double> re(paddedFreqs, 0.0);
+    std::vector<double> im(paddedFreqs, 0.0);
+
+    for (size_t k = 0; k < gains.size(); k++)
+    {
+        // phasors of the first block of frequencies, and rotation to the next block
+        double zRe[BLOCK];
+        double zIm[BLOCK];
+        for (size_t b = 0; b < BLOCK; b++)
+        {
+            std::complex<double> z =
+                gains[k] * std::polar(1.0, -2 * M_PI * (f0 + b * df) * delays[k]);
+            zRe[b] = z.real();
+            zIm[b] = z.imag();
+        }
+        std::complex<double> step = std::polar(1.0, -2 * M_PI * BLOCK * df * delays[k]);
+        double stepRe = step.real();
+        double stepIm = step.imag();
+
+        for (size_t i = 0; i < paddedFreqs; i += BLOCK)
+        {
+            for (size_t b = 0; b < BLOCK; b++)
+            {
+                re[i + b] += zRe[b];
+                im[i + b] += zIm[b];
+                double rotatedRe = zRe[b] * stepRe - zIm[b] * stepIm;
+                zIm[b] = zRe[b] * stepIm + zIm[b] * stepRe;
+                zRe[b] = rotatedRe;
+            }
+        }
+    }
+
+    std::vector<std::complex<double>> response(numFreqs);
+    for (size_t i = 0; i < numFreqs; i++)
+    {
+        response[i] = std::complex<double>(re[i], im[i]);
+    }
+    return response;
+}
+
+SvdBeamformer::SvdBeamformer(uint32_t nIter, double threshold, bool matrixFree)
+    : m_nIter(nIter),
+      m_threshold(threshold),
+      m_matrixFree(matrixFree),
+      m_lastIterations(0, 0),
+      m_totalIterations(0),
+      m_numComputations(0),
+      m_numCacheHits(0)
+{
+}
+
+std::pair<PhasedArrayModel::ComplexVector, PhasedArrayModel::ComplexVector>
+SvdBeamformer::ComputeBeamformingVectors(
+    Ptr<const MatrixBasedChannelModel::ChannelMatrix> params)
+{
+    NS_LOG_FUNCTION(this << params);
+
+    // an empty state is created for new links, resulting in a cold start
+    LinkState& state = m_linkStates[params->m_antennaPair];
+
+    // the address and the generation time do not identify the channel, as the buffers are
+    // reused and a channel may be regenerated at the same time, e.g., at a scenario switch
+    Ptr<const QdChannelModel::QdChannelMatrix> qdParams =
+        DynamicCast<const QdChannelModel::QdChannelMatrix>(params);
+    uint64_t realizationId = qdParams ? qdParams->m_realizationId : 0;
+    if (realizationId != 0 && state.realizationId == realizationId)
+    {
+        NS_LOG_LOGIC("Channel matrix unchanged, returning memoized beamforming vectors");
+        m_numCacheHits++;
+        if (m_channelModel)
+        {
+            m_channelModel->NotifyBeamforming(true, Seconds(0));
+        }
+        return state.bfVectors;
+    }
+    state.realizationId = realizationId;
+
+    auto start = std::chrono::steady_clock::now();
+    MatrixBasedChannelModel::Complex2DVector narrowbandChannel = ComputeNarrowbandChannel(params);
+
+    if (m_matrixFree)
+    {
+        uint32_t bIter;
+        state.bfVectors = ComputeMatrixFreeSvd(narrowbandChannel,
+                                               state.bEigenvector,
+                                               m_nIter,
+                                               m_threshold,
+                                               bIter);
+        state.bEigenvector = state.bfVectors.first;
+
+        m_lastIterations = std::make_pair(bIter, 0);
+        m_totalIterations += bIter;
+        NS_LOG_DEBUG("Matrix-free SVD beamforming converged after " << bIter << " iterations");
+    }
+    else
+    {
+        uint32_t bIter;
+        MatrixBasedChannelModel::Complex2DVector bQ = ComputeBCorrelation(narrowbandChannel);
+        state.bEigenvector =
+            GetFirstEigenvector(bQ, state.bEigenvector, m_nIter, m_threshold, bIter);
+
+        uint32_t aIter;
+        MatrixBasedChannelModel::Complex2DVector aQ = ComputeACorrelation(narrowbandChannel);
+        state.aEigenvector =
+            GetFirstEigenvector(aQ, state.aEigenvector, m_nIter, m_threshold, aIter);
+
+        PhasedArrayModel::ComplexVector aW = state.aEigenvector;
+        for (size_t i = 0; i < aW.GetSize(); ++i)
+        {
+            aW[i] = std::conj(aW[i]);
+        }
+
+        state.bfVectors = std::make_pair(state.bEigenvector, aW);
+
+        m_lastIterations = std::make_pair(bIter, aIter);
+        m_totalIterations += bIter + aIter;
+        NS_LOG_DEBUG("SVD beamforming converged after " << bIter << " and " << aIter
+                                                        << " iterations");
+    }
+
+    m_numComputations++;
+    Time latency = NanoSeconds(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::steady_clock::now() - start)
+                                   .count());
+    m_latency.Add(latency);
+    if (m_channelModel)
+    {
+        m_channelModel->NotifyBeamforming(false, latency);
+    }
+
+    return state.bfVectors;
+}
+
+std::pair<uint32_t, uint32_t>
+SvdBeamformer::GetLastIterations() const
+{
+    return m_lastIterations;
+}
+
+uint64_t
+SvdBeamformer::GetTotalIterations() const
+{
+    return m_totalIterations;
+}
+
+uint64_t
+SvdBeamformer::GetNumComputations() const
+{
+    return m_numComputations;
+}
+
+uint64_t
+SvdBeamformer::GetNumCacheHits() const
+{
+    return m_numCacheHits;
+}
+
+const QdLatencyHistogram&
+SvdBeamformer::GetLatencyHistogram() const
+{
+    return m_latency;
+}
+
+void
+SvdBeamformer::SetChannelModel(Ptr<QdChannelModel> channelModel)
+{
+    NS_LOG_FUNCTION(this << channelModel);
+    m_channelModel = channelModel;
+}
+
+void
+SvdBeamformer::Reset()
+{
+    NS_LOG_FUNCTION(this);
+    m_linkStates.clear();
+    m_lastIterations = std::make_pair(0, 0);
+    m_totalIterations = 0;
+    m_numComputations = 0;
+    m_numCacheHits = 0;
+    m_latency.Reset();
+}
+
 } // namespace ns3
@@ -28,6 +28,9 @@
 #include "ns3/phased-array-model.h"
 #include "ns3/qd-channel-model.h"
 
+#include <functional>
+#include <map>
+
 namespace ns3
 {
 
@@ -48,6 +51,31 @@ PhasedArrayModel::ComplexVector GetFirstEigenvector(MatrixBasedChannelModel::Com
                                                     uint32_t nIter,
                                                     double threshold);
 
+/**
+ * Compute the eigenvector associated to the largest eigenvalue of a Hermitian matrix,
+ * starting from a given initial guess.
+ * At each iteration, the Rayleigh quotient is maximized over the plane spanned by the
+ * current estimate and its residual, converging faster than the plain power iteration.
+ * The iterations stop when the squared norm of the residual, relative to the squared
+ * eigenvalue, falls below the threshold, or when the maximum number of matrix-vector
+ * products is reached. If the initial guess is already the dominant eigenvector, a
+ * single matrix-vector product is performed.
+ *
+ * \param A Hermitian complex 2D matrix
+ * \param initialGuess the initial guess. If its size does not match the size of A, the
+ *        first row of A is used instead
+ * \param nIter maximum number of matrix-vector products
+ * \param threshold relative residual threshold
+ * \param [out] iterations the number of matrix-vector products actually performed
+ * \return the eigenvector associated to the largest eigenvalue
+ */
+PhasedArrayModel::ComplexVector GetFirstEigenvector(
+    const MatrixBasedChannelModel::Complex2DVector& A,
+    const PhasedArrayModel::ComplexVector& initialGuess,
+    uint32_t nIter,
+    double threshold,
+    uint32_t& iterations);
+
 /**
  * Compute analog SVD beamforming for a given channel matrix.
  * SVD beamforming is intended to be analog when only the left and right eigenvector
@@ -63,6 +91,248 @@ PhasedArrayModel::ComplexVector GetFirstEigenvector(MatrixBasedChannelModel::Com
 std::pair<PhasedArrayModel::ComplexVector, PhasedArrayModel::ComplexVector>
 ComputeSvdBeamformingVectors(Ptr<const MatrixBasedChannelModel::ChannelMatrix> params);
 
+/**
+ * Compute analog SVD beamforming for a given channel matrix without forming the
+ * spatial correlation matrices.
+ * The right singular vector v is computed by iterating directly on the narrowband channel
+ * matrix H, i.e., applying H*(Hv) at each step, with cost O(Na Nb) per iteration. The left
+ * singular vector is then obtained as Hv/|Hv|, instead of solving a second eigenproblem.
+ * The resulting beamforming vectors achieve the same gain as the ones computed by
+ * ComputeSvdBeamformingVectors, which is kept as a reference implementation, up to an
+ * irrelevant common phase.
+ *
+ * \param params the channel matrix
+ * \return the beamforming vectors for the second and first dimension, respectively
+ */
+std::pair<PhasedArrayModel::ComplexVector, PhasedArrayModel::ComplexVector>
+ComputeSvdBeamformingVectorsMatrixFree(Ptr<const MatrixBasedChannelModel::ChannelMatrix> params);
+
+/**
+ * Beamforming codebook, i.e., a list of beamforming vectors
+ */
+using BeamCodebook = std::vector<PhasedArrayModel::ComplexVector>;
+
+/**
+ * Gain obtained with a pair of beams during a beam sweep
+ */
+struct BeamPairGain
+{
+    uint32_t aBeam; //!< index of the beam in the codebook of the a device
+    uint32_t bBeam; //!< index of the beam in the codebook of the b device
+    double gain;    //!< beamformed channel gain |w_b^T H w_a|^2
+};
+
+/**
+ * Run a function on each index in [0, n), splitting the indices in contiguous
+ * blocks processed by separate threads.
+ * The function must be safe to call concurrently on different indices.
+ *
+ * \param n the number of indices
+ * \param numThreads the number of threads. If 0, the number of hardware threads is used
+ * \param f the function to run on each index
+ */
+void ParallelFor(uint32_t n, uint32_t numThreads, const std::function<void(uint32_t)>& f);
+
+/**
+ * Create a uniform sine-space codebook for the given antenna array.
+ * The beams are steered towards a uniform grid of numAzimuth values of sin(azimuth) and
+ * numInclination values of cos(inclination), at the centers of equal intervals of [-1, 1].
+ * In general, the codebook is not a DFT: only with a single inclination, half-wavelength
+ * spacing, and as many azimuths as elements along the y axis, the beams are orthogonal and
+ * equal to the columns of a DFT matrix up to a common linear phase, while oversampled grids
+ * give overlapping beams.
+ * The phase convention is the same used by QdChannelModel, so that steering a beam
+ * towards the direction of a ray gives the full array gain.
+ *
+ * \param antenna the antenna array
+ * \param numAzimuth the number of beams in azimuth
+ * \param numInclination the number of beams in inclination
+ * \return the codebook, with numAzimuth x numInclination unit-norm beams
+ */
+BeamCodebook CreateSineSpaceCodebook(Ptr<const PhasedArrayModel> antenna,
+                                     uint32_t numAzimuth,
+                                     uint32_t numInclination);
+
+/**
+ * Compute the beamformed channel gain of every pair of beams from the two codebooks.
+ * The response of each beam towards each ray is precomputed from the ray decomposition
+ * of the channel, and the gains of all pairs are then obtained by combining the responses
+ * of the two devices, without setting the beamforming vectors and without building the
+ * channel matrix. Both steps are parallelized over the beams.
+ *
+ * \param rays the ray decomposition of the channel, see QdChannelModel::GetChannelRays
+ * \param aCodebook the codebook of the a device
+ * \param bCodebook the codebook of the b device
+ * \param numThreads the number of threads, see ParallelFor
+ * \return the matrix of the gains, indexed as [aBeam][bBeam]
+ */
+MatrixBasedChannelModel::Double2DVector ComputeBeamSweepGains(
+    Ptr<const QdChannelModel::ChannelRays> rays,
+    const BeamCodebook& aCodebook,
+    const BeamCodebook& bCodebook,
+    uint32_t numThreads = 1);
+
+/**
+ * Find the k beam pairs with the largest beamformed channel gain, see ComputeBeamSweepGains
+ *
+ * \param rays the ray decomposition of the channel, see QdChannelModel::GetChannelRays
+ * \param aCodebook the codebook of the a device
+ * \param bCodebook the codebook of the b device
+ * \param k the number of beam pairs to return
+ * \param numThreads the number of threads, see ParallelFor
+ * \return the best beam pairs, sorted by decreasing gain
+ */
+std::vector<BeamPairGain> GetBestBeamPairs(Ptr<const QdChannelModel::ChannelRays> rays,
+                                           const BeamCodebook& aCodebook,
+                                           const BeamCodebook& bCodebook,
+                                           uint32_t k,
+                                           uint32_t numThreads = 1);
+
+/**
+ * Compute the frequency response of a set of rays at uniformly spaced frequencies, i.e.,
+ * H(f_i) = sum_k g_k exp(-j 2 pi (f0 + i df) tau_k), for i = 0, ..., numFreqs - 1.
+ * Instead of evaluating the complex exponentials at each frequency, the phasor of each ray
+ * is rotated by a constant step, updating a block of consecutive frequencies at a time so
+ * that the updates can be vectorized. The cost is O(K numFreqs) multiply-adds, plus a few
+ * complex exponentials per ray.
+ *
+ * \param gains the complex gain g_k of each ray
+ * \param delays the delay tau_k of each ray [s]
+ * \param f0 the first frequency [Hz]
+ * \param df the frequency spacing [Hz]
+ * \param numFreqs the number of frequencies
+ * \return the frequency response at each frequency
+ */
+std::vector<std::complex<double>> ComputeFrequencyResponse(
+    const std::vector<std::complex<double>>& gains,
+    const std::vector<double>& delays,
+    double f0,
+    double df,
+    size_t numFreqs);
+
+/**
+ * Stateful analog SVD beamforming.
+ * Computes the same beamforming vectors as ComputeSvdBeamformingVectors, but keeps the
+ * singular vectors obtained for each link, identified by the antenna pair stored in the
+ * channel matrix, and uses them as the initial guess for the next computation on the same
+ * link. Since the dominant singular vectors change little between consecutive QD timesteps,
+ * typical updates converge after one or two matrix-vector products.
+ *
+ * Furthermore, the beamforming vectors of each link are memoized: as long as the same
+ * channel matrix, with the same generation time, is passed, the stored vectors are returned
+ * without any computation, until the channel is regenerated.
+ *
+ * If a channel model is attached, see SetChannelModel, every call is also recorded in its
+ * runtime statistics, so that the beamforming latency is written to its StatsFile.
+ */
+class SvdBeamformer
+{
+  public:
+    /**
+     * Constructor
+     *
+     * \param nIter maximum number of matrix-vector products per eigenvector
+     * \param threshold relative residual threshold, see GetFirstEigenvector
+     * \param matrixFree if true, iterate directly on the channel matrix as in
+     *        ComputeSvdBeamformingVectorsMatrixFree, otherwise solve the eigenproblems
+     *        of the spatial correlation matrices as in ComputeSvdBeamformingVectors
+     */
+    SvdBeamformer(uint32_t nIter = 30, double threshold = 1e-8, bool matrixFree = true);
+
+    /**
+     * Compute analog SVD beamforming for a given channel matrix, warm-starting
+     * from the previous solution for the same link, if any.
+     * If the channel matrix is the same realization passed by the last call for the same
+     * link, the previous beamforming vectors are returned. Only the matrices generated by
+     * QdChannelModel identify their realization, see QdChannelModel::QdChannelMatrix, so
+     * the beamforming vectors are always computed for the other matrices.
+     *
+     * \param params the channel matrix
+     * \return the beamforming vectors for the second and first dimension, respectively
+     */
+    std::pair<PhasedArrayModel::ComplexVector, PhasedArrayModel::ComplexVector>
+    ComputeBeamformingVectors(Ptr<const MatrixBasedChannelModel::ChannelMatrix> params);
+
+    /**
+     * Get the number of matrix-vector products performed by the last computation
+     *
+     * \return the number of iterations for the second and first dimension, respectively.
+     *         In matrix-free mode, the first dimension requires no iterations and each
+     *         iteration on the second dimension accounts for the products by both H and H*
+     */
+    std::pair<uint32_t, uint32_t> GetLastIterations() const;
+
+    /**
+     * Get the total number of matrix-vector products performed so far
+     *
+     * \return the total number of iterations
+     */
+    uint64_t GetTotalIterations() const;
+
+    /**
+     * Get the number of beamforming computations performed so far
+     *
+     * \return the number of computations
+     */
+    uint64_t GetNumComputations() const;
+
+    /**
+     * Get the number of calls served with memoized beamforming vectors,
+     * i.e., the number of computations saved
+     *
+     * \return the number of cache hits
+     */
+    uint64_t GetNumCacheHits() const;
+
+    /**
+     * Get the wall-clock latency of the beamforming computations performed so far,
+     * excluding the calls served with memoized beamforming vectors
+     *
+     * \return the latency histogram
+     */
+    const QdLatencyHistogram& GetLatencyHistogram() const;
+
+    /**
+     * Attach a channel model, whose runtime statistics record every subsequent call,
+     * see QdChannelModel::NotifyBeamforming. The model may be shared by beamformers
+     * running in different threads
+     *
+     * \param channelModel the channel model, or nullptr to detach it
+     */
+    void SetChannelModel(Ptr<QdChannelModel> channelModel);
+
+    /**
+     * Forget the solutions stored for all links and reset the counters
+     */
+    void Reset();
+
+  private:
+    /**
+     * Dominant eigenvectors of the spatial correlation matrices of a link, and
+     * beamforming vectors computed for the last channel matrix of the link
+     */
+    struct LinkState
+    {
+        PhasedArrayModel::ComplexVector bEigenvector; //!< eigenvector of H*H
+        PhasedArrayModel::ComplexVector aEigenvector; //!< eigenvector of HH*, if formed
+        uint64_t realizationId{0}; //!< realization of the last channel matrix, 0 if unknown
+        std::pair<PhasedArrayModel::ComplexVector, PhasedArrayModel::ComplexVector>
+            bfVectors; //!< beamforming vectors for the last channel matrix
+    };
+
+    uint32_t m_nIter;    //!< maximum number of matrix-vector products per eigenvector
+    double m_threshold;  //!< relative residual threshold
+    bool m_matrixFree;   //!< whether the correlation matrices are formed or not
+    std::map<std::pair<uint32_t, uint32_t>, LinkState>
+        m_linkStates;    //!< previous solutions, indexed by antenna pair
+    std::pair<uint32_t, uint32_t> m_lastIterations; //!< iterations of the last computation
+    uint64_t m_totalIterations;                     //!< total number of iterations
+    uint64_t m_numComputations;                     //!< total number of computations
+    uint64_t m_numCacheHits;                        //!< calls served by memoized vectors
+    QdLatencyHistogram m_latency;                   //!< latency of the computations
+    Ptr<QdChannelModel> m_channelModel; //!< channel model recording the computations, if any
+};
+
 } // namespace ns3
 
 #endif /* QD_CHANNEL_UTILS_H */
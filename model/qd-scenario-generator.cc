@@ -0,0 +1,314 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2020 SIGNET Lab, Department of Information Engineering,
+ * University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/qd-scenario-generator.h"
+
+#include "ns3/abort.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/pointer.h"
+#include "ns3/string.h"
+#include "ns3/system-path.h"
+#include "ns3/uinteger.h"
+
+#include <cmath>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("QdScenarioGenerator");
+
+NS_OBJECT_ENSURE_REGISTERED(QdScenarioGenerator);
+
+namespace
+{
+
+const double SPEED_OF_LIGHT = 299792458.0; //!< speed of light in vacuum [m/s]
+
+/**
+ * Write a line of comma-separated values
+ *
+ * \param file the output file
+ * \param values the values
+ */
+void
+WriteCsvLine(std::ofstream& file, const std::vector<double>& values)
+{
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        file << (i == 0 ? "" : ",") << values[i];
+    }
+    file << "\n";
+}
+
+/**
+ * Get the angles of the direction from a point to another one, as used by the ray tracer
+ *
+ * \param from the starting point
+ * \param to the end point
+ * \return the elevation (measured from the zenith) and the azimuth angles [deg]
+ */
+std::pair<double, double>
+GetDirectionAngles(const Vector& from, const Vector& to)
+{
+    Vector diff = to - from;
+    double elevation = std::acos(diff.z / diff.GetLength()) * 180 / M_PI;
+    double azimuth = std::atan2(diff.y, diff.x) * 180 / M_PI;
+    if (azimuth < 0)
+    {
+        azimuth += 360;
+    }
+    return std::make_pair(elevation, azimuth);
+}
+
+} // namespace
+
+QdScenarioGenerator::QdScenarioGenerator()
+{
+    NS_LOG_FUNCTION(this);
+
+    m_uniformRv = CreateObject<UniformRandomVariable>();
+}
+
+QdScenarioGenerator::~QdScenarioGenerator()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+TypeId
+QdScenarioGenerator::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::QdScenarioGenerator")
+            .SetParent<Object>()
+            .SetGroupName("Spectrum")
+            .AddConstructor<QdScenarioGenerator>()
+            .AddAttribute("NumNodes",
+                          "The number of nodes",
+                          UintegerValue(2),
+                          MakeUintegerAccessor(&QdScenarioGenerator::m_numNodes),
+                          MakeUintegerChecker<uint32_t>(2))
+            .AddAttribute("NumTimesteps",
+                          "The number of timesteps",
+                          UintegerValue(100),
+                          MakeUintegerAccessor(&QdScenarioGenerator::m_numTimesteps),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("TotalTimeDuration",
+                          "The duration of the scenario",
+                          TimeValue(Seconds(1)),
+                          MakeTimeAccessor(&QdScenarioGenerator::m_totalTimeDuration),
+                          MakeTimeChecker())
+            .AddAttribute("Frequency",
+                          "The carrier frequency in Hz",
+                          DoubleValue(60e9),
+                          MakeDoubleAccessor(&QdScenarioGenerator::m_frequency),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("RoomSize",
+                          "The size of the room where the nodes are placed, in meters",
+                          VectorValue(Vector(10, 10, 3)),
+                          MakeVectorAccessor(&QdScenarioGenerator::m_roomSize),
+                          MakeVectorChecker())
+            .AddAttribute("LinkProbability",
+                          "The probability that the channel of a pair of nodes is written. "
+                          "Values lower than 1 keep the size of large scenarios manageable",
+                          DoubleValue(1.0),
+                          MakeDoubleAccessor(&QdScenarioGenerator::m_linkProbability),
+                          MakeDoubleChecker<double>(0, 1))
+            .AddAttribute("Precision",
+                          "The number of significant digits of the values in the QD files",
+                          UintegerValue(6),
+                          MakeUintegerAccessor(&QdScenarioGenerator::m_precision),
+                          MakeUintegerChecker<uint32_t>(1, 17))
+            .AddAttribute("NumMpcs",
+                          "The random variable drawing the number of MPCs of a link at "
+                          "each timestep",
+                          StringValue("ns3::UniformRandomVariable[Min=1|Max=10]"),
+                          MakePointerAccessor(&QdScenarioGenerator::m_numMpcs),
+                          MakePointerChecker<RandomVariableStream>());
+
+    return tid;
+}
+
+int64_t
+QdScenarioGenerator::AssignStreams(int64_t stream)
+{
+    NS_LOG_FUNCTION(this << stream);
+
+    m_numMpcs->SetStream(stream);
+    m_uniformRv->SetStream(stream + 1);
+    return 2;
+}
+
+const std::vector<Vector>&
+QdScenarioGenerator::GetNodePositions() const
+{
+    return m_nodePositions;
+}
+
+void
+QdScenarioGenerator::Generate(std::string path, std::string scenario)
+{
+    NS_LOG_FUNCTION(this << path << scenario);
+
+    std::string folder = path + "/" + scenario + "/";
+
+    m_nodePositions.clear();
+    for (uint32_t i = 0; i < m_numNodes; i++)
+    {
+        m_nodePositions.push_back(Vector(m_uniformRv->GetValue(0, m_roomSize.x),
+                                         m_uniformRv->GetValue(0, m_roomSize.y),
+                                         m_uniformRv->GetValue(0, m_roomSize.z)));
+    }
+
+    SystemPath::MakeDirectories(folder + "Input");
+    SystemPath::MakeDirectories(folder + "Output/Ns3/NodesPosition");
+    SystemPath::MakeDirectories(folder + "Output/Ns3/QdFiles");
+    WriteParaCfgFile(folder);
+    WriteNodesPosition(folder);
+
+    uint32_t numLinks = 0;
+    for (uint32_t i = 0; i < m_numNodes; i++)
+    {
+        for (uint32_t j = i + 1; j < m_numNodes; j++)
+        {
+            if (m_uniformRv->GetValue() >= m_linkProbability)
+            {
+                continue;
+            }
+
+            std::string qdFolder = folder + "Output/Ns3/QdFiles/";
+            std::ofstream txFile(qdFolder + "Tx" + std::to_string(i) + "Rx" +
+                                 std::to_string(j) + ".txt");
+            std::ofstream rxFile(qdFolder + "Tx" + std::to_string(j) + "Rx" +
+                                 std::to_string(i) + ".txt");
+            NS_ABORT_MSG_IF(!txFile.is_open() || !rxFile.is_open(),
+                            "Unable to write the QD files in " << qdFolder);
+            txFile.precision(m_precision);
+            rxFile.precision(m_precision);
+
+            for (uint32_t t = 0; t < m_numTimesteps; t++)
+            {
+                Mpcs mpcs = DrawMpcs(m_nodePositions[i], m_nodePositions[j]);
+                WriteMpcs(txFile, mpcs, false);
+                WriteMpcs(rxFile, mpcs, true);
+            }
+            numLinks++;
+        }
+    }
+
+    NS_LOG_INFO("Generated scenario " << folder << " with " << m_numNodes << " nodes, "
+                                      << numLinks << " links, " << m_numTimesteps
+                                      << " timesteps");
+}
+
+QdScenarioGenerator::Mpcs
+QdScenarioGenerator::DrawMpcs(const Vector& txPos, const Vector& rxPos)
+{
+    uint32_t numMpcs = m_numMpcs->GetInteger();
+    double distance = CalculateDistance(txPos, rxPos);
+    double lambda = SPEED_OF_LIGHT / m_frequency;
+
+    Mpcs mpcs;
+    for (uint32_t mpc = 0; mpc < numMpcs; mpc++)
+    {
+        double pathLength;
+        double loss;
+        double phase;
+        std::pair<double, double> aod;
+        std::pair<double, double> aoa;
+        if (mpc == 0)
+        {
+            // line-of-sight path
+            pathLength = distance;
+            loss = 0;
+            phase = 0;
+            aod = GetDirectionAngles(txPos, rxPos);
+            aoa = GetDirectionAngles(rxPos, txPos);
+        }
+        else
+        {
+            // reflected path
+            pathLength = distance * m_uniformRv->GetValue(1.1, 3.0);
+            loss = m_uniformRv->GetValue(3, 20);
+            phase = m_uniformRv->GetValue(0, 2 * M_PI);
+            aod = std::make_pair(m_uniformRv->GetValue(0, 180), m_uniformRv->GetValue(0, 360));
+            aoa = std::make_pair(m_uniformRv->GetValue(0, 180), m_uniformRv->GetValue(0, 360));
+        }
+
+        mpcs.delay_s.push_back(pathLength / SPEED_OF_LIGHT);
+        mpcs.pathGain_dbpow.push_back(20 * std::log10(lambda / (4 * M_PI * pathLength)) - loss);
+        mpcs.phase_rad.push_back(phase);
+        mpcs.elAod_deg.push_back(aod.first);
+        mpcs.azAod_deg.push_back(aod.second);
+        mpcs.elAoa_deg.push_back(aoa.first);
+        mpcs.azAoa_deg.push_back(aoa.second);
+    }
+
+    return mpcs;
+}
+
+void
+QdScenarioGenerator::WriteMpcs(std::ofstream& file, const Mpcs& mpcs, bool reverse) const
+{
+    file << mpcs.delay_s.size() << "\n";
+    if (mpcs.delay_s.empty())
+    {
+        return;
+    }
+
+    WriteCsvLine(file, mpcs.delay_s);
+    WriteCsvLine(file, mpcs.pathGain_dbpow);
+    WriteCsvLine(file, mpcs.phase_rad);
+    WriteCsvLine(file, reverse ? mpcs.elAoa_deg : mpcs.elAod_deg);
+    WriteCsvLine(file, reverse ? mpcs.azAoa_deg : mpcs.azAod_deg);
+    WriteCsvLine(file, reverse ? mpcs.elAod_deg : mpcs.elAoa_deg);
+    WriteCsvLine(file, reverse ? mpcs.azAod_deg : mpcs.azAoa_deg);
+}
+
+void
+QdScenarioGenerator::WriteParaCfgFile(const std::string& folder) const
+{
+    std::string fileName = folder + "Input/paraCfgCurrent.txt";
+    std::ofstream file(fileName);
+    NS_ABORT_MSG_IF(!file.is_open(), "Unable to write " << fileName);
+    file.precision(17);
+
+    file << "ParameterName\tParameterValue\n";
+    file << "numberOfNodes\t" << m_numNodes << "\n";
+    file << "numberOfTimeDivisions\t" << m_numTimesteps << "\n";
+    file << "totalTimeDuration\t" << m_totalTimeDuration.GetSeconds() << "\n";
+    file << "carrierFrequency\t" << m_frequency << "\n";
+    file << "qdFilesFloatPrecision\t" << m_precision << "\n";
+}
+
+void
+QdScenarioGenerator::WriteNodesPosition(const std::string& folder) const
+{
+    std::string fileName = folder + "Output/Ns3/NodesPosition/NodesPosition.csv";
+    std::ofstream file(fileName);
+    NS_ABORT_MSG_IF(!file.is_open(), "Unable to write " << fileName);
+    file.precision(17);
+
+    for (const auto& pos : m_nodePositions)
+    {
+        file << pos.x << "," << pos.y << "," << pos.z << "\n";
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,154 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2020 SIGNET Lab, Department of Information Engineering,
+ * University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef QD_SCENARIO_GENERATOR_H
+#define QD_SCENARIO_GENERATOR_H
+
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/vector.h"
+
+#include <fstream>
+
+namespace ns3
+{
+
+/**
+ * \ingroup spectrum
+ *
+ * Generate synthetic scenarios in the same format as the ones produced by the
+ * ray tracer, to be read by QdChannelModel.
+ * Nodes are placed uniformly at random in a room, and, for each pair of nodes and
+ * each timestep, the number of MPCs is drawn from the NumMpcs random variable. The
+ * first MPC is the line-of-sight path, with free-space path gain, while the other ones
+ * have random directions, longer delays, and additional reflection losses.
+ * Both Tx/Rx directions of each link are written, swapping the angles of departure and
+ * arrival, as done by the ray tracer.
+ * The resulting channels are not physically consistent, and are meant for stress
+ * testing only.
+ */
+class QdScenarioGenerator : public Object
+{
+  public:
+    /**
+     * Constructor
+     */
+    QdScenarioGenerator();
+
+    /**
+     * Destructor
+     */
+    ~QdScenarioGenerator() override;
+
+    /**
+     * Get the type ID
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * Write a synthetic scenario, creating the Input/ and Output/Ns3/ folders
+     *
+     * \param path folder path that will contain the scenario
+     * \param scenario scenario folder name
+     */
+    void Generate(std::string path, std::string scenario);
+
+    /**
+     * Get the positions of the nodes of the last generated scenario, in the order of the
+     * ray tracer IDs. Nodes have to be created with these positions before loading the
+     * scenario with QdChannelModel
+     *
+     * \return the node positions
+     */
+    const std::vector<Vector>& GetNodePositions() const;
+
+    /**
+     * Assign a fixed random variable stream number to the random variables
+     * used by this model.
+     *
+     * \param stream first stream index to use
+     * \return the number of stream indices assigned by this model
+     */
+    int64_t AssignStreams(int64_t stream);
+
+  private:
+    /**
+     * Multipath components of a link at a given timestep, in the ray tracer units
+     */
+    struct Mpcs
+    {
+        std::vector<double> delay_s;        //!< delays [s]
+        std::vector<double> pathGain_dbpow; //!< path gains [dB]
+        std::vector<double> phase_rad;      //!< phases [rad]
+        std::vector<double> elAod_deg;      //!< elevation angles of departure [deg]
+        std::vector<double> azAod_deg;      //!< azimuth angles of departure [deg]
+        std::vector<double> elAoa_deg;      //!< elevation angles of arrival [deg]
+        std::vector<double> azAoa_deg;      //!< azimuth angles of arrival [deg]
+    };
+
+    /**
+     * Draw the MPCs between two nodes
+     *
+     * \param txPos position of the transmitter
+     * \param rxPos position of the receiver
+     * \return the MPCs from the transmitter to the receiver
+     */
+    Mpcs DrawMpcs(const Vector& txPos, const Vector& rxPos);
+
+    /**
+     * Write the MPCs of a timestep in the QD file format
+     *
+     * \param file the QD file
+     * \param mpcs the MPCs
+     * \param reverse if true, the angles of departure and arrival are swapped
+     */
+    void WriteMpcs(std::ofstream& file, const Mpcs& mpcs, bool reverse) const;
+
+    /**
+     * Write the paraCfgCurrent.txt file
+     *
+     * \param folder the scenario folder, including the path
+     */
+    void WriteParaCfgFile(const std::string& folder) const;
+
+    /**
+     * Write the NodesPosition.csv file
+     *
+     * \param folder the scenario folder, including the path
+     */
+    void WriteNodesPosition(const std::string& folder) const;
+
+    uint32_t m_numNodes;                    //!< number of nodes
+    uint32_t m_numTimesteps;                //!< number of timesteps
+    Time m_totalTimeDuration;               //!< duration of the scenario
+    double m_frequency;                     //!< the carrier frequency [Hz]
+    Vector m_roomSize;                      //!< size of the room where nodes are placed [m]
+    double m_linkProbability;               //!< probability that a link is written
+    uint32_t m_precision;                   //!< number of significant digits of the values
+    Ptr<RandomVariableStream> m_numMpcs;    //!< number of MPCs of a link at a timestep
+    Ptr<UniformRandomVariable> m_uniformRv; //!< uniform random variable for positions and MPCs
+
+    std::vector<Vector> m_nodePositions; //!< positions of the nodes of the last scenario
+};
+
+} // namespace ns3
+
+#endif /* QD_SCENARIO_GENERATOR_H */
@@ -0,0 +1,222 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2020 SIGNET Lab, Department of Information Engineering,
+ * University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "ns3/qd-spectrum-propagation-loss-model.h"
+
+#include "ns3/log.h"
+#include "ns3/pointer.h"
+#include "ns3/qd-channel-utils.h"
+#include "ns3/spectrum-signal-parameters.h"
+
+#include <cmath>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("QdSpectrumPropagationLossModel");
+
+NS_OBJECT_ENSURE_REGISTERED(QdSpectrumPropagationLossModel);
+
+QdSpectrumPropagationLossModel::QdSpectrumPropagationLossModel()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+QdSpectrumPropagationLossModel::~QdSpectrumPropagationLossModel()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+QdSpectrumPropagationLossModel::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+
+    m_channelModel = nullptr;
+    m_bandGainsCache.clear();
+    PhasedArraySpectrumPropagationLossModel::DoDispose();
+}
+
+TypeId
+QdSpectrumPropagationLossModel::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::QdSpectrumPropagationLossModel")
+            .SetParent<PhasedArraySpectrumPropagationLossModel>()
+            .SetGroupName("Spectrum")
+            .AddConstructor<QdSpectrumPropagationLossModel>()
+            .AddAttribute("ChannelModel",
+                          "The QD channel model providing the rays",
+                          PointerValue(),
+                          MakePointerAccessor(&QdSpectrumPropagationLossModel::SetChannelModel,
+                                              &QdSpectrumPropagationLossModel::GetChannelModel),
+                          MakePointerChecker<QdChannelModel>());
+
+    return tid;
+}
+
+void
+QdSpectrumPropagationLossModel::SetChannelModel(Ptr<QdChannelModel> channel)
+{
+    NS_LOG_FUNCTION(this << channel);
+    m_channelModel = channel;
+    std::lock_guard<std::mutex> lock(m_bandGainsMutex);
+    m_bandGainsCache.clear();
+}
+
+Ptr<QdChannelModel>
+QdSpectrumPropagationLossModel::GetChannelModel() const
+{
+    return m_channelModel;
+}
+
+int64_t
+QdSpectrumPropagationLossModel::DoAssignStreams(int64_t stream)
+{
+    // the QD channel is deterministic
+    return 0;
+}
+
+Ptr<SpectrumValue>
+QdSpectrumPropagationLossModel::DoCalcRxPowerSpectralDensity(
+    Ptr<const SpectrumSignalParameters> params,
+    Ptr<const MobilityModel> a,
+    Ptr<const MobilityModel> b,
+    Ptr<const PhasedArrayModel> aPhasedArrayModel,
+    Ptr<const PhasedArrayModel> bPhasedArrayModel) const
+{
+    NS_LOG_FUNCTION(this << a << b << aPhasedArrayModel << bPhasedArrayModel);
+    NS_ASSERT_MSG(m_channelModel, "The channel model has not been set");
+    NS_ASSERT_MSG(a->GetDistanceFrom(b) > 0.0,
+                  "The position of a and b devices cannot be the same");
+
+    Ptr<SpectrumValue> rxPsd = params->psd->Copy();
+    Ptr<const SpectrumModel> spectrumModel = rxPsd->GetSpectrumModel();
+    if (spectrumModel->GetNumBands() == 0)
+    {
+        return rxPsd;
+    }
+
+    // the rays are recomputed by the channel model only if the timestep or the beamforming
+    // vectors changed, otherwise the same object is returned
+    std::shared_ptr<const QdChannelModel::BeamformedRays> rays =
+        m_channelModel->GetBeamformedRays(a,
+                                          b,
+                                          aPhasedArrayModel,
+                                          bPhasedArrayModel,
+                                          aPhasedArrayModel->GetBeamformingVector(),
+                                          bPhasedArrayModel->GetBeamformingVector());
+    if (rays->m_gains.empty())
+    {
+        // no rays, e.g., link pruned by the channel model
+        NS_LOG_LOGIC("No rays, the received PSD is zero");
+        *rxPsd *= 0.0;
+        return rxPsd;
+    }
+
+    std::vector<double> bandGains;
+    {
+        std::lock_guard<std::mutex> lock(m_bandGainsMutex);
+        BandGains& cached = m_bandGainsCache[std::make_pair(PeekPointer(a), PeekPointer(b))];
+        if (cached.m_rays == rays && cached.m_spectrumModelUid == spectrumModel->GetUid())
+        {
+            NS_LOG_LOGIC("Band gains present in the cache");
+            bandGains = cached.m_gains;
+        }
+    }
+
+    if (bandGains.empty())
+    {
+        bandGains = ComputeBandGains(*rays, spectrumModel);
+
+        std::lock_guard<std::mutex> lock(m_bandGainsMutex);
+        BandGains& cached = m_bandGainsCache[std::make_pair(PeekPointer(a), PeekPointer(b))];
+        cached.m_rays = rays;
+        cached.m_spectrumModelUid = spectrumModel->GetUid();
+        cached.m_gains = bandGains;
+    }
+
+    size_t bandIndex = 0;
+    for (auto value = rxPsd->ValuesBegin(); value != rxPsd->ValuesEnd(); ++value, ++bandIndex)
+    {
+        *value *= bandGains[bandIndex];
+    }
+
+    return rxPsd;
+}
+
+std::vector<double>
+QdSpectrumPropagationLossModel::ComputeBandGains(
+    const QdChannelModel::BeamformedRays& rays,
+    const Ptr<const SpectrumModel>& spectrumModel) const
+{
+    // the center of the PSD is mapped onto the carrier frequency
+    size_t numBands = spectrumModel->GetNumBands();
+    double firstFc = spectrumModel->Begin()->fc;
+    double lastFc = (spectrumModel->End() - 1)->fc;
+    double refFrequency = (firstFc + lastFc) / 2;
+    double df = numBands > 1 ? (lastFc - firstFc) / (numBands - 1) : 0.0;
+
+    bool uniform = true;
+    size_t bandIndex = 0;
+    for (auto band = spectrumModel->Begin(); band != spectrumModel->End(); ++band, ++bandIndex)
+    {
+        if (std::abs(band->fc - (firstFc + bandIndex * df)) > 1e-6 * std::max(df, 1.0))
+        {
+            uniform = false;
+            break;
+        }
+    }
+
+    std::vector<std::complex<double>> response;
+    if (uniform)
+    {
+        response = ComputeFrequencyResponse(rays.m_gains,
+                                            rays.m_delay,
+                                            firstFc - refFrequency,
+                                            df,
+                                            numBands);
+    }
+    else
+    {
+        // the phase-rotation recurrence needs uniformly spaced bands
+        NS_LOG_LOGIC("Bands not uniformly spaced, computing the response of each band");
+        for (auto band = spectrumModel->Begin(); band != spectrumModel->End(); ++band)
+        {
+            std::complex<double> bandResponse(0, 0);
+            for (size_t k = 0; k < rays.m_gains.size(); k++)
+            {
+                bandResponse += rays.m_gains[k] *
+                                std::polar(1.0, -2 * M_PI * (band->fc - refFrequency) *
+                                                    rays.m_delay[k]);
+            }
+            response.push_back(bandResponse);
+        }
+    }
+
+    std::vector<double> bandGains(numBands);
+    for (size_t i = 0; i < numBands; i++)
+    {
+        bandGains[i] = std::norm(response[i]);
+    }
+    return bandGains;
+}
+
+} // namespace ns3
@@ -0,0 +1,139 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2020 SIGNET Lab, Department of Information Engineering,
+ * University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef QD_SPECTRUM_PROPAGATION_LOSS_MODEL_H
+#define QD_SPECTRUM_PROPAGATION_LOSS_MODEL_H
+
+#include "ns3/phased-array-spectrum-propagation-loss-model.h"
+#include "ns3/qd-channel-model.h"
+
+#include <map>
+#include <mutex>
+
+namespace ns3
+{
+
+/**
+ * \ingroup spectrum
+ *
+ * Frequency-selective spectrum propagation loss model for QdChannelModel.
+ * The received PSD is computed directly from the rays of the QD traces and the
+ * beamforming vectors of the two antenna arrays, without building the channel matrix:
+ * the beamformed gain of each ray is obtained with QdChannelModel::GetBeamformedRayGains,
+ * in O(K (Na + Nb)), and the frequency response at the center of each band of the PSD
+ * with ComputeFrequencyResponse, in O(K B), where K is the number of rays and B the
+ * number of bands.
+ *
+ * The bands of the PSD are mapped onto the carrier frequency of the QD traces, i.e., the
+ * center of the PSD corresponds to the carrier frequency, whose phase term is already
+ * included in the gains of the rays. No Doppler term is applied, as the QD traces model
+ * the mobility through the evolution of the rays over the timesteps.
+ *
+ * The power gain of each band is cached for each pair of devices, together with the
+ * beamformed rays it was computed from, see QdChannelModel::GetBeamformedRays. As long as
+ * the timestep and the beamforming vectors do not change, the channel model returns the
+ * same rays, and the received PSD is obtained by rescaling the transmitted one.
+ */
+class QdSpectrumPropagationLossModel : public PhasedArraySpectrumPropagationLossModel
+{
+  public:
+    /**
+     * Constructor
+     */
+    QdSpectrumPropagationLossModel();
+
+    /**
+     * Destructor
+     */
+    ~QdSpectrumPropagationLossModel() override;
+
+    /**
+     * Get the type ID
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * Set the channel model providing the rays
+     *
+     * \param channel the QD channel model
+     */
+    void SetChannelModel(Ptr<QdChannelModel> channel);
+
+    /**
+     * Get the channel model providing the rays
+     *
+     * \return the QD channel model
+     */
+    Ptr<QdChannelModel> GetChannelModel() const;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /**
+     * Computes the received PSD, applying the beamformed frequency response of the
+     * channel between the two devices to the transmitted PSD
+     *
+     * \param params the spectrum signal parameters, including the transmitted PSD
+     * \param a the mobility model of the transmitter
+     * \param b the mobility model of the receiver
+     * \param aPhasedArrayModel the antenna array of the transmitter
+     * \param bPhasedArrayModel the antenna array of the receiver
+     * \return the received PSD
+     */
+    Ptr<SpectrumValue> DoCalcRxPowerSpectralDensity(
+        Ptr<const SpectrumSignalParameters> params,
+        Ptr<const MobilityModel> a,
+        Ptr<const MobilityModel> b,
+        Ptr<const PhasedArrayModel> aPhasedArrayModel,
+        Ptr<const PhasedArrayModel> bPhasedArrayModel) const override;
+
+    int64_t DoAssignStreams(int64_t stream) override;
+
+    /**
+     * Compute the power gain of each band of a spectrum model for the given rays
+     *
+     * \param rays the beamformed rays
+     * \param spectrumModel the spectrum model
+     * \return the power gain of each band
+     */
+    std::vector<double> ComputeBandGains(const QdChannelModel::BeamformedRays& rays,
+                                         const Ptr<const SpectrumModel>& spectrumModel) const;
+
+    /**
+     * Power gains of the bands of a link, computed from a set of beamformed rays
+     */
+    struct BandGains
+    {
+        std::shared_ptr<const QdChannelModel::BeamformedRays> m_rays; //!< the rays
+        uint32_t m_spectrumModelUid{0}; //!< UID of the spectrum model of the bands
+        std::vector<double> m_gains;    //!< power gain of each band
+    };
+
+    Ptr<QdChannelModel> m_channelModel; //!< the QD channel model providing the rays
+    mutable std::map<std::pair<const MobilityModel*, const MobilityModel*>, BandGains>
+        m_bandGainsCache;                  //!< cached band gains, indexed by the devices
+    mutable std::mutex m_bandGainsMutex; //!< protects m_bandGainsCache
+};
+
+} // namespace ns3
+
+#endif /* QD_SPECTRUM_PROPAGATION_LOSS_MODEL_H */
@@ -2,14 +2,116 @@
 
 // Include a header file from your module to test.
 #include "ns3/constant-position-mobility-model.h"
+#include "ns3/double.h"
+#include "ns3/isotropic-antenna-model.h"
+#include "ns3/log.h"
 #include "ns3/node-container.h"
+#include "ns3/object-factory.h"
 #include "ns3/qd-channel-model.h"
+#include "ns3/qd-channel-utils.h"
+#include "ns3/qd-scenario-generator.h"
+#include "ns3/qd-spectrum-propagation-loss-model.h"
+#include "ns3/spectrum-signal-parameters.h"
 #include "ns3/test.h"
+#include "ns3/three-gpp-antenna-model.h"
+#include "ns3/uniform-planar-array.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <fcntl.h>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
 
 // Do not put your test classes in namespace ns3.  You may find it useful
 // to use the using directive to access the ns3 namespace directly
 using namespace ns3;
 
+NS_LOG_COMPONENT_DEFINE("QdChannelTestSuite");
+
+/**
+ * Synthetic scenario written by QdScenarioGenerator, with a node at some of its positions
+ */
+struct SyntheticScenario
+{
+    std::string path;                          //!< folder path containing the scenario
+    std::string name;                          //!< scenario folder name
+    Ptr<QdScenarioGenerator> generator;        //!< the generator of the scenario
+    NodeContainer nodes;                       //!< the nodes
+    std::vector<Ptr<MobilityModel>> mobs;      //!< mobility models of the nodes
+    std::vector<Ptr<PhasedArrayModel>> arrays; //!< 2x2 planar array of each node
+};
+
+/**
+ * Write a synthetic scenario with timesteps of 100 ms, and create a node with a constant
+ * position mobility model and a 2x2 planar array at each selected position
+ *
+ * \param path folder where the scenario is written
+ * \param numNodes number of positions of the scenario
+ * \param numTimesteps number of timesteps
+ * \param numMpcs number of MPCs of each link at each timestep, random if 0
+ * \param rtIds positions where a node is created, all of them if empty
+ * \param systemIds system ID of each created node, 0 for all of them if empty
+ * \return the scenario
+ */
+static SyntheticScenario
+CreateSyntheticScenario(const std::string& path,
+                        uint32_t numNodes,
+                        uint32_t numTimesteps,
+                        uint32_t numMpcs = 0,
+                        std::vector<uint32_t> rtIds = {},
+                        const std::vector<uint32_t>& systemIds = {})
+{
+    SyntheticScenario scenario;
+    scenario.path = path;
+    scenario.name = "Synthetic";
+    scenario.generator = CreateObject<QdScenarioGenerator>();
+    scenario.generator->SetAttribute("NumNodes", UintegerValue(numNodes));
+    scenario.generator->SetAttribute("NumTimesteps", UintegerValue(numTimesteps));
+    scenario.generator->SetAttribute("TotalTimeDuration",
+                                     TimeValue(MilliSeconds(100 * numTimesteps)));
+    if (numMpcs > 0)
+    {
+        scenario.generator->SetAttribute(
+            "NumMpcs",
+            StringValue("ns3::ConstantRandomVariable[Constant=" + std::to_string(numMpcs) +
+                        "]"));
+    }
+    scenario.generator->AssignStreams(0);
+    scenario.generator->Generate(path, scenario.name);
+
+    if (rtIds.empty())
+    {
+        for (uint32_t i = 0; i < numNodes; i++)
+        {
+            rtIds.push_back(i);
+        }
+    }
+    for (uint32_t i = 0; i < rtIds.size(); i++)
+    {
+        scenario.nodes.Create(1, systemIds.empty() ? 0 : systemIds[i]);
+    }
+    for (uint32_t i = 0; i < rtIds.size(); i++)
+    {
+        Ptr<MobilityModel> mob = CreateObject<ConstantPositionMobilityModel>();
+        mob->SetPosition(scenario.generator->GetNodePositions()[rtIds[i]]);
+        scenario.nodes.Get(i)->AggregateObject(mob);
+        scenario.mobs.push_back(mob);
+        scenario.arrays.push_back(CreateObjectWithAttributes<UniformPlanarArray>("NumColumns",
+                                                                                 UintegerValue(2),
+                                                                                 "NumRows",
+                                                                                 UintegerValue(2)));
+    }
+    return scenario;
+}
+
 // Test case for importing information from the Input/ folder
 class QdChannelTestCaseInput : public TestCase
 {
@@ -67,6 +169,2909 @@ QdChannelTestCaseInput::DoRun(void)
     NS_TEST_ASSERT_MSG_EQ_TOL(qdChannel->GetFrequency(), 60e9, 1, "Checking simulation frequency");
 }
 
+// Test case for loading a scenario written by QdScenarioGenerator
+class QdChannelTestCaseSyntheticScenario : public TestCase
+{
+  public:
+    QdChannelTestCaseSyntheticScenario();
+    virtual ~QdChannelTestCaseSyntheticScenario();
+
+  private:
+    virtual void DoRun(void);
+};
+
+QdChannelTestCaseSyntheticScenario::QdChannelTestCaseSyntheticScenario()
+    : TestCase("QdChannelTestCaseSyntheticScenario")
+{
+}
+
+QdChannelTestCaseSyntheticScenario::~QdChannelTestCaseSyntheticScenario()
+{
+}
+
+void
+QdChannelTestCaseSyntheticScenario::DoRun(void)
+{
+    uint32_t numNodes = 4;
+    uint32_t numTimesteps = 5;
+    uint32_t numMpcs = 3;
+
+    // Write the scenario, and create the nodes with the generated positions
+    SyntheticScenario synthetic =
+        CreateSyntheticScenario(CreateTempDirFilename(""), numNodes, numTimesteps, numMpcs);
+    const NodeContainer& nodes = synthetic.nodes;
+
+    // Create the channel model
+    Ptr<QdChannelModel> qdChannel = CreateObject<QdChannelModel>(synthetic.path, synthetic.name);
+
+    // tests
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->GetNumTimesteps(), numTimesteps, "Checking timesteps");
+    NS_TEST_ASSERT_MSG_EQ_TOL(qdChannel->GetQdSimTime().GetSeconds(),
+                              0.5,
+                              1e-9,
+                              "Checking simulation time");
+    NS_TEST_ASSERT_MSG_EQ_TOL(qdChannel->GetFrequency(), 60e9, 1, "Checking simulation frequency");
+
+    Ptr<PhasedArrayModel> antenna = CreateObject<UniformPlanarArray>();
+    for (uint32_t i = 0; i < numNodes; i++)
+    {
+        for (uint32_t j = i + 1; j < numNodes; j++)
+        {
+            uint32_t aId = nodes.Get(i)->GetId();
+            uint32_t bId = nodes.Get(j)->GetId();
+            NS_TEST_ASSERT_MSG_EQ(qdChannel->IsLinkAvailable(aId, bId),
+                                  true,
+                                  "Checking link " << i << "-" << j);
+            Ptr<const QdChannelModel::ChannelRays> rays =
+                qdChannel->GetChannelRays(aId, bId, antenna, antenna, numTimesteps - 1);
+            NS_TEST_ASSERT_MSG_EQ(rays->m_rayGain.size(), numMpcs, "Checking number of MPCs");
+
+            // the first MPC is the line-of-sight path
+            double distance = CalculateDistance(synthetic.generator->GetNodePositions()[i],
+                                                synthetic.generator->GetNodePositions()[j]);
+            NS_TEST_ASSERT_MSG_EQ_TOL(rays->m_delay[0],
+                                      distance / 299792458.0,
+                                      1e-6 * distance / 299792458.0,
+                                      "Checking line-of-sight delay");
+        }
+    }
+
+    // The models created without a scenario, also through the TypeId, load nothing until
+    // the path and the scenario are set
+    ObjectFactory factory("ns3::QdChannelModel");
+    Ptr<QdChannelModel> qdFactory = factory.Create<QdChannelModel>();
+    NS_TEST_ASSERT_MSG_EQ(qdFactory->GetPath(), "", "Checking the path of an empty model");
+    NS_TEST_ASSERT_MSG_EQ(qdFactory->GetScenario(), "", "Checking the empty scenario");
+    qdFactory->SetScenario("");
+    NS_TEST_ASSERT_MSG_EQ(qdFactory->GetScenario(), "", "An empty scenario loads nothing");
+    qdFactory->SetPath(synthetic.path);
+    qdFactory->SetScenario(synthetic.name);
+    NS_TEST_ASSERT_MSG_EQ(qdFactory->GetNumTimesteps(),
+                          numTimesteps,
+                          "Checking timesteps of the scenario set afterwards");
+
+    // Load the time window [0.2, 0.35] s, i.e., timesteps 2 and 3
+    Ptr<QdChannelModel> qdWindow = CreateObject<QdChannelModel>();
+    NS_TEST_ASSERT_MSG_EQ(qdWindow->GetScenario(), "", "Checking the empty scenario");
+    qdWindow->SetAttribute("WindowStartOffset", TimeValue(Seconds(0.2)));
+    qdWindow->SetAttribute("WindowDuration", TimeValue(Seconds(0.15)));
+    qdWindow->SetPath(synthetic.path);
+    qdWindow->SetScenario(synthetic.name);
+
+    NS_TEST_ASSERT_MSG_EQ(qdWindow->GetNumTimesteps(), 2, "Checking timesteps of the window");
+    NS_TEST_ASSERT_MSG_EQ_TOL(qdWindow->GetQdSimTime().GetSeconds(),
+                              0.2,
+                              1e-9,
+                              "Checking duration of the window");
+    uint32_t aId = nodes.Get(0)->GetId();
+    uint32_t bId = nodes.Get(1)->GetId();
+    for (uint32_t t = 0; t < 2; t++)
+    {
+        Ptr<const QdChannelModel::ChannelRays> rays =
+            qdChannel->GetChannelRays(aId, bId, antenna, antenna, t + 2);
+        Ptr<const QdChannelModel::ChannelRays> windowRays =
+            qdWindow->GetChannelRays(aId, bId, antenna, antenna, t);
+        NS_TEST_ASSERT_MSG_EQ(windowRays->m_rayGain.size(),
+                              rays->m_rayGain.size(),
+                              "Checking number of MPCs in the window");
+        NS_TEST_ASSERT_MSG_EQ(windowRays->m_delay[0],
+                              rays->m_delay[0],
+                              "Checking timestep " << t << " of the window");
+    }
+
+    Simulator::Destroy();
+}
+
+// Test case for loading only the channels of a subset of the nodes of a scenario
+class QdChannelTestCaseNodeSubset : public TestCase
+{
+  public:
+    QdChannelTestCaseNodeSubset();
+    virtual ~QdChannelTestCaseNodeSubset();
+
+  private:
+    virtual void DoRun(void);
+};
+
+QdChannelTestCaseNodeSubset::QdChannelTestCaseNodeSubset()
+    : TestCase("QdChannelTestCaseNodeSubset")
+{
+}
+
+QdChannelTestCaseNodeSubset::~QdChannelTestCaseNodeSubset()
+{
+}
+
+void
+QdChannelTestCaseNodeSubset::DoRun(void)
+{
+    // Write a scenario with 6 positions, and create nodes only for 3 of them
+    SyntheticScenario synthetic =
+        CreateSyntheticScenario(CreateTempDirFilename(""), 6, 2, 0, {0, 2, 5});
+    const NodeContainer& nodes = synthetic.nodes;
+
+    // Load the channels between the matched nodes
+    Ptr<QdChannelModel> qdChannel = CreateObject<QdChannelModel>();
+    qdChannel->SetAttribute("LoadMatchedNodesOnly", BooleanValue(true));
+    qdChannel->SetPath(synthetic.path);
+    qdChannel->SetScenario(synthetic.name);
+
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->GetLoadReport().qdInfoBytesPerPair.size(),
+                          3,
+                          "Checking the number of loaded pairs of matched nodes");
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->IsLinkAvailable(nodes.Get(0)->GetId(), nodes.Get(2)->GetId()),
+                          true,
+                          "Checking link between matched nodes");
+
+    // Load only the channels between the listed nodes
+    qdChannel = CreateObject<QdChannelModel>();
+    qdChannel->SetAttribute("LoadedRtIds", StringValue("0,5"));
+    qdChannel->SetPath(synthetic.path);
+    qdChannel->SetScenario(synthetic.name);
+
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->GetLoadReport().qdInfoBytesPerPair.size(),
+                          1,
+                          "Checking the number of loaded pairs of listed nodes");
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->IsLinkAvailable(nodes.Get(0)->GetId(), nodes.Get(2)->GetId()),
+                          true,
+                          "Checking link between listed nodes");
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->IsLinkAvailable(nodes.Get(0)->GetId(), nodes.Get(1)->GetId()),
+                          false,
+                          "Checking link with a node that is not listed");
+
+    // A subset without links installs an empty scenario
+    qdChannel = CreateObject<QdChannelModel>();
+    qdChannel->SetAttribute("LoadedRtIds", StringValue("2"));
+    qdChannel->SetPath(synthetic.path);
+    qdChannel->SetScenario(synthetic.name);
+
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->GetLoadReport().qdInfoBytesPerPair.size(),
+                          0,
+                          "Checking the number of loaded pairs of a single node");
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->GetNumTimesteps(), 2, "Checking the empty scenario");
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->IsLinkAvailable(nodes.Get(0)->GetId(), nodes.Get(1)->GetId()),
+                          false,
+                          "Checking link in the empty scenario");
+
+    Simulator::Destroy();
+}
+
+// Test case for loading only the channels of the nodes owned by this system
+class QdChannelTestCasePartitionBySystemId : public TestCase
+{
+  public:
+    QdChannelTestCasePartitionBySystemId();
+    virtual ~QdChannelTestCasePartitionBySystemId();
+
+  private:
+    virtual void DoRun(void);
+};
+
+QdChannelTestCasePartitionBySystemId::QdChannelTestCasePartitionBySystemId()
+    : TestCase("QdChannelTestCasePartitionBySystemId")
+{
+}
+
+QdChannelTestCasePartitionBySystemId::~QdChannelTestCasePartitionBySystemId()
+{
+}
+
+void
+QdChannelTestCasePartitionBySystemId::DoRun(void)
+{
+    // Write a scenario with 4 positions, the first two owned by this system, i.e., system 0
+    // of a sequential simulation, and the others by system 1
+    SyntheticScenario synthetic =
+        CreateSyntheticScenario(CreateTempDirFilename(""), 4, 2, 0, {}, {0, 0, 1, 1});
+    const NodeContainer& nodes = synthetic.nodes;
+
+    // The channels with at least one local node are loaded
+    Ptr<QdChannelModel> qdChannel = CreateObject<QdChannelModel>();
+    qdChannel->SetAttribute("PartitionBySystemId", BooleanValue(true));
+    qdChannel->SetPath(synthetic.path);
+    qdChannel->SetScenario(synthetic.name);
+
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->GetLoadReport().qdInfoBytesPerPair.size(),
+                          5,
+                          "Checking the number of pairs with a local node");
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->IsLinkAvailable(nodes.Get(0)->GetId(), nodes.Get(3)->GetId()),
+                          true,
+                          "Checking link between a local and a remote node");
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->IsLinkAvailable(nodes.Get(2)->GetId(), nodes.Get(3)->GetId()),
+                          false,
+                          "Checking link between remote nodes");
+
+    // A system owning no links installs an empty scenario
+    qdChannel = CreateObject<QdChannelModel>();
+    qdChannel->SetAttribute("PartitionBySystemId", BooleanValue(true));
+    qdChannel->SetAttribute("LoadedRtIds", StringValue("2,3"));
+    qdChannel->SetPath(synthetic.path);
+    qdChannel->SetScenario(synthetic.name);
+
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->GetLoadReport().qdInfoBytesPerPair.size(),
+                          0,
+                          "Checking the number of pairs of a system without links");
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->GetNumTimesteps(), 2, "Checking the empty scenario");
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->IsLinkAvailable(nodes.Get(2)->GetId(), nodes.Get(3)->GetId()),
+                          false,
+                          "Checking link in the empty scenario");
+
+    Simulator::Destroy();
+}
+
+// Test case for the steering vectors of planar and generic antenna arrays
+class QdChannelTestCaseSteeringVectors : public TestCase
+{
+  public:
+    QdChannelTestCaseSteeringVectors();
+    virtual ~QdChannelTestCaseSteeringVectors();
+
+  private:
+    virtual void DoRun(void);
+};
+
+QdChannelTestCaseSteeringVectors::QdChannelTestCaseSteeringVectors()
+    : TestCase("QdChannelTestCaseSteeringVectors")
+{
+}
+
+QdChannelTestCaseSteeringVectors::~QdChannelTestCaseSteeringVectors()
+{
+}
+
+void
+QdChannelTestCaseSteeringVectors::DoRun(void)
+{
+    SyntheticScenario synthetic = CreateSyntheticScenario(CreateTempDirFilename(""), 2, 1);
+    const NodeContainer& nodes = synthetic.nodes;
+    const std::vector<Ptr<MobilityModel>>& mobs = synthetic.mobs;
+    Ptr<QdChannelModel> qdChannel = CreateObject<QdChannelModel>(synthetic.path, synthetic.name);
+
+    // a rotated planar array, whose steering vectors are separable, and a single row,
+    // which uses the generic computation
+    Ptr<PhasedArrayModel> planar = CreateObjectWithAttributes<UniformPlanarArray>(
+        "NumColumns",
+        UintegerValue(4),
+        "NumRows",
+        UintegerValue(3),
+        "BearingAngle",
+        DoubleValue(0.7),
+        "DowntiltAngle",
+        DoubleValue(0.3));
+    Ptr<PhasedArrayModel> linear =
+        CreateObjectWithAttributes<UniformPlanarArray>("NumColumns", UintegerValue(8));
+
+    qdChannel->GetChannel(mobs[0], mobs[1], planar, linear);
+    Ptr<const MatrixBasedChannelModel::ChannelParams> params =
+        qdChannel->GetParams(mobs[0], mobs[1]);
+    Ptr<const QdChannelModel::ChannelRays> rays = qdChannel->GetChannelRays(nodes.Get(0)->GetId(),
+                                                                            nodes.Get(1)->GetId(),
+                                                                            planar,
+                                                                            linear,
+                                                                            0);
+
+    // compare with the phase of each element location
+    auto steering = [](const Ptr<PhasedArrayModel>& antenna, uint64_t index, double az, double el) {
+        Vector loc = antenna->GetElementLocation(index);
+        return std::polar(1.0,
+                          2 * M_PI *
+                              (sin(el) * cos(az) * loc.x + sin(el) * sin(az) * loc.y +
+                               cos(el) * loc.z));
+    };
+    for (size_t k = 0; k < rays->m_rayGain.size(); k++)
+    {
+        for (uint64_t aIndex = 0; aIndex < planar->GetNumberOfElements(); aIndex++)
+        {
+            std::complex<double> expected =
+                steering(planar, aIndex, params->m_angle[2][k], params->m_angle[3][k]);
+            NS_TEST_ASSERT_MSG_EQ_TOL(std::abs(rays->m_aSteering(aIndex, k) - expected),
+                                      0,
+                                      1e-9,
+                                      "Checking planar element " << aIndex << " of ray " << k);
+        }
+        for (uint64_t bIndex = 0; bIndex < linear->GetNumberOfElements(); bIndex++)
+        {
+            std::complex<double> expected =
+                steering(linear, bIndex, params->m_angle[0][k], params->m_angle[1][k]);
+            NS_TEST_ASSERT_MSG_EQ_TOL(std::abs(rays->m_bSteering(bIndex, k) - expected),
+                                      0,
+                                      1e-9,
+                                      "Checking linear element " << bIndex << " of ray " << k);
+        }
+    }
+
+    Simulator::Destroy();
+}
+
+// Test case for the beam sweep over sine-space codebooks
+class QdChannelTestCaseBeamSweep : public TestCase
+{
+  public:
+    QdChannelTestCaseBeamSweep();
+    virtual ~QdChannelTestCaseBeamSweep();
+
+  private:
+    virtual void DoRun(void);
+};
+
+QdChannelTestCaseBeamSweep::QdChannelTestCaseBeamSweep()
+    : TestCase("QdChannelTestCaseBeamSweep")
+{
+}
+
+QdChannelTestCaseBeamSweep::~QdChannelTestCaseBeamSweep()
+{
+}
+
+void
+QdChannelTestCaseBeamSweep::DoRun(void)
+{
+    // each index is processed exactly once, also with more threads than indices
+    for (uint32_t numThreads : {0, 1, 3, 200})
+    {
+        for (uint32_t n : {0, 1, 100})
+        {
+            std::vector<std::atomic<uint32_t>> visits(n);
+            ParallelFor(n, numThreads, [&visits](uint32_t i) { visits[i]++; });
+            for (uint32_t i = 0; i < n; i++)
+            {
+                NS_TEST_ASSERT_MSG_EQ(visits[i].load(),
+                                      1,
+                                      "Checking index " << i << " of " << n << " with "
+                                                        << numThreads << " threads");
+            }
+        }
+    }
+
+    SyntheticScenario synthetic = CreateSyntheticScenario(CreateTempDirFilename(""), 2, 1, 5);
+    const std::vector<Ptr<MobilityModel>>& mobs = synthetic.mobs;
+    Ptr<PhasedArrayModel> aArray = CreateObjectWithAttributes<UniformPlanarArray>(
+        "NumColumns",
+        UintegerValue(4),
+        "NumRows",
+        UintegerValue(2));
+    Ptr<PhasedArrayModel> bArray = synthetic.arrays[1];
+    Ptr<QdChannelModel> qdChannel = CreateObject<QdChannelModel>(synthetic.path, synthetic.name);
+
+    BeamCodebook aCodebook = CreateSineSpaceCodebook(aArray, 4, 2);
+    BeamCodebook bCodebook = CreateSineSpaceCodebook(bArray, 3, 2);
+    NS_TEST_ASSERT_MSG_EQ(aCodebook.size(), 8, "Checking the size of the a codebook");
+    NS_TEST_ASSERT_MSG_EQ(bCodebook.size(), 6, "Checking the size of the b codebook");
+    for (const auto& beam : aCodebook)
+    {
+        double norm = 0;
+        for (size_t i = 0; i < beam.GetSize(); i++)
+        {
+            norm += std::norm(beam[i]);
+        }
+        NS_TEST_ASSERT_MSG_EQ_TOL(norm, 1, 1e-12, "The beams should have unit norm");
+    }
+
+    // the gain of each pair is |bW^T H aW|^2, with the channel matrix of the same link
+    Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel =
+        qdChannel->GetChannel(mobs[0], mobs[1], aArray, bArray);
+    Ptr<const QdChannelModel::ChannelRays> rays =
+        qdChannel->GetChannelRays(mobs[0], mobs[1], aArray, bArray);
+    const MatrixBasedChannelModel::Complex3DVector& H = channel->m_channel;
+    MatrixBasedChannelModel::Double2DVector expected(aCodebook.size(),
+                                                     MatrixBasedChannelModel::DoubleVector(
+                                                         bCodebook.size()));
+    double maxGain = 0;
+    for (size_t aBeam = 0; aBeam < aCodebook.size(); aBeam++)
+    {
+        for (size_t bBeam = 0; bBeam < bCodebook.size(); bBeam++)
+        {
+            std::complex<double> sum(0, 0);
+            for (size_t bIndex = 0; bIndex < H.GetNumRows(); bIndex++)
+            {
+                for (size_t aIndex = 0; aIndex < H.GetNumCols(); aIndex++)
+                {
+                    for (size_t page = 0; page < H.GetNumPages(); page++)
+                    {
+                        sum += bCodebook[bBeam][bIndex] * H(bIndex, aIndex, page) *
+                               aCodebook[aBeam][aIndex];
+                    }
+                }
+            }
+            expected[aBeam][bBeam] = std::norm(sum);
+            maxGain = std::max(maxGain, expected[aBeam][bBeam]);
+        }
+    }
+    NS_TEST_ASSERT_MSG_GT(maxGain, 0, "The channel should have a non-zero gain");
+
+    MatrixBasedChannelModel::Double2DVector serial =
+        ComputeBeamSweepGains(rays, aCodebook, bCodebook, 1);
+    for (uint32_t numThreads : {0, 1, 5})
+    {
+        MatrixBasedChannelModel::Double2DVector gains =
+            ComputeBeamSweepGains(rays, aCodebook, bCodebook, numThreads);
+        for (size_t aBeam = 0; aBeam < aCodebook.size(); aBeam++)
+        {
+            for (size_t bBeam = 0; bBeam < bCodebook.size(); bBeam++)
+            {
+                NS_TEST_ASSERT_MSG_EQ_TOL(gains[aBeam][bBeam],
+                                          expected[aBeam][bBeam],
+                                          1e-9 * maxGain,
+                                          "Checking the gain of the pair "
+                                              << aBeam << "-" << bBeam << " with "
+                                              << numThreads << " threads");
+                NS_TEST_ASSERT_MSG_EQ(gains[aBeam][bBeam],
+                                      serial[aBeam][bBeam],
+                                      "The gains should not depend on the number of threads");
+            }
+        }
+
+        // the best pairs are sorted by decreasing gain, and k is clamped to the pairs
+        for (uint32_t k : {0, 3, 1000})
+        {
+            std::vector<BeamPairGain> best =
+                GetBestBeamPairs(rays, aCodebook, bCodebook, k, numThreads);
+            NS_TEST_ASSERT_MSG_EQ(best.size(),
+                                  std::min<size_t>(k, aCodebook.size() * bCodebook.size()),
+                                  "Checking the number of pairs for k=" << k);
+            std::set<std::pair<uint32_t, uint32_t>> seen;
+            for (size_t i = 0; i < best.size(); i++)
+            {
+                NS_TEST_ASSERT_MSG_EQ(best[i].gain,
+                                      serial[best[i].aBeam][best[i].bBeam],
+                                      "Checking the gain of pair " << i);
+                NS_TEST_ASSERT_MSG_EQ(seen.emplace(best[i].aBeam, best[i].bBeam).second,
+                                      true,
+                                      "The pairs should be distinct");
+                if (i > 0)
+                {
+                    NS_TEST_ASSERT_MSG_GT_OR_EQ(best[i - 1].gain,
+                                                best[i].gain,
+                                                "The pairs should be sorted, k=" << k);
+                }
+            }
+            if (!best.empty())
+            {
+                NS_TEST_ASSERT_MSG_EQ_TOL(best[0].gain,
+                                          maxGain,
+                                          1e-9 * maxGain,
+                                          "The first pair should have the largest gain");
+            }
+        }
+    }
+
+    Simulator::Destroy();
+}
+
+// Test case for the persistent cache of the channel matrices
+class QdChannelTestCaseChannelCache : public TestCase
+{
+  public:
+    QdChannelTestCaseChannelCache();
+    virtual ~QdChannelTestCaseChannelCache();
+
+  private:
+    virtual void DoRun(void);
+};
+
+QdChannelTestCaseChannelCache::QdChannelTestCaseChannelCache()
+    : TestCase("QdChannelTestCaseChannelCache")
+{
+}
+
+QdChannelTestCaseChannelCache::~QdChannelTestCaseChannelCache()
+{
+}
+
+void
+QdChannelTestCaseChannelCache::DoRun(void)
+{
+    std::string cacheDirectory = CreateTempDirFilename("cache");
+    SyntheticScenario synthetic = CreateSyntheticScenario(CreateTempDirFilename(""), 2, 1);
+    const std::vector<Ptr<MobilityModel>>& mobs = synthetic.mobs;
+    Ptr<PhasedArrayModel> antenna = synthetic.arrays[0];
+
+    // the first run computes the channel and writes it to the cache
+    Ptr<QdChannelModel> firstRun = CreateObject<QdChannelModel>();
+    firstRun->SetAttribute("ChannelCacheDirectory", StringValue(cacheDirectory));
+    firstRun->SetPath(synthetic.path);
+    firstRun->SetScenario(synthetic.name);
+    Ptr<const MatrixBasedChannelModel::ChannelMatrix> computed =
+        firstRun->GetChannel(mobs[0], mobs[1], antenna, antenna);
+    NS_TEST_ASSERT_MSG_EQ(firstRun->GetStats().diskCacheHits, 0, "Checking the empty cache");
+    NS_TEST_ASSERT_MSG_EQ(firstRun->GetStats().diskCacheWrites, 1, "Checking the cache write");
+
+    // a later run with the same scenario and antennas reads it back
+    Ptr<QdChannelModel> secondRun = CreateObject<QdChannelModel>();
+    secondRun->SetAttribute("ChannelCacheDirectory", StringValue(cacheDirectory));
+    secondRun->SetPath(synthetic.path);
+    secondRun->SetScenario(synthetic.name);
+    Ptr<PhasedArrayModel> sameAntenna = CreateObjectWithAttributes<UniformPlanarArray>(
+        "NumColumns",
+        UintegerValue(2),
+        "NumRows",
+        UintegerValue(2));
+    Ptr<const MatrixBasedChannelModel::ChannelMatrix> cached =
+        secondRun->GetChannel(mobs[0], mobs[1], sameAntenna, sameAntenna);
+    NS_TEST_ASSERT_MSG_EQ(secondRun->GetStats().diskCacheHits, 1, "Checking the cache hit");
+    NS_TEST_ASSERT_MSG_EQ(secondRun->GetStats().diskCacheWrites, 0, "Checking no cache write");
+    NS_TEST_ASSERT_MSG_EQ(cached->m_channel.GetNumPages(),
+                          computed->m_channel.GetNumPages(),
+                          "Checking the number of rays");
+    for (size_t i = 0; i < computed->m_channel.GetSize(); i++)
+    {
+        NS_TEST_ASSERT_MSG_EQ(cached->m_channel[i],
+                              computed->m_channel[i],
+                              "Checking the cached channel coefficient " << i);
+    }
+
+    // a different antenna geometry invalidates the cached channel
+    Ptr<QdChannelModel> thirdRun = CreateObject<QdChannelModel>();
+    thirdRun->SetAttribute("ChannelCacheDirectory", StringValue(cacheDirectory));
+    thirdRun->SetPath(synthetic.path);
+    thirdRun->SetScenario(synthetic.name);
+    Ptr<PhasedArrayModel> otherAntenna = CreateObjectWithAttributes<UniformPlanarArray>(
+        "NumColumns",
+        UintegerValue(2),
+        "NumRows",
+        UintegerValue(2),
+        "AntennaHorizontalSpacing",
+        DoubleValue(0.7));
+    thirdRun->GetChannel(mobs[0], mobs[1], otherAntenna, otherAntenna);
+    NS_TEST_ASSERT_MSG_EQ(thirdRun->GetStats().diskCacheHits,
+                          0,
+                          "A different antenna geometry should not hit the cache");
+    NS_TEST_ASSERT_MSG_EQ(thirdRun->GetStats().diskCacheWrites,
+                          1,
+                          "A different antenna geometry should be written to the cache");
+
+    // the models of a process share the cache of each file, whose lock they hold
+    std::shared_ptr<QdChannelCache> cache = QdChannelCache::Open(cacheDirectory, 1);
+    NS_TEST_ASSERT_MSG_EQ(QdChannelCache::Open(cacheDirectory, 1).get(),
+                          cache.get(),
+                          "The cache of a file should be shared within the process");
+    NS_TEST_ASSERT_MSG_EQ(cache->IsReadOnly(), false, "The cache should be writable");
+    QdChannelCache::Key key;
+    MatrixBasedChannelModel::Complex3DVector written(2, 2, 3);
+    for (size_t i = 0; i < 4; i++)
+    {
+        written[i] = std::complex<double>(i + 1, -1.0 * i);
+    }
+    NS_TEST_ASSERT_MSG_EQ(cache->Write(key, written), true, "Checking the cache write");
+
+    // a matrix with the same dimensions is read in place, clearing the pages not stored
+    MatrixBasedChannelModel::Complex3DVector readBack(2, 2, 3);
+    for (size_t i = 0; i < readBack.GetSize(); i++)
+    {
+        readBack[i] = std::complex<double>(7, 7);
+    }
+    const std::complex<double>* buffer = &readBack[0];
+    NS_TEST_ASSERT_MSG_EQ(cache->Read(key, readBack), true, "Checking the cache read");
+    NS_TEST_ASSERT_MSG_EQ(&readBack[0], buffer, "The matrix should be read in its buffer");
+    for (size_t i = 0; i < readBack.GetSize(); i++)
+    {
+        NS_TEST_ASSERT_MSG_EQ(readBack[i], written[i], "Checking the read coefficient " << i);
+    }
+
+    // while another process holds the lock of a file, its cache is read-only
+    std::string lockedFile = QdChannelCache::Open(cacheDirectory, 2)->GetFileName();
+    int toChild[2];
+    int toParent[2];
+    NS_TEST_ASSERT_MSG_EQ(pipe(toChild) == 0 && pipe(toParent) == 0, true, "Creating pipes");
+    pid_t child = fork();
+    if (child == 0)
+    {
+        // the child locks the file, and keeps it locked until the parent is done
+        int fd = open(lockedFile.c_str(), O_RDWR);
+        char c = fd >= 0 && lockf(fd, F_TLOCK, 0) == 0 ? 'y' : 'n';
+        ssize_t sent = write(toParent[1], &c, 1);
+        ssize_t received = ::read(toChild[0], &c, 1);
+        _exit(sent == 1 && received >= 0 ? 0 : 1);
+    }
+    char locked = 'n';
+    NS_TEST_ASSERT_MSG_EQ(::read(toParent[0], &locked, 1), 1, "Waiting for the child");
+    NS_TEST_ASSERT_MSG_EQ(locked, 'y', "The child should lock the released file");
+    std::shared_ptr<QdChannelCache> lockedCache = QdChannelCache::Open(cacheDirectory, 2);
+    NS_TEST_ASSERT_MSG_EQ(lockedCache->IsReadOnly(), true, "The cache should be read-only");
+    NS_TEST_ASSERT_MSG_EQ(lockedCache->Write(key, written),
+                          false,
+                          "A read-only cache should not be written");
+    NS_TEST_ASSERT_MSG_EQ(write(toChild[1], "x", 1), 1, "Releasing the child");
+    waitpid(child, nullptr, 0);
+    for (int fd : {toChild[0], toChild[1], toParent[0], toParent[1]})
+    {
+        close(fd);
+    }
+
+    Simulator::Destroy();
+}
+
+// Test case for the loading of the QD files in the background
+class QdChannelTestCaseAsyncLoading : public TestCase
+{
+  public:
+    QdChannelTestCaseAsyncLoading();
+    virtual ~QdChannelTestCaseAsyncLoading();
+
+  private:
+    virtual void DoRun(void);
+};
+
+QdChannelTestCaseAsyncLoading::QdChannelTestCaseAsyncLoading()
+    : TestCase("QdChannelTestCaseAsyncLoading")
+{
+}
+
+QdChannelTestCaseAsyncLoading::~QdChannelTestCaseAsyncLoading()
+{
+}
+
+void
+QdChannelTestCaseAsyncLoading::DoRun(void)
+{
+    uint32_t numNodes = 4;
+    uint32_t numTimesteps = 25;
+
+    SyntheticScenario synthetic =
+        CreateSyntheticScenario(CreateTempDirFilename(""), numNodes, numTimesteps);
+    const NodeContainer& nodes = synthetic.nodes;
+
+    Ptr<QdChannelModel> syncChannel = CreateObject<QdChannelModel>(synthetic.path, synthetic.name);
+    Ptr<QdChannelModel> asyncChannel = CreateObject<QdChannelModel>();
+    asyncChannel->SetAttribute("AsyncLoading", BooleanValue(true));
+    // most of the files are reopened at each block of timesteps
+    asyncChannel->SetAttribute("AsyncLoadingOpenFiles", UintegerValue(2));
+    asyncChannel->SetPath(synthetic.path);
+    asyncChannel->SetScenario(synthetic.name);
+
+    // the configuration is available before the QD files are loaded
+    NS_TEST_ASSERT_MSG_EQ(asyncChannel->GetNumTimesteps(), numTimesteps, "Checking timesteps");
+
+    // the last timestep first, to wait for the background loading
+    Ptr<PhasedArrayModel> antenna = CreateObject<UniformPlanarArray>();
+    for (int32_t t = numTimesteps - 1; t >= 0; t--)
+    {
+        for (uint32_t i = 0; i < numNodes; i++)
+        {
+            for (uint32_t j = i + 1; j < numNodes; j++)
+            {
+                uint32_t aId = nodes.Get(i)->GetId();
+                uint32_t bId = nodes.Get(j)->GetId();
+                NS_TEST_ASSERT_MSG_EQ(asyncChannel->IsLinkAvailable(aId, bId),
+                                      true,
+                                      "Checking link " << i << "-" << j);
+                Ptr<const QdChannelModel::ChannelRays> expected =
+                    syncChannel->GetChannelRays(aId, bId, antenna, antenna, t);
+                Ptr<const QdChannelModel::ChannelRays> rays =
+                    asyncChannel->GetChannelRays(aId, bId, antenna, antenna, t);
+                NS_TEST_ASSERT_MSG_EQ(rays->m_rayGain.size(),
+                                      expected->m_rayGain.size(),
+                                      "Checking the number of MPCs at timestep " << t);
+                for (size_t k = 0; k < expected->m_rayGain.size(); k++)
+                {
+                    NS_TEST_ASSERT_MSG_EQ(rays->m_rayGain[k],
+                                          expected->m_rayGain[k],
+                                          "Checking ray " << k << " at timestep " << t);
+                    NS_TEST_ASSERT_MSG_EQ(rays->m_delay[k],
+                                          expected->m_delay[k],
+                                          "Checking delay " << k << " at timestep " << t);
+                }
+            }
+        }
+    }
+
+    const QdChannelModel::LoadReport& report = asyncChannel->GetLoadReport();
+    NS_TEST_ASSERT_MSG_EQ(report.numMpcs,
+                          syncChannel->GetLoadReport().numMpcs,
+                          "Checking the MPCs accounted in the background");
+    NS_TEST_ASSERT_MSG_EQ(report.qdFilesBytes > 0, true, "Checking the bytes read");
+
+    Simulator::Destroy();
+}
+
+// Test case for the cancellation of the background loading when the model is destroyed
+class QdChannelTestCaseCancelLoading : public TestCase
+{
+  public:
+    QdChannelTestCaseCancelLoading();
+    virtual ~QdChannelTestCaseCancelLoading();
+
+  private:
+    virtual void DoRun(void);
+};
+
+QdChannelTestCaseCancelLoading::QdChannelTestCaseCancelLoading()
+    : TestCase("QdChannelTestCaseCancelLoading")
+{
+}
+
+QdChannelTestCaseCancelLoading::~QdChannelTestCaseCancelLoading()
+{
+}
+
+void
+QdChannelTestCaseCancelLoading::DoRun(void)
+{
+    // many files, so that reading one of them is much faster than reading all of them
+    SyntheticScenario synthetic = CreateSyntheticScenario(CreateTempDirFilename(""), 12, 400);
+
+    auto start = std::chrono::steady_clock::now();
+    Ptr<QdChannelModel> syncChannel = CreateObject<QdChannelModel>(synthetic.path, synthetic.name);
+    std::chrono::duration<double> loadTime = std::chrono::steady_clock::now() - start;
+    NS_TEST_ASSERT_MSG_EQ(syncChannel->GetFileLoadTimes().size(),
+                          2 + 12 * 11,
+                          "The scenario should be fully loaded");
+
+    // destroying the models stops the loading after the file being read
+    Ptr<QdChannelModel> asyncChannel = CreateObject<QdChannelModel>();
+    asyncChannel->SetAttribute("AsyncLoading", BooleanValue(true));
+    asyncChannel->SetPath(synthetic.path);
+    asyncChannel->SetScenario(synthetic.name);
+    start = std::chrono::steady_clock::now();
+    asyncChannel = nullptr;
+    std::chrono::duration<double> asyncDestroyTime = std::chrono::steady_clock::now() - start;
+    NS_TEST_ASSERT_MSG_LT(asyncDestroyTime.count(),
+                          loadTime.count(),
+                          "The asynchronous loading should be cancelled");
+
+    Ptr<QdChannelModel> preloadChannel =
+        CreateObject<QdChannelModel>(synthetic.path, synthetic.name);
+    preloadChannel->PreloadScenario(synthetic.name, Seconds(1));
+    start = std::chrono::steady_clock::now();
+    preloadChannel = nullptr;
+    std::chrono::duration<double> preloadDestroyTime = std::chrono::steady_clock::now() - start;
+    NS_TEST_ASSERT_MSG_LT(preloadDestroyTime.count(),
+                          loadTime.count(),
+                          "The preloading should be cancelled");
+
+    Simulator::Destroy();
+}
+
+// Test case for the received PSD computed by QdSpectrumPropagationLossModel
+class QdChannelTestCaseSpectrumPropagationLossModel : public TestCase
+{
+  public:
+    QdChannelTestCaseSpectrumPropagationLossModel();
+    virtual ~QdChannelTestCaseSpectrumPropagationLossModel();
+
+  private:
+    virtual void DoRun(void);
+};
+
+QdChannelTestCaseSpectrumPropagationLossModel::QdChannelTestCaseSpectrumPropagationLossModel()
+    : TestCase("QdChannelTestCaseSpectrumPropagationLossModel")
+{
+}
+
+QdChannelTestCaseSpectrumPropagationLossModel::~QdChannelTestCaseSpectrumPropagationLossModel()
+{
+}
+
+void
+QdChannelTestCaseSpectrumPropagationLossModel::DoRun(void)
+{
+    SyntheticScenario synthetic = CreateSyntheticScenario(CreateTempDirFilename(""), 2, 1);
+    const std::vector<Ptr<MobilityModel>>& mobs = synthetic.mobs;
+    const std::vector<Ptr<PhasedArrayModel>>& arrays = synthetic.arrays;
+    Ptr<QdChannelModel> qdChannel = CreateObject<QdChannelModel>(synthetic.path, synthetic.name);
+    Ptr<QdSpectrumPropagationLossModel> lossModel =
+        CreateObjectWithAttributes<QdSpectrumPropagationLossModel>("ChannelModel",
+                                                                   PointerValue(qdChannel));
+
+    Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel =
+        qdChannel->GetChannel(mobs[0], mobs[1], arrays[0], arrays[1]);
+    auto bfVectors = ComputeSvdBeamformingVectors(channel);
+    const PhasedArrayModel::ComplexVector& aW = std::get<0>(bfVectors);
+    const PhasedArrayModel::ComplexVector& bW = std::get<1>(bfVectors);
+    arrays[0]->SetBeamformingVector(aW);
+    arrays[1]->SetBeamformingVector(bW);
+
+    // the center band is at the carrier frequency, where the response is bW^T H aW
+    std::complex<double> narrowband(0, 0);
+    for (uint64_t bIndex = 0; bIndex < bW.GetSize(); bIndex++)
+    {
+        for (uint64_t aIndex = 0; aIndex < aW.GetSize(); aIndex++)
+        {
+            narrowband += bW[bIndex] * channel->m_channel(bIndex, aIndex, 0) * aW[aIndex];
+        }
+    }
+
+    std::vector<double> freqs;
+    for (int i = -50; i <= 50; i++)
+    {
+        freqs.push_back(60e9 + i * 180e3);
+    }
+    Ptr<SpectrumValue> txPsd = Create<SpectrumValue>(Create<SpectrumModel>(freqs));
+    *txPsd = 1.0;
+    Ptr<SpectrumSignalParameters> params = Create<SpectrumSignalParameters>();
+    params->psd = txPsd;
+    Ptr<SpectrumValue> rxPsd =
+        lossModel->CalcRxPowerSpectralDensity(params, mobs[0], mobs[1], arrays[0], arrays[1]);
+
+    NS_TEST_ASSERT_MSG_EQ_TOL((*rxPsd)[50],
+                              std::norm(narrowband),
+                              1e-9 * std::norm(narrowband),
+                              "Checking the gain at the carrier frequency");
+
+    // the other bands follow the delays of the rays
+    std::vector<std::complex<double>> gains =
+        qdChannel->GetBeamformedRayGains(mobs[0], mobs[1], arrays[0], arrays[1], aW, bW);
+    std::vector<double> delays = qdChannel->GetRayDelays(mobs[0], mobs[1]);
+    for (size_t i = 0; i < freqs.size(); i += 10)
+    {
+        std::complex<double> response(0, 0);
+        for (size_t k = 0; k < gains.size(); k++)
+        {
+            response += gains[k] * std::polar(1.0, -2 * M_PI * (freqs[i] - 60e9) * delays[k]);
+        }
+        NS_TEST_ASSERT_MSG_EQ_TOL((*rxPsd)[i],
+                                  std::norm(response),
+                                  1e-9 * std::norm(narrowband),
+                                  "Checking the gain of band " << i);
+    }
+
+    // the beamformed rays are computed once, until the beamforming vectors change
+    Ptr<SpectrumValue> cachedRxPsd =
+        lossModel->CalcRxPowerSpectralDensity(params, mobs[0], mobs[1], arrays[0], arrays[1]);
+    for (size_t i = 0; i < freqs.size(); i++)
+    {
+        NS_TEST_ASSERT_MSG_EQ((*cachedRxPsd)[i], (*rxPsd)[i], "Checking the cached band " << i);
+    }
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->GetStats().beamformedRaysMisses,
+                          1,
+                          "Unchanged beamforming vectors should not recompute the rays");
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->GetStats().beamformedRaysHits,
+                          2,
+                          "Unchanged beamforming vectors should be served by the cache");
+
+    PhasedArrayModel::ComplexVector singleElement(aW.GetSize());
+    singleElement[0] = 1.0;
+    arrays[0]->SetBeamformingVector(singleElement);
+    Ptr<SpectrumValue> newRxPsd =
+        lossModel->CalcRxPowerSpectralDensity(params, mobs[0], mobs[1], arrays[0], arrays[1]);
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->GetStats().beamformedRaysMisses,
+                          2,
+                          "New beamforming vectors should recompute the rays");
+    std::vector<std::complex<double>> newGains = qdChannel->GetBeamformedRayGains(mobs[0],
+                                                                                  mobs[1],
+                                                                                  arrays[0],
+                                                                                  arrays[1],
+                                                                                  singleElement,
+                                                                                  bW);
+    std::complex<double> newNarrowband(0, 0);
+    for (const auto& gain : newGains)
+    {
+        newNarrowband += gain;
+    }
+    NS_TEST_ASSERT_MSG_EQ_TOL((*newRxPsd)[50],
+                              std::norm(newNarrowband),
+                              1e-9 * std::norm(narrowband),
+                              "Checking the gain at the carrier frequency after a beam change");
+
+    Simulator::Destroy();
+}
+
+// Test case for the pruning of the links below the path-gain threshold
+class QdChannelTestCaseLinkPruning : public TestCase
+{
+  public:
+    QdChannelTestCaseLinkPruning();
+    virtual ~QdChannelTestCaseLinkPruning();
+
+  private:
+    virtual void DoRun(void);
+};
+
+QdChannelTestCaseLinkPruning::QdChannelTestCaseLinkPruning()
+    : TestCase("QdChannelTestCaseLinkPruning")
+{
+}
+
+QdChannelTestCaseLinkPruning::~QdChannelTestCaseLinkPruning()
+{
+}
+
+void
+QdChannelTestCaseLinkPruning::DoRun(void)
+{
+    SyntheticScenario synthetic = CreateSyntheticScenario(CreateTempDirFilename(""), 2, 1);
+    const std::vector<Ptr<MobilityModel>>& mobs = synthetic.mobs;
+    const std::vector<Ptr<PhasedArrayModel>>& arrays = synthetic.arrays;
+    for (const auto& array : arrays)
+    {
+        PhasedArrayModel::ComplexVector w(array->GetNumberOfElements());
+        w[0] = 1.0;
+        array->SetBeamformingVector(w);
+    }
+
+    // by default, no link is pruned
+    Ptr<QdChannelModel> qdChannel = CreateObject<QdChannelModel>(synthetic.path, synthetic.name);
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->IsLinkPruned(mobs[0], mobs[1]),
+                          false,
+                          "No link should be pruned by default");
+    Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel =
+        qdChannel->GetChannel(mobs[0], mobs[1], arrays[0], arrays[1]);
+    NS_TEST_ASSERT_MSG_GT(channel->m_channel.GetNumPages(), 0, "The channel should have rays");
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->GetStats().prunedChannels, 0, "Checking the pruned channels");
+
+    // the path gains of the traces are below 0 dB, thus every link is pruned
+    Ptr<QdChannelModel> prunedChannel =
+        CreateObject<QdChannelModel>(synthetic.path, synthetic.name);
+    prunedChannel->SetAttribute("PathGainThreshold", DoubleValue(0.0));
+    NS_TEST_ASSERT_MSG_EQ(prunedChannel->IsLinkPruned(mobs[0], mobs[1]),
+                          true,
+                          "The link should be pruned");
+    Ptr<const MatrixBasedChannelModel::ChannelMatrix> emptyChannel =
+        prunedChannel->GetChannel(mobs[0], mobs[1], arrays[0], arrays[1]);
+    NS_TEST_ASSERT_MSG_EQ(emptyChannel->m_channel.GetNumPages(),
+                          0,
+                          "A pruned channel should have no rays");
+    NS_TEST_ASSERT_MSG_EQ(emptyChannel->m_channel.GetNumRows(),
+                          channel->m_channel.GetNumRows(),
+                          "Checking the rows of the pruned channel");
+    NS_TEST_ASSERT_MSG_EQ(emptyChannel->m_channel.GetNumCols(),
+                          channel->m_channel.GetNumCols(),
+                          "Checking the columns of the pruned channel");
+    Ptr<const MatrixBasedChannelModel::ChannelParams> params =
+        prunedChannel->GetParams(mobs[0], mobs[1]);
+    NS_TEST_ASSERT_MSG_EQ(params->m_delay.size(), 0, "A pruned channel should have no delays");
+
+    Ptr<QdSpectrumPropagationLossModel> lossModel =
+        CreateObjectWithAttributes<QdSpectrumPropagationLossModel>("ChannelModel",
+                                                                   PointerValue(prunedChannel));
+    std::vector<double> freqs;
+    for (int i = -5; i <= 5; i++)
+    {
+        freqs.push_back(60e9 + i * 180e3);
+    }
+    Ptr<SpectrumValue> txPsd = Create<SpectrumValue>(Create<SpectrumModel>(freqs));
+    *txPsd = 1.0;
+    Ptr<SpectrumSignalParameters> signal = Create<SpectrumSignalParameters>();
+    signal->psd = txPsd;
+    Ptr<SpectrumValue> rxPsd =
+        lossModel->CalcRxPowerSpectralDensity(signal, mobs[0], mobs[1], arrays[0], arrays[1]);
+    for (size_t i = 0; i < freqs.size(); i++)
+    {
+        NS_TEST_ASSERT_MSG_EQ((*rxPsd)[i], 0.0, "A pruned link should receive no power");
+    }
+
+    QdChannelModel::Stats stats = prunedChannel->GetStats();
+    NS_TEST_ASSERT_MSG_EQ(stats.prunedChannels, 1, "Checking the pruned channels");
+    NS_TEST_ASSERT_MSG_EQ(stats.prunedBeamformedRays, 1, "Checking the pruned beamformed gains");
+
+    Simulator::Destroy();
+}
+
+// Frozen copy of the original power iteration, used as the reference of the
+// beamforming kernels. Do not optimize it
+static PhasedArrayModel::ComplexVector
+ReferenceFirstEigenvector(const MatrixBasedChannelModel::Complex2DVector& A,
+                          uint32_t nIter,
+                          double threshold)
+{
+    uint16_t arraySize = A.GetNumCols();
+    PhasedArrayModel::ComplexVector antennaWeights(arraySize);
+    for (uint16_t eIndex = 0; eIndex < arraySize; eIndex++)
+    {
+        antennaWeights[eIndex] = A(0, eIndex);
+    }
+
+    uint32_t iter = 0;
+    double diff = 1;
+    while (iter < nIter && diff > threshold)
+    {
+        PhasedArrayModel::ComplexVector antennaWeightsNew(arraySize);
+
+        for (uint16_t row = 0; row < arraySize; row++)
+        {
+            std::complex<double> sum(0, 0);
+            for (uint16_t col = 0; col < arraySize; col++)
+            {
+                sum += A(row, col) * antennaWeights[col];
+            }
+
+            antennaWeightsNew[row] = sum;
+        }
+        // Normalize antennaWeights;
+        double weighbSum = 0;
+        for (uint16_t i = 0; i < arraySize; i++)
+        {
+            weighbSum += norm(antennaWeightsNew[i]);
+        }
+        for (uint16_t i = 0; i < arraySize; i++)
+        {
+            antennaWeightsNew[i] = antennaWeightsNew[i] / sqrt(weighbSum);
+        }
+        diff = 0;
+        for (uint16_t i = 0; i < arraySize; i++)
+        {
+            diff += std::norm(antennaWeightsNew[i] - antennaWeights[i]);
+        }
+        iter++;
+        antennaWeights = antennaWeightsNew;
+    }
+
+    return antennaWeights;
+}
+
+// Frozen copy of the original ComputeSvdBeamformingVectors, used as the reference of
+// the beamforming kernels. Do not optimize it
+static std::pair<PhasedArrayModel::ComplexVector, PhasedArrayModel::ComplexVector>
+ReferenceSvdBeamformingVectors(Ptr<const MatrixBasedChannelModel::ChannelMatrix> params)
+{
+    uint32_t svdIter = 30;
+    double svdThresh = 1e-8;
+
+    uint16_t aSize = params->m_channel.GetNumRows();
+    uint16_t bSize = params->m_channel.GetNumCols();
+    uint16_t clusterSize = params->m_channel.GetNumPages();
+
+    MatrixBasedChannelModel::Complex2DVector narrowbandChannel(aSize, bSize);
+    for (uint16_t aIndex = 0; aIndex < aSize; aIndex++)
+    {
+        for (uint16_t bIndex = 0; bIndex < bSize; bIndex++)
+        {
+            std::complex<double> cSum(0, 0);
+            for (uint16_t cIndex = 0; cIndex < clusterSize; cIndex++)
+            {
+                cSum += params->m_channel(aIndex, bIndex, cIndex);
+            }
+            narrowbandChannel(aIndex, bIndex) = cSum;
+        }
+    }
+
+    MatrixBasedChannelModel::Complex2DVector bQ(bSize, bSize);
+    for (uint16_t b1Index = 0; b1Index < bSize; b1Index++)
+    {
+        for (uint16_t b2Index = 0; b2Index < bSize; b2Index++)
+        {
+            std::complex<double> aSum(0, 0);
+            for (uint16_t aIndex = 0; aIndex < aSize; aIndex++)
+            {
+                aSum += std::conj(narrowbandChannel(aIndex, b1Index)) *
+                        narrowbandChannel(aIndex, b2Index);
+            }
+            bQ(b1Index, b2Index) += aSum;
+        }
+    }
+    PhasedArrayModel::ComplexVector bW = ReferenceFirstEigenvector(bQ, svdIter, svdThresh);
+
+    MatrixBasedChannelModel::Complex2DVector aQ(aSize, aSize);
+    for (uint16_t a1Index = 0; a1Index < aSize; a1Index++)
+    {
+        for (uint16_t a2Index = 0; a2Index < aSize; a2Index++)
+        {
+            std::complex<double> bSum(0, 0);
+            for (uint16_t bIndex = 0; bIndex < bSize; bIndex++)
+            {
+                bSum += narrowbandChannel(a1Index, bIndex) *
+                        std::conj(narrowbandChannel(a2Index, bIndex));
+            }
+            aQ(a1Index, a2Index) += bSum;
+        }
+    }
+    PhasedArrayModel::ComplexVector aW = ReferenceFirstEigenvector(aQ, svdIter, svdThresh);
+
+    for (size_t i = 0; i < aW.GetSize(); ++i)
+    {
+        aW[i] = std::conj(aW[i]);
+    }
+
+    return std::make_pair(bW, aW);
+}
+
+// Test case comparing the channel kernels and the beamforming kernels with frozen
+// reference implementations, over random antenna arrays, MPCs, and timesteps.
+// Any new fast path must be added here, so that it is validated against the references
+class QdChannelTestCaseKernelEquivalence : public TestCase
+{
+  public:
+    QdChannelTestCaseKernelEquivalence();
+    virtual ~QdChannelTestCaseKernelEquivalence();
+
+  private:
+    virtual void DoRun(void);
+
+    /**
+     * MPCs of a link at a timestep, as written in the QD files
+     */
+    struct Mpcs
+    {
+        std::vector<double> delay_s;        //!< delays [s]
+        std::vector<double> pathGain_dbpow; //!< path gains [dB]
+        std::vector<double> phase_rad;      //!< phases [rad]
+        std::vector<double> elAod_deg;      //!< inclination angles of departure [deg]
+        std::vector<double> azAod_deg;      //!< azimuth angles of departure [deg]
+        std::vector<double> elAoa_deg;      //!< inclination angles of arrival [deg]
+        std::vector<double> azAoa_deg;      //!< azimuth angles of arrival [deg]
+    };
+
+    /**
+     * Replace the QD files of the scenario with random MPCs, writing a single direction
+     * of each link, so that the MPCs used by the channel model are known
+     *
+     * \param folder the scenario folder, including the path
+     */
+    void WriteRandomMpcs(const std::string& folder);
+
+    /**
+     * Create a planar array with random spacing, orientation, and element pattern
+     *
+     * \param numColumns the number of columns
+     * \param numRows the number of rows
+     * \return the antenna array
+     */
+    Ptr<PhasedArrayModel> CreateRandomArray(uint32_t numColumns, uint32_t numRows);
+
+    /**
+     * Create a random unit-norm beamforming vector
+     *
+     * \param size the number of elements
+     * \return the beamforming vector
+     */
+    PhasedArrayModel::ComplexVector CreateRandomBeam(size_t size);
+
+    /**
+     * Compute the channel matrix with the original synthesis, one complex exponential per
+     * element, ray, and device, with the element patterns evaluated for each ray
+     *
+     * \param mpcs the MPCs of the link
+     * \param aAntenna the antenna of the a device, i.e., the transmitter of the QD file
+     * \param bAntenna the antenna of the b device
+     * \return the channel matrix, with the rays summed into the first page
+     */
+    MatrixBasedChannelModel::Complex3DVector ComputeReferenceChannel(
+        const Mpcs& mpcs,
+        const Ptr<const PhasedArrayModel>& aAntenna,
+        const Ptr<const PhasedArrayModel>& bAntenna) const;
+
+    /**
+     * Compute the beamformed complex gain of each ray with the original synthesis, i.e.,
+     * bW^T H_k aW, with H_k the reference channel of the k-th ray alone
+     *
+     * \param mpcs the MPCs of the link
+     * \param aAntenna the antenna of the a device
+     * \param bAntenna the antenna of the b device
+     * \param aW beamforming vector of the a device
+     * \param bW beamforming vector of the b device
+     * \return the beamformed gain of each ray
+     */
+    std::vector<std::complex<double>> ComputeReferenceRayGains(
+        const Mpcs& mpcs,
+        const Ptr<const PhasedArrayModel>& aAntenna,
+        const Ptr<const PhasedArrayModel>& bAntenna,
+        const PhasedArrayModel::ComplexVector& aW,
+        const PhasedArrayModel::ComplexVector& bW) const;
+
+    /**
+     * Compare the kernels with the references for all the links at a timestep
+     *
+     * \param timestep the current QD timestep
+     */
+    void CheckTimestep(uint32_t timestep);
+
+    /**
+     * Compare the beamforming kernels with the reference for a channel matrix
+     *
+     * \param channel the channel matrix
+     */
+    void CheckBeamforming(Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel);
+
+    const uint32_t m_numNodes{5};     //!< number of nodes
+    const uint32_t m_numTimesteps{6}; //!< number of timesteps
+    const double m_frequency{60e9};   //!< carrier frequency [Hz]
+
+    Ptr<UniformRandomVariable> m_rv;                 //!< random variable for MPCs and arrays
+    Ptr<QdChannelModel> m_qdChannel;                 //!< the channel model
+    Ptr<QdSpectrumPropagationLossModel> m_lossModel; //!< the PSD kernel
+    NodeContainer m_nodes;                           //!< the nodes
+    std::vector<Ptr<MobilityModel>> m_mobs;          //!< mobility models of the nodes
+    std::map<std::pair<uint32_t, uint32_t>, std::vector<Mpcs>>
+        m_mpcs; //!< MPCs of each link, indexed by RT IDs, and timestep
+    std::map<std::pair<uint32_t, uint32_t>, std::pair<Ptr<PhasedArrayModel>, Ptr<PhasedArrayModel>>>
+        m_arrays; //!< antenna arrays of the a and b devices of each link, indexed by RT IDs
+
+    double m_maxChannelError{0};    //!< max relative error of the channel matrices
+    double m_maxRaysError{0};       //!< max relative error of the rays
+    double m_maxBeamformedError{0}; //!< max relative error of the beamformed gains
+    double m_maxPsdError{0};        //!< max relative error of the received PSD
+    double m_maxDelayBinError{0};   //!< max relative error of the delay bin gains
+    double m_maxSweepError{0};      //!< max relative error of the beam sweep gains
+    double m_maxSvdDeviation{0};    //!< max relative deviation of the SVD gains
+    double m_maxSvdLoss{0};         //!< max relative loss of the SVD gains
+    uint32_t m_numChannels{0};      //!< number of compared channels
+    uint32_t m_numBeamformings{0};  //!< number of compared beamforming computations
+    SvdBeamformer m_svdBeamformer;  //!< warm-started matrix-free beamformer
+    SvdBeamformer m_correlationBeamformer{30, 1e-8, false}; //!< warm-started beamformer
+};
+
+QdChannelTestCaseKernelEquivalence::QdChannelTestCaseKernelEquivalence()
+    : TestCase("QdChannelTestCaseKernelEquivalence")
+{
+}
+
+QdChannelTestCaseKernelEquivalence::~QdChannelTestCaseKernelEquivalence()
+{
+}
+
+void
+QdChannelTestCaseKernelEquivalence::WriteRandomMpcs(const std::string& folder)
+{
+    std::string qdFolder = folder + "Output/Ns3/QdFiles/";
+    for (uint32_t i = 0; i < m_numNodes; i++)
+    {
+        for (uint32_t j = i + 1; j < m_numNodes; j++)
+        {
+            std::remove((qdFolder + "Tx" + std::to_string(j) + "Rx" + std::to_string(i) + ".txt")
+                            .c_str());
+            std::ofstream file(qdFolder + "Tx" + std::to_string(i) + "Rx" + std::to_string(j) +
+                               ".txt");
+            NS_ABORT_MSG_IF(!file.is_open(), "Unable to write the QD files in " << qdFolder);
+            // the values are read back exactly
+            file.precision(17);
+
+            auto writeLine = [&file](const std::vector<double>& values) {
+                for (size_t k = 0; k < values.size(); k++)
+                {
+                    file << (k > 0 ? "," : "") << values[k];
+                }
+                file << "\n";
+            };
+
+            std::vector<Mpcs>& linkMpcs = m_mpcs[std::make_pair(i, j)];
+            for (uint32_t t = 0; t < m_numTimesteps; t++)
+            {
+                // empty channels are included
+                Mpcs mpcs;
+                uint32_t numMpcs = m_rv->GetInteger(0, 12);
+                for (uint32_t k = 0; k < numMpcs; k++)
+                {
+                    mpcs.delay_s.push_back(m_rv->GetValue(1e-9, 1e-7));
+                    mpcs.pathGain_dbpow.push_back(m_rv->GetValue(-120, -50));
+                    mpcs.phase_rad.push_back(m_rv->GetValue(-M_PI, M_PI));
+                    mpcs.elAod_deg.push_back(m_rv->GetValue(0, 180));
+                    mpcs.azAod_deg.push_back(m_rv->GetValue(-180, 180));
+                    mpcs.elAoa_deg.push_back(m_rv->GetValue(0, 180));
+                    mpcs.azAoa_deg.push_back(m_rv->GetValue(-180, 180));
+                }
+                file << numMpcs << "\n";
+                if (numMpcs > 0)
+                {
+                    writeLine(mpcs.delay_s);
+                    writeLine(mpcs.pathGain_dbpow);
+                    writeLine(mpcs.phase_rad);
+                    writeLine(mpcs.elAod_deg);
+                    writeLine(mpcs.azAod_deg);
+                    writeLine(mpcs.elAoa_deg);
+                    writeLine(mpcs.azAoa_deg);
+                }
+                linkMpcs.push_back(mpcs);
+            }
+        }
+    }
+}
+
+Ptr<PhasedArrayModel>
+QdChannelTestCaseKernelEquivalence::CreateRandomArray(uint32_t numColumns, uint32_t numRows)
+{
+    Ptr<AntennaModel> element;
+    if (m_rv->GetValue() < 0.5)
+    {
+        element = CreateObject<IsotropicAntennaModel>();
+    }
+    else
+    {
+        element = CreateObject<ThreeGppAntennaModel>();
+    }
+    return CreateObjectWithAttributes<UniformPlanarArray>(
+        "NumColumns",
+        UintegerValue(numColumns),
+        "NumRows",
+        UintegerValue(numRows),
+        "AntennaHorizontalSpacing",
+        DoubleValue(m_rv->GetValue(0.3, 0.8)),
+        "AntennaVerticalSpacing",
+        DoubleValue(m_rv->GetValue(0.3, 0.8)),
+        "BearingAngle",
+        DoubleValue(m_rv->GetValue(-M_PI, M_PI)),
+        "DowntiltAngle",
+        DoubleValue(m_rv->GetValue(-M_PI / 2, M_PI / 2)),
+        "AntennaElement",
+        PointerValue(element));
+}
+
+PhasedArrayModel::ComplexVector
+QdChannelTestCaseKernelEquivalence::CreateRandomBeam(size_t size)
+{
+    PhasedArrayModel::ComplexVector w(size);
+    for (size_t i = 0; i < size; i++)
+    {
+        w[i] = std::polar(1.0 / std::sqrt(size), m_rv->GetValue(-M_PI, M_PI));
+    }
+    return w;
+}
+
+MatrixBasedChannelModel::Complex3DVector
+QdChannelTestCaseKernelEquivalence::ComputeReferenceChannel(
+    const Mpcs& mpcs,
+    const Ptr<const PhasedArrayModel>& aAntenna,
+    const Ptr<const PhasedArrayModel>& bAntenna) const
+{
+    uint64_t bSize = bAntenna->GetNumberOfElements();
+    uint64_t aSize = aAntenna->GetNumberOfElements();
+    uint64_t numMpcs = mpcs.delay_s.size();
+    MatrixBasedChannelModel::Complex3DVector H(bSize, aSize, numMpcs);
+
+    for (uint64_t mpcIndex = 0; mpcIndex < numMpcs; ++mpcIndex)
+    {
+        double elAoa = DegreesToRadians(mpcs.elAoa_deg[mpcIndex]);
+        double azAoa = DegreesToRadians(mpcs.azAoa_deg[mpcIndex]);
+        double elAod = DegreesToRadians(mpcs.elAod_deg[mpcIndex]);
+        double azAod = DegreesToRadians(mpcs.azAod_deg[mpcIndex]);
+
+        double initialPhase =
+            -2 * M_PI * mpcs.delay_s[mpcIndex] * m_frequency + mpcs.phase_rad[mpcIndex];
+        double pathGain = pow(10, mpcs.pathGain_dbpow[mpcIndex] / 20);
+
+        // ignore polarization
+        double bFieldPattH, bFieldPattV, aFieldPattH, aFieldPattV;
+        std::tie(bFieldPattH, bFieldPattV) =
+            bAntenna->GetElementFieldPattern(Angles(azAoa, elAoa));
+        double bElementGain = std::sqrt(bFieldPattH * bFieldPattH + bFieldPattV * bFieldPattV);
+        std::tie(aFieldPattH, aFieldPattV) =
+            aAntenna->GetElementFieldPattern(Angles(azAod, elAod));
+        double aElementGain = std::sqrt(aFieldPattH * aFieldPattH + aFieldPattV * aFieldPattV);
+
+        double pgTimesGains = pathGain * bElementGain * aElementGain;
+        std::complex<double> complexRay = pgTimesGains * std::polar(1.0, initialPhase);
+
+        for (uint64_t bIndex = 0; bIndex < bSize; ++bIndex)
+        {
+            Vector uLoc = bAntenna->GetElementLocation(bIndex);
+            double bPhaseElementPhase =
+                2 * M_PI *
+                (sin(elAoa) * cos(azAoa) * uLoc.x + sin(elAoa) * sin(azAoa) * uLoc.y +
+                 cos(elAoa) * uLoc.z);
+            std::complex<double> bWeight = std::polar(1.0, bPhaseElementPhase);
+
+            for (uint64_t aIndex = 0; aIndex < aSize; ++aIndex)
+            {
+                Vector sLoc = aAntenna->GetElementLocation(aIndex);
+                double aPhaseElementPhase =
+                    2 * M_PI *
+                    (sin(elAod) * cos(azAod) * sLoc.x + sin(elAod) * sin(azAod) * sLoc.y +
+                     cos(elAod) * sLoc.z);
+                std::complex<double> aWeight = std::polar(1.0, aPhaseElementPhase);
+
+                H(bIndex, aIndex, 0) += complexRay * bWeight * aWeight;
+            }
+        }
+    }
+    return H;
+}
+
+std::vector<std::complex<double>>
+QdChannelTestCaseKernelEquivalence::ComputeReferenceRayGains(
+    const Mpcs& mpcs,
+    const Ptr<const PhasedArrayModel>& aAntenna,
+    const Ptr<const PhasedArrayModel>& bAntenna,
+    const PhasedArrayModel::ComplexVector& aW,
+    const PhasedArrayModel::ComplexVector& bW) const
+{
+    std::vector<std::complex<double>> gains;
+    for (size_t k = 0; k < mpcs.delay_s.size(); k++)
+    {
+        Mpcs ray;
+        ray.delay_s.push_back(mpcs.delay_s[k]);
+        ray.pathGain_dbpow.push_back(mpcs.pathGain_dbpow[k]);
+        ray.phase_rad.push_back(mpcs.phase_rad[k]);
+        ray.elAod_deg.push_back(mpcs.elAod_deg[k]);
+        ray.azAod_deg.push_back(mpcs.azAod_deg[k]);
+        ray.elAoa_deg.push_back(mpcs.elAoa_deg[k]);
+        ray.azAoa_deg.push_back(mpcs.azAoa_deg[k]);
+        MatrixBasedChannelModel::Complex3DVector H =
+            ComputeReferenceChannel(ray, aAntenna, bAntenna);
+
+        std::complex<double> gain(0, 0);
+        for (size_t bIndex = 0; bIndex < H.GetNumRows(); bIndex++)
+        {
+            for (size_t aIndex = 0; aIndex < H.GetNumCols(); aIndex++)
+            {
+                gain += bW[bIndex] * H(bIndex, aIndex, 0) * aW[aIndex];
+            }
+        }
+        gains.push_back(gain);
+    }
+    return gains;
+}
+
+void
+QdChannelTestCaseKernelEquivalence::CheckTimestep(uint32_t timestep)
+{
+    for (const auto& link : m_mpcs)
+    {
+        uint32_t i = link.first.first;
+        uint32_t j = link.first.second;
+        const Mpcs& mpcs = link.second[timestep];
+        Ptr<PhasedArrayModel> aAntenna = m_arrays[link.first].first;
+        Ptr<PhasedArrayModel> bAntenna = m_arrays[link.first].second;
+        uint64_t aSize = aAntenna->GetNumberOfElements();
+        uint64_t bSize = bAntenna->GetNumberOfElements();
+
+        MatrixBasedChannelModel::Complex3DVector reference =
+            ComputeReferenceChannel(mpcs, aAntenna, bAntenna);
+        double maxReference = 0;
+        double frobenius = 0;
+        for (uint64_t bIndex = 0; bIndex < bSize; bIndex++)
+        {
+            for (uint64_t aIndex = 0; aIndex < aSize; aIndex++)
+            {
+                maxReference = std::max(maxReference, std::abs(reference(bIndex, aIndex, 0)));
+                frobenius += std::norm(reference(bIndex, aIndex, 0));
+            }
+        }
+        frobenius = std::sqrt(frobenius);
+
+        // channel synthesis
+        Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel =
+            m_qdChannel->GetChannel(m_mobs[i], m_mobs[j], aAntenna, bAntenna);
+        NS_TEST_ASSERT_MSG_EQ(channel->m_channel.GetNumRows(), bSize, "Checking the rows");
+        NS_TEST_ASSERT_MSG_EQ(channel->m_channel.GetNumCols(), aSize, "Checking the columns");
+        NS_TEST_ASSERT_MSG_EQ(channel->m_channel.GetNumPages(),
+                              mpcs.delay_s.size(),
+                              "Checking the pages");
+        m_numChannels++;
+        if (mpcs.delay_s.empty())
+        {
+            continue;
+        }
+
+        // ray decomposition
+        Ptr<const QdChannelModel::ChannelRays> rays =
+            m_qdChannel->GetChannelRays(m_nodes.Get(i)->GetId(),
+                                        m_nodes.Get(j)->GetId(),
+                                        aAntenna,
+                                        bAntenna,
+                                        timestep);
+        for (uint64_t bIndex = 0; bIndex < bSize; bIndex++)
+        {
+            for (uint64_t aIndex = 0; aIndex < aSize; aIndex++)
+            {
+                std::complex<double> narrowband(0, 0);
+                for (size_t page = 0; page < channel->m_channel.GetNumPages(); page++)
+                {
+                    narrowband += channel->m_channel(bIndex, aIndex, page);
+                }
+                m_maxChannelError =
+                    std::max(m_maxChannelError,
+                             std::abs(narrowband - reference(bIndex, aIndex, 0)) / maxReference);
+
+                std::complex<double> sum(0, 0);
+                for (size_t k = 0; k < rays->m_rayGain.size(); k++)
+                {
+                    sum += rays->m_rayGain[k] * rays->m_bSteering(bIndex, k) *
+                           rays->m_aSteering(aIndex, k);
+                }
+                m_maxRaysError = std::max(m_maxRaysError,
+                                          std::abs(sum - reference(bIndex, aIndex, 0)) /
+                                              maxReference);
+            }
+        }
+
+        // beamformed gains and received PSD, for random beams
+        PhasedArrayModel::ComplexVector aW = CreateRandomBeam(aSize);
+        PhasedArrayModel::ComplexVector bW = CreateRandomBeam(bSize);
+        std::complex<double> expected(0, 0);
+        for (uint64_t bIndex = 0; bIndex < bSize; bIndex++)
+        {
+            for (uint64_t aIndex = 0; aIndex < aSize; aIndex++)
+            {
+                expected += bW[bIndex] * reference(bIndex, aIndex, 0) * aW[aIndex];
+            }
+        }
+        std::vector<std::complex<double>> gains =
+            m_qdChannel->GetBeamformedRayGains(m_mobs[i], m_mobs[j], aAntenna, bAntenna, aW, bW);
+        std::complex<double> beamformed(0, 0);
+        for (const auto& gain : gains)
+        {
+            beamformed += gain;
+        }
+        m_maxBeamformedError =
+            std::max(m_maxBeamformedError, std::abs(beamformed - expected) / frobenius);
+
+        // the responses of the delay bins and of the PSD bands are sums of rotated ray gains,
+        // so they are bounded by the sum of the magnitudes of the ray gains
+        std::vector<std::complex<double>> referenceRayGains =
+            ComputeReferenceRayGains(mpcs, aAntenna, bAntenna, aW, bW);
+        double rayScale = 0;
+        for (const auto& gain : referenceRayGains)
+        {
+            rayScale += std::abs(gain);
+        }
+
+        // delay bins
+        Time binWidth = NanoSeconds(m_rv->GetInteger(1, 30));
+        std::vector<std::complex<double>> expectedBins;
+        for (size_t k = 0; k < mpcs.delay_s.size(); k++)
+        {
+            auto bin = static_cast<size_t>(mpcs.delay_s[k] / binWidth.GetSeconds());
+            if (bin >= expectedBins.size())
+            {
+                expectedBins.resize(bin + 1);
+            }
+            expectedBins[bin] += referenceRayGains[k];
+        }
+        std::vector<std::complex<double>> binGains =
+            m_qdChannel->GetBeamformedDelayBinGains(m_mobs[i],
+                                                    m_mobs[j],
+                                                    aAntenna,
+                                                    bAntenna,
+                                                    aW,
+                                                    bW,
+                                                    binWidth);
+        NS_TEST_ASSERT_MSG_EQ(binGains.size(),
+                              expectedBins.size(),
+                              "Checking the number of delay bins");
+        for (size_t bin = 0; bin < std::min(binGains.size(), expectedBins.size()); bin++)
+        {
+            m_maxDelayBinError = std::max(m_maxDelayBinError,
+                                          std::abs(binGains[bin] - expectedBins[bin]) /
+                                              rayScale);
+        }
+
+        // received PSD with a single band, with uniformly spaced bands, which are computed
+        // by the phase-rotation recurrence, and with randomly spaced bands
+        aAntenna->SetBeamformingVector(aW);
+        bAntenna->SetBeamformingVector(bW);
+        uint32_t numBands = m_rv->GetInteger(2, 64);
+        double df = m_rv->GetValue(1e6, 1e8);
+        std::vector<double> uniformFreqs;
+        std::vector<double> randomFreqs;
+        for (uint32_t band = 0; band < numBands; band++)
+        {
+            uniformFreqs.push_back(m_frequency + (band - (numBands - 1) / 2.0) * df);
+            randomFreqs.push_back(m_frequency + m_rv->GetValue(-0.5, 0.5) * numBands * df);
+        }
+        std::sort(randomFreqs.begin(), randomFreqs.end());
+        for (const auto& freqs : {std::vector<double>{m_frequency}, uniformFreqs, randomFreqs})
+        {
+            Ptr<SpectrumValue> txPsd = Create<SpectrumValue>(Create<SpectrumModel>(freqs));
+            *txPsd = 1.0;
+            Ptr<SpectrumSignalParameters> params = Create<SpectrumSignalParameters>();
+            params->psd = txPsd;
+            Ptr<SpectrumValue> rxPsd = m_lossModel->CalcRxPowerSpectralDensity(params,
+                                                                               m_mobs[i],
+                                                                               m_mobs[j],
+                                                                               aAntenna,
+                                                                               bAntenna);
+            // the center of the PSD is mapped onto the carrier frequency
+            double refFrequency = (freqs.front() + freqs.back()) / 2;
+            for (size_t band = 0; band < freqs.size(); band++)
+            {
+                std::complex<double> response(0, 0);
+                for (size_t k = 0; k < referenceRayGains.size(); k++)
+                {
+                    response +=
+                        referenceRayGains[k] *
+                        std::polar(1.0, -2 * M_PI * (freqs[band] - refFrequency) * mpcs.delay_s[k]);
+                }
+                m_maxPsdError = std::max(m_maxPsdError,
+                                         std::abs((*rxPsd)[band] - std::norm(response)) /
+                                             (rayScale * rayScale));
+            }
+        }
+
+        // beam sweep over sine-space codebooks of random size
+        BeamCodebook aCodebook =
+            CreateSineSpaceCodebook(aAntenna, m_rv->GetInteger(1, 4), m_rv->GetInteger(1, 3));
+        BeamCodebook bCodebook =
+            CreateSineSpaceCodebook(bAntenna, m_rv->GetInteger(1, 4), m_rv->GetInteger(1, 3));
+        MatrixBasedChannelModel::Double2DVector sweepGains =
+            ComputeBeamSweepGains(rays, aCodebook, bCodebook, 2);
+        double maxSweepGain = 0;
+        for (size_t aBeam = 0; aBeam < aCodebook.size(); aBeam++)
+        {
+            for (size_t bBeam = 0; bBeam < bCodebook.size(); bBeam++)
+            {
+                std::complex<double> response(0, 0);
+                for (uint64_t bIndex = 0; bIndex < bSize; bIndex++)
+                {
+                    for (uint64_t aIndex = 0; aIndex < aSize; aIndex++)
+                    {
+                        response += bCodebook[bBeam][bIndex] * reference(bIndex, aIndex, 0) *
+                                    aCodebook[aBeam][aIndex];
+                    }
+                }
+                maxSweepGain = std::max(maxSweepGain, std::norm(response));
+                m_maxSweepError = std::max(m_maxSweepError,
+                                           std::abs(sweepGains[aBeam][bBeam] -
+                                                    std::norm(response)) /
+                                               (frobenius * frobenius));
+            }
+        }
+        std::vector<BeamPairGain> best = GetBestBeamPairs(rays, aCodebook, bCodebook, 1, 2);
+        NS_TEST_ASSERT_MSG_EQ(best.size(), 1, "Checking the number of best beam pairs");
+        m_maxSweepError = std::max(m_maxSweepError,
+                                   std::abs(best[0].gain - maxSweepGain) /
+                                       (frobenius * frobenius));
+
+        CheckBeamforming(channel);
+    }
+}
+
+void
+QdChannelTestCaseKernelEquivalence::CheckBeamforming(
+    Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel)
+{
+    // |w1^T H w0|^2, with H summed over the pages
+    auto gain = [&channel](const std::pair<PhasedArrayModel::ComplexVector,
+                                           PhasedArrayModel::ComplexVector>& w) {
+        std::complex<double> response(0, 0);
+        for (size_t row = 0; row < channel->m_channel.GetNumRows(); row++)
+        {
+            for (size_t col = 0; col < channel->m_channel.GetNumCols(); col++)
+            {
+                for (size_t page = 0; page < channel->m_channel.GetNumPages(); page++)
+                {
+                    response += w.second[row] * channel->m_channel(row, col, page) * w.first[col];
+                }
+            }
+        }
+        return std::norm(response);
+    };
+
+    double referenceGain = gain(ReferenceSvdBeamformingVectors(channel));
+    std::vector<double> kernelGains = {
+        gain(ComputeSvdBeamformingVectors(channel)),
+        gain(ComputeSvdBeamformingVectorsMatrixFree(channel)),
+        gain(m_svdBeamformer.ComputeBeamformingVectors(channel)),
+        gain(m_correlationBeamformer.ComputeBeamformingVectors(channel)),
+    };
+    for (double kernelGain : kernelGains)
+    {
+        // the kernels may converge closer to the largest singular value than the reference,
+        // but must not lose gain
+        double deviation = (kernelGain - referenceGain) / referenceGain;
+        m_maxSvdDeviation = std::max(m_maxSvdDeviation, std::abs(deviation));
+        m_maxSvdLoss = std::max(m_maxSvdLoss, -deviation);
+    }
+    m_numBeamformings++;
+}
+
+void
+QdChannelTestCaseKernelEquivalence::DoRun(void)
+{
+    // the scenario is generated at the default carrier frequency of 60 GHz, and its MPCs are
+    // then replaced by random ones
+    SyntheticScenario synthetic =
+        CreateSyntheticScenario(CreateTempDirFilename(""), m_numNodes, m_numTimesteps);
+    m_nodes = synthetic.nodes;
+    m_mobs = synthetic.mobs;
+
+    m_rv = CreateObject<UniformRandomVariable>();
+    m_rv->SetStream(1000);
+    WriteRandomMpcs(synthetic.path + "/" + synthetic.name + "/");
+    // the arrays of each link are kept over the timesteps, to warm-start the beamformers.
+    // Half of the links have two arrays among the sizes with specialized kernels, drawn
+    // independently, the others have arrays of random size
+    const std::vector<std::pair<uint32_t, uint32_t>> commonSizes = {{1, 1},
+                                                                    {2, 2},
+                                                                    {4, 4},
+                                                                    {8, 8},
+                                                                    {16, 4}};
+    for (const auto& link : m_mpcs)
+    {
+        if (m_rv->GetValue() < 0.5)
+        {
+            auto aSize = commonSizes[m_rv->GetInteger(0, commonSizes.size() - 1)];
+            auto bSize = commonSizes[m_rv->GetInteger(0, commonSizes.size() - 1)];
+            m_arrays[link.first] = std::make_pair(CreateRandomArray(aSize.first, aSize.second),
+                                                  CreateRandomArray(bSize.first, bSize.second));
+        }
+        else
+        {
+            Ptr<PhasedArrayModel> aArray =
+                CreateRandomArray(m_rv->GetInteger(1, 6), m_rv->GetInteger(1, 6));
+            Ptr<PhasedArrayModel> bArray =
+                CreateRandomArray(m_rv->GetInteger(1, 6), m_rv->GetInteger(1, 6));
+            m_arrays[link.first] = std::make_pair(aArray, bArray);
+        }
+    }
+    m_qdChannel = CreateObject<QdChannelModel>(synthetic.path, synthetic.name);
+    m_lossModel = CreateObjectWithAttributes<QdSpectrumPropagationLossModel>(
+        "ChannelModel",
+        PointerValue(m_qdChannel));
+
+    for (uint32_t t = 0; t < m_numTimesteps; t++)
+    {
+        Simulator::Schedule(MilliSeconds(100 * t + 50),
+                            &QdChannelTestCaseKernelEquivalence::CheckTimestep,
+                            this,
+                            t);
+    }
+    Simulator::Run();
+
+    NS_LOG_INFO("Compared " << m_numChannels << " channels and " << m_numBeamformings
+                            << " beamforming computations: max relative error of the "
+                            << "channels " << m_maxChannelError << ", of the rays "
+                            << m_maxRaysError << ", of the beamformed gains "
+                            << m_maxBeamformedError << ", of the delay bins "
+                            << m_maxDelayBinError << ", of the PSD " << m_maxPsdError
+                            << ", of the beam sweep " << m_maxSweepError
+                            << ", max SVD gain deviation " << m_maxSvdDeviation
+                            << ", max SVD gain loss " << m_maxSvdLoss);
+    NS_TEST_ASSERT_MSG_EQ(m_numChannels,
+                          m_numTimesteps * m_numNodes * (m_numNodes - 1) / 2,
+                          "Checking the number of compared channels");
+    NS_TEST_ASSERT_MSG_GT(m_numBeamformings, 0, "Checking the number of beamforming checks");
+    NS_TEST_ASSERT_MSG_LT(m_maxChannelError, 1e-9, "Max relative error of the channels");
+    NS_TEST_ASSERT_MSG_LT(m_maxRaysError, 1e-9, "Max relative error of the rays");
+    NS_TEST_ASSERT_MSG_LT(m_maxBeamformedError, 1e-9, "Max relative error of the gains");
+    NS_TEST_ASSERT_MSG_LT(m_maxDelayBinError, 1e-9, "Max relative error of the delay bins");
+    NS_TEST_ASSERT_MSG_LT(m_maxPsdError, 1e-9, "Max relative error of the PSD");
+    NS_TEST_ASSERT_MSG_LT(m_maxSweepError, 1e-9, "Max relative error of the beam sweep");
+    NS_TEST_ASSERT_MSG_LT(m_maxSvdLoss, 1e-4, "Max relative loss of the SVD gains");
+    // the reference power iteration stops after 30 iterations, a few percent below the
+    // largest singular value in the worst case
+    NS_TEST_ASSERT_MSG_LT(m_maxSvdDeviation, 5e-2, "Max relative deviation of the SVD gains");
+
+    Simulator::Destroy();
+}
+
+// Test case for the reuse of the buffers of the retired channels
+class QdChannelTestCaseBufferReuse : public TestCase
+{
+  public:
+    QdChannelTestCaseBufferReuse();
+    virtual ~QdChannelTestCaseBufferReuse();
+
+  private:
+    virtual void DoRun(void);
+
+    /**
+     * Compare the channels of the models reusing the buffers with the reference one,
+     * and check that the channels held by the caller are not modified
+     *
+     * \param timestep the current QD timestep
+     */
+    void CheckTimestep(uint32_t timestep);
+
+    /**
+     * Compare a channel and its parameters with the reference ones
+     *
+     * \param channel the channel matrix
+     * \param params the channel parameters
+     * \param reference the reference channel matrix
+     * \param referenceParams the reference channel parameters
+     * \param model the name of the model, for the messages
+     */
+    void CheckChannel(Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel,
+                      Ptr<const MatrixBasedChannelModel::ChannelParams> params,
+                      Ptr<const MatrixBasedChannelModel::ChannelMatrix> reference,
+                      Ptr<const MatrixBasedChannelModel::ChannelParams> referenceParams,
+                      const std::string& model);
+
+    const uint32_t m_numTimesteps{5}; //!< number of timesteps
+
+    Ptr<QdChannelModel> m_reference;             //!< model allocating each channel
+    Ptr<QdChannelModel> m_steady;                //!< model whose channels are released
+    Ptr<QdChannelModel> m_holding;               //!< model whose channels are held
+    std::vector<Ptr<MobilityModel>> m_mobs;      //!< mobility models of the nodes
+    std::vector<Ptr<PhasedArrayModel>> m_arrays; //!< antenna arrays of the nodes
+    std::deque<std::pair<Ptr<const MatrixBasedChannelModel::ChannelMatrix>,
+                         MatrixBasedChannelModel::Complex3DVector>>
+        m_held; //!< channels held by the caller, with a copy of their values
+};
+
+QdChannelTestCaseBufferReuse::QdChannelTestCaseBufferReuse()
+    : TestCase("QdChannelTestCaseBufferReuse")
+{
+}
+
+QdChannelTestCaseBufferReuse::~QdChannelTestCaseBufferReuse()
+{
+}
+
+void
+QdChannelTestCaseBufferReuse::CheckChannel(
+    Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel,
+    Ptr<const MatrixBasedChannelModel::ChannelParams> params,
+    Ptr<const MatrixBasedChannelModel::ChannelMatrix> reference,
+    Ptr<const MatrixBasedChannelModel::ChannelParams> referenceParams,
+    const std::string& model)
+{
+    NS_TEST_ASSERT_MSG_EQ(channel->m_channel.GetNumPages(),
+                          reference->m_channel.GetNumPages(),
+                          "Checking the number of rays of the " << model << " model");
+    for (size_t i = 0; i < reference->m_channel.GetSize(); i++)
+    {
+        NS_TEST_ASSERT_MSG_EQ(channel->m_channel[i],
+                              reference->m_channel[i],
+                              "Checking coefficient " << i << " of the " << model << " model");
+    }
+    NS_TEST_ASSERT_MSG_EQ((params->m_delay == referenceParams->m_delay),
+                          true,
+                          "Checking the delays of the " << model << " model");
+    NS_TEST_ASSERT_MSG_EQ((params->m_angle == referenceParams->m_angle),
+                          true,
+                          "Checking the angles of the " << model << " model");
+    NS_TEST_ASSERT_MSG_EQ(params->m_alpha.size(),
+                          referenceParams->m_alpha.size(),
+                          "Checking the Doppler terms of the " << model << " model");
+}
+
+void
+QdChannelTestCaseBufferReuse::CheckTimestep(uint32_t timestep)
+{
+    Ptr<const MatrixBasedChannelModel::ChannelMatrix> reference =
+        m_reference->GetChannel(m_mobs[0], m_mobs[1], m_arrays[0], m_arrays[1]);
+    Ptr<const MatrixBasedChannelModel::ChannelParams> referenceParams =
+        m_reference->GetParams(m_mobs[0], m_mobs[1]);
+
+    Ptr<const MatrixBasedChannelModel::ChannelMatrix> steady =
+        m_steady->GetChannel(m_mobs[0], m_mobs[1], m_arrays[0], m_arrays[1]);
+    CheckChannel(steady,
+                 m_steady->GetParams(m_mobs[0], m_mobs[1]),
+                 reference,
+                 referenceParams,
+                 "steady");
+
+    Ptr<const MatrixBasedChannelModel::ChannelMatrix> held =
+        m_holding->GetChannel(m_mobs[0], m_mobs[1], m_arrays[0], m_arrays[1]);
+    CheckChannel(held,
+                 m_holding->GetParams(m_mobs[0], m_mobs[1]),
+                 reference,
+                 referenceParams,
+                 "holding");
+
+    // the channel of two timesteps ago is released once the new one has been generated
+    m_held.emplace_back(held, held->m_channel);
+    if (m_held.size() > 2)
+    {
+        for (size_t i = 0; i < m_held.front().second.GetSize(); i++)
+        {
+            NS_TEST_ASSERT_MSG_EQ(m_held.front().first->m_channel[i],
+                                  m_held.front().second[i],
+                                  "A held channel should not be modified, timestep "
+                                      << timestep);
+        }
+        m_held.pop_front();
+    }
+}
+
+void
+QdChannelTestCaseBufferReuse::DoRun(void)
+{
+    // the dimensions of the channel matrix do not change, so that its buffer can be reused
+    SyntheticScenario synthetic =
+        CreateSyntheticScenario(CreateTempDirFilename(""), 2, m_numTimesteps, 5);
+    m_mobs = synthetic.mobs;
+    m_arrays = synthetic.arrays;
+
+    m_reference = CreateObject<QdChannelModel>();
+    m_reference->SetAttribute("ReuseChannelBuffers", BooleanValue(false));
+    m_reference->SetPath(synthetic.path);
+    m_reference->SetScenario(synthetic.name);
+    m_steady = CreateObject<QdChannelModel>(synthetic.path, synthetic.name);
+    m_holding = CreateObject<QdChannelModel>(synthetic.path, synthetic.name);
+
+    for (uint32_t t = 0; t < m_numTimesteps; t++)
+    {
+        Simulator::Schedule(MilliSeconds(100 * t + 50),
+                            &QdChannelTestCaseBufferReuse::CheckTimestep,
+                            this,
+                            t);
+    }
+    Simulator::Run();
+
+    QdChannelModel::Stats stats = m_reference->GetStats();
+    NS_TEST_ASSERT_MSG_EQ(stats.regenerations, m_numTimesteps, "Checking the regenerations");
+    NS_TEST_ASSERT_MSG_EQ(stats.reusedChannels + stats.pooledChannels,
+                          0,
+                          "No buffer should be reused when disabled");
+
+    // from the third timestep, each channel is generated in the buffers retired by the
+    // previous regeneration, which are no longer held
+    stats = m_steady->GetStats();
+    NS_TEST_ASSERT_MSG_EQ(stats.regenerations, m_numTimesteps, "Checking the regenerations");
+    NS_TEST_ASSERT_MSG_EQ(stats.reusedChannels,
+                          m_numTimesteps - 2,
+                          "Checking the channels in reused buffers");
+    NS_TEST_ASSERT_MSG_EQ(stats.pooledChannels, 0, "Checking the channels in pooled buffers");
+
+    // the retired buffers are still held by the caller, thus they are pooled, and reused
+    // once released, from the fourth timestep
+    stats = m_holding->GetStats();
+    NS_TEST_ASSERT_MSG_EQ(stats.reusedChannels, 0, "Held buffers should not be reused");
+    NS_TEST_ASSERT_MSG_EQ(stats.pooledChannels,
+                          m_numTimesteps - 3,
+                          "Checking the channels in pooled buffers");
+
+    m_held.clear();
+    Simulator::Destroy();
+}
+
+// Test case for the channel access through the resolved link handles
+class QdChannelTestCaseLinkHandle : public TestCase
+{
+  public:
+    QdChannelTestCaseLinkHandle();
+    virtual ~QdChannelTestCaseLinkHandle();
+
+  private:
+    virtual void DoRun(void);
+};
+
+QdChannelTestCaseLinkHandle::QdChannelTestCaseLinkHandle()
+    : TestCase("QdChannelTestCaseLinkHandle")
+{
+}
+
+QdChannelTestCaseLinkHandle::~QdChannelTestCaseLinkHandle()
+{
+}
+
+void
+QdChannelTestCaseLinkHandle::DoRun(void)
+{
+    SyntheticScenario synthetic = CreateSyntheticScenario(CreateTempDirFilename(""), 2, 1);
+    const std::vector<Ptr<MobilityModel>>& mobs = synthetic.mobs;
+    const std::vector<Ptr<PhasedArrayModel>>& arrays = synthetic.arrays;
+
+    // a handle resolved before loading the scenario looks the link up again when used
+    Ptr<QdChannelModel> qdChannel = CreateObject<QdChannelModel>();
+    QdChannelModel::LinkHandle early =
+        qdChannel->ResolveLink(mobs[0], mobs[1], arrays[0], arrays[1]);
+    NS_TEST_ASSERT_MSG_EQ((early.slot == nullptr), true, "No link should be loaded yet");
+    qdChannel->SetPath(synthetic.path);
+    qdChannel->SetScenario(synthetic.name);
+    Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel = qdChannel->GetChannel(early);
+    NS_TEST_ASSERT_MSG_GT(channel->m_channel.GetNumPages(), 0, "The channel should have rays");
+
+    // handles resolved afterwards point to the slot of the link, in either direction
+    QdChannelModel::LinkHandle handle =
+        qdChannel->ResolveLink(mobs[0], mobs[1], arrays[0], arrays[1]);
+    QdChannelModel::LinkHandle reverse =
+        qdChannel->ResolveLink(mobs[1], mobs[0], arrays[1], arrays[0]);
+    NS_TEST_ASSERT_MSG_EQ((handle.slot != nullptr), true, "The link should be resolved");
+    NS_TEST_ASSERT_MSG_EQ((reverse.slot == handle.slot), true, "Links should be reciprocal");
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->GetChannel(handle),
+                          channel,
+                          "The handle should return the cached channel");
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->GetChannel(reverse),
+                          channel,
+                          "The reverse handle should return the cached channel");
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->GetChannel(mobs[0], mobs[1], arrays[0], arrays[1]),
+                          channel,
+                          "The handle and the mobility models should share the channel");
+    NS_TEST_ASSERT_MSG_EQ(qdChannel->GetParams(handle),
+                          qdChannel->GetParams(mobs[0], mobs[1]),
+                          "The handle and the mobility models should share the params");
+
+    QdChannelModel::Stats stats = qdChannel->GetStats();
+    NS_TEST_ASSERT_MSG_EQ(stats.getChannelCalls, 4, "Checking the GetChannel calls");
+    NS_TEST_ASSERT_MSG_EQ(stats.cacheHits, 3, "Checking the cache hits");
+    NS_TEST_ASSERT_MSG_EQ(stats.regenerations, 1, "Checking the regenerations");
+
+    Simulator::Destroy();
+}
+
+// Test case for the switch to a preloaded scenario
+class QdChannelTestCasePreloadScenario : public TestCase
+{
+  public:
+    QdChannelTestCasePreloadScenario();
+    virtual ~QdChannelTestCasePreloadScenario();
+
+  private:
+    virtual void DoRun(void);
+
+    /**
+     * Check that the channel of the link is the one of the given scenario, through the
+     * mobility models and the handle resolved before the switch
+     *
+     * \param reference a model with the expected scenario
+     * \param timestep the expected timestep of the scenario
+     * \param numMpcs the number of MPCs of the expected scenario
+     */
+    void CheckChannel(Ptr<QdChannelModel> reference, uint64_t timestep, uint32_t numMpcs);
+
+    Ptr<QdChannelModel> m_qdChannel;             //!< model switching scenario
+    QdChannelModel::LinkHandle m_handle;         //!< handle resolved before the switch
+    std::vector<Ptr<MobilityModel>> m_mobs;      //!< mobility models of the nodes
+    std::vector<Ptr<PhasedArrayModel>> m_arrays; //!< antenna arrays of the nodes
+    uint32_t m_numChecks{0};                     //!< number of checks performed
+};
+
+QdChannelTestCasePreloadScenario::QdChannelTestCasePreloadScenario()
+    : TestCase("QdChannelTestCasePreloadScenario")
+{
+}
+
+QdChannelTestCasePreloadScenario::~QdChannelTestCasePreloadScenario()
+{
+}
+
+void
+QdChannelTestCasePreloadScenario::CheckChannel(Ptr<QdChannelModel> reference,
+                                               uint64_t timestep,
+                                               uint32_t numMpcs)
+{
+    Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel =
+        m_qdChannel->GetChannel(m_mobs[0], m_mobs[1], m_arrays[0], m_arrays[1]);
+    NS_TEST_ASSERT_MSG_EQ(channel->m_channel.GetNumPages(),
+                          numMpcs,
+                          "Checking the scenario at " << Simulator::Now().GetMilliSeconds()
+                                                      << " ms");
+    NS_TEST_ASSERT_MSG_EQ(m_qdChannel->GetChannel(m_handle),
+                          channel,
+                          "The handle should still reach the link");
+    NS_TEST_ASSERT_MSG_EQ(m_qdChannel->GetSharedChannel(m_handle).get(),
+                          PeekPointer(channel),
+                          "The shared accessor should still reach the link");
+
+    uint32_t aId = m_mobs[0]->GetObject<Node>()->GetId();
+    uint32_t bId = m_mobs[1]->GetObject<Node>()->GetId();
+    Ptr<const QdChannelModel::ChannelRays> expected =
+        reference->GetChannelRays(aId, bId, m_arrays[0], m_arrays[1], timestep);
+    Ptr<const QdChannelModel::ChannelRays> rays =
+        m_qdChannel->GetChannelRays(m_mobs[0], m_mobs[1], m_arrays[0], m_arrays[1]);
+    NS_TEST_ASSERT_MSG_EQ(rays->m_rayGain.size(), numMpcs, "Checking the number of rays");
+    for (size_t k = 0; k < numMpcs; k++)
+    {
+        NS_TEST_ASSERT_MSG_EQ(rays->m_rayGain[k],
+                              expected->m_rayGain[k],
+                              "Checking ray " << k << " of timestep " << timestep);
+    }
+    m_numChecks++;
+}
+
+void
+QdChannelTestCasePreloadScenario::DoRun(void)
+{
+    // the second scenario draws the same positions, with another number of rays
+    uint32_t numTimesteps = 3;
+    SyntheticScenario synthetic =
+        CreateSyntheticScenario(CreateTempDirFilename(""), 2, numTimesteps, 5);
+    m_mobs = synthetic.mobs;
+    m_arrays = synthetic.arrays;
+    Ptr<QdScenarioGenerator> next = CreateObject<QdScenarioGenerator>();
+    next->SetAttribute("NumNodes", UintegerValue(2));
+    next->SetAttribute("NumTimesteps", UintegerValue(numTimesteps));
+    next->SetAttribute("TotalTimeDuration", TimeValue(MilliSeconds(100 * numTimesteps)));
+    next->SetAttribute("NumMpcs", StringValue("ns3::ConstantRandomVariable[Constant=3]"));
+    next->AssignStreams(0);
+    next->Generate(synthetic.path, "SyntheticNext");
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        NS_TEST_ASSERT_MSG_EQ(next->GetNodePositions()[i],
+                              synthetic.generator->GetNodePositions()[i],
+                              "The scenarios should have the same positions");
+    }
+
+    Ptr<QdChannelModel> previous = CreateObject<QdChannelModel>(synthetic.path, synthetic.name);
+    Ptr<QdChannelModel> following = CreateObject<QdChannelModel>(synthetic.path, "SyntheticNext");
+    m_qdChannel = CreateObject<QdChannelModel>(synthetic.path, synthetic.name);
+    m_handle = m_qdChannel->ResolveLink(m_mobs[0], m_mobs[1], m_arrays[0], m_arrays[1]);
+
+    // the timesteps of the new scenario start at the switch time
+    m_qdChannel->PreloadScenario("SyntheticNext", MilliSeconds(150));
+    Simulator::Schedule(MilliSeconds(50),
+                        &QdChannelTestCasePreloadScenario::CheckChannel,
+                        this,
+                        previous,
+                        0,
+                        5);
+    Simulator::Schedule(MilliSeconds(120),
+                        &QdChannelTestCasePreloadScenario::CheckChannel,
+                        this,
+                        previous,
+                        1,
+                        5);
+    Simulator::Schedule(MilliSeconds(200),
+                        &QdChannelTestCasePreloadScenario::CheckChannel,
+                        this,
+                        following,
+                        0,
+                        3);
+    Simulator::Schedule(MilliSeconds(260),
+                        &QdChannelTestCasePreloadScenario::CheckChannel,
+                        this,
+                        following,
+                        1,
+                        3);
+
+    // a model destroyed before its switch time cancels the switch
+    {
+        Ptr<QdChannelModel> discarded =
+            CreateObject<QdChannelModel>(synthetic.path, synthetic.name);
+        discarded->PreloadScenario("SyntheticNext", MilliSeconds(100));
+    }
+
+    Simulator::Run();
+    NS_TEST_ASSERT_MSG_EQ(m_numChecks, 4, "Checking the number of checks");
+
+    m_qdChannel = nullptr;
+    Simulator::Destroy();
+}
+
+// Test case for the memoization of the beamforming vectors by SvdBeamformer
+class QdChannelTestCaseSvdBeamformer : public TestCase
+{
+  public:
+    QdChannelTestCaseSvdBeamformer();
+    virtual ~QdChannelTestCaseSvdBeamformer();
+
+  private:
+    virtual void DoRun(void);
+
+    /**
+     * Compute the beamforming vectors for the current channel, and check the counters of
+     * the beamformer
+     *
+     * \param computations the expected number of computations
+     * \param cacheHits the expected number of calls served by memoized vectors
+     */
+    void Beamform(uint64_t computations, uint64_t cacheHits);
+
+    Ptr<QdChannelModel> m_qdChannel;             //!< the channel model
+    std::vector<Ptr<MobilityModel>> m_mobs;      //!< mobility models of the nodes
+    std::vector<Ptr<PhasedArrayModel>> m_arrays; //!< antennas of the nodes
+    SvdBeamformer m_beamformer;                  //!< the beamformer
+    uint32_t m_numChecks{0};                     //!< number of checks performed
+};
+
+QdChannelTestCaseSvdBeamformer::QdChannelTestCaseSvdBeamformer()
+    : TestCase("QdChannelTestCaseSvdBeamformer")
+{
+}
+
+QdChannelTestCaseSvdBeamformer::~QdChannelTestCaseSvdBeamformer()
+{
+}
+
+void
+QdChannelTestCaseSvdBeamformer::Beamform(uint64_t computations, uint64_t cacheHits)
+{
+    Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel =
+        m_qdChannel->GetChannel(m_mobs[0], m_mobs[1], m_arrays[0], m_arrays[1]);
+    auto bfVectors = m_beamformer.ComputeBeamformingVectors(channel);
+    NS_TEST_ASSERT_MSG_EQ(m_beamformer.GetNumComputations(),
+                          computations,
+                          "Checking the computations at " << Simulator::Now().GetMilliSeconds()
+                                                          << " ms");
+    NS_TEST_ASSERT_MSG_EQ(m_beamformer.GetNumCacheHits(),
+                          cacheHits,
+                          "Checking the cache hits at " << Simulator::Now().GetMilliSeconds()
+                                                        << " ms");
+
+    // the vectors are those of the current channel, as computed by a new beamformer
+    auto gain = [&channel](const std::pair<PhasedArrayModel::ComplexVector,
+                                           PhasedArrayModel::ComplexVector>& w) {
+        std::complex<double> response(0, 0);
+        for (size_t row = 0; row < channel->m_channel.GetNumRows(); row++)
+        {
+            for (size_t col = 0; col < channel->m_channel.GetNumCols(); col++)
+            {
+                for (size_t page = 0; page < channel->m_channel.GetNumPages(); page++)
+                {
+                    response += w.second[row] * channel->m_channel(row, col, page) * w.first[col];
+                }
+            }
+        }
+        return std::norm(response);
+    };
+    double expected = gain(SvdBeamformer().ComputeBeamformingVectors(channel));
+    NS_TEST_ASSERT_MSG_EQ_TOL(gain(bfVectors),
+                              expected,
+                              1e-4 * expected,
+                              "The vectors should be those of the current channel");
+    m_numChecks++;
+}
+
+void
+QdChannelTestCaseSvdBeamformer::DoRun(void)
+{
+    // the second scenario draws the same positions, with another number of rays
+    uint32_t numTimesteps = 4;
+    SyntheticScenario synthetic =
+        CreateSyntheticScenario(CreateTempDirFilename(""), 2, numTimesteps, 5);
+    m_mobs = synthetic.mobs;
+    m_arrays = synthetic.arrays;
+    Ptr<QdScenarioGenerator> next = CreateObject<QdScenarioGenerator>();
+    next->SetAttribute("NumNodes", UintegerValue(2));
+    next->SetAttribute("NumTimesteps", UintegerValue(numTimesteps));
+    next->SetAttribute("TotalTimeDuration", TimeValue(MilliSeconds(100 * numTimesteps)));
+    next->SetAttribute("NumMpcs", StringValue("ns3::ConstantRandomVariable[Constant=3]"));
+    next->AssignStreams(0);
+    next->Generate(synthetic.path, "SyntheticNext");
+    m_qdChannel = CreateObject<QdChannelModel>(synthetic.path, synthetic.name);
+
+    // within a timestep the vectors are memoized, and they are computed again for each
+    // timestep
+    Simulator::Schedule(MilliSeconds(50), &QdChannelTestCaseSvdBeamformer::Beamform, this, 1, 0);
+    Simulator::Schedule(MilliSeconds(60), &QdChannelTestCaseSvdBeamformer::Beamform, this, 1, 1);
+    Simulator::Schedule(MilliSeconds(150), &QdChannelTestCaseSvdBeamformer::Beamform, this, 2, 1);
+    // the channel of the new scenario is generated at the same time as the one of the old
+    // scenario, possibly in the same buffers, and its vectors are computed again
+    Simulator::Schedule(MilliSeconds(200), &QdChannelTestCaseSvdBeamformer::Beamform, this, 3, 1);
+    m_qdChannel->PreloadScenario("SyntheticNext", MilliSeconds(200));
+    Simulator::Schedule(MilliSeconds(200), &QdChannelTestCaseSvdBeamformer::Beamform, this, 4, 1);
+    Simulator::Schedule(MilliSeconds(210), &QdChannelTestCaseSvdBeamformer::Beamform, this, 4, 2);
+
+    Simulator::Run();
+    NS_TEST_ASSERT_MSG_EQ(m_numChecks, 6, "Checking the number of checks");
+
+    m_qdChannel = nullptr;
+    Simulator::Destroy();
+}
+
+// Test case for the warm start of SvdBeamformer over consecutive timesteps
+class QdChannelTestCaseWarmStart : public TestCase
+{
+  public:
+    QdChannelTestCaseWarmStart();
+    virtual ~QdChannelTestCaseWarmStart();
+
+  private:
+    virtual void DoRun(void);
+};
+
+QdChannelTestCaseWarmStart::QdChannelTestCaseWarmStart()
+    : TestCase("QdChannelTestCaseWarmStart")
+{
+}
+
+QdChannelTestCaseWarmStart::~QdChannelTestCaseWarmStart()
+{
+}
+
+void
+QdChannelTestCaseWarmStart::DoRun(void)
+{
+    // the ray-traced scenario, whose channels change little between consecutive timesteps
+    NodeContainer nodes;
+    nodes.Create(2);
+    Ptr<MobilityModel> mob0 = CreateObject<ConstantPositionMobilityModel>();
+    mob0->SetPosition(Vector(5, 0.1, 1.5));
+    Ptr<MobilityModel> mob1 = CreateObject<ConstantPositionMobilityModel>();
+    mob1->SetPosition(Vector(5, 0.1, 2.9));
+    nodes.Get(0)->AggregateObject(mob0);
+    nodes.Get(1)->AggregateObject(mob1);
+    Ptr<QdChannelModel> qdChannel =
+        CreateObject<QdChannelModel>("contrib/qd-channel/model/QD/", "Indoor1");
+
+    Ptr<PhasedArrayModel> aArray = CreateObjectWithAttributes<UniformPlanarArray>(
+        "NumColumns",
+        UintegerValue(4),
+        "NumRows",
+        UintegerValue(4));
+    Ptr<PhasedArrayModel> bArray = CreateObjectWithAttributes<UniformPlanarArray>(
+        "NumColumns",
+        UintegerValue(4),
+        "NumRows",
+        UintegerValue(4));
+
+    // the matrices are built from the rays of each timestep, without the simulator, and are
+    // never memoized, as they do not identify their realization
+    auto getChannel = [&](uint64_t timestep) {
+        Ptr<const QdChannelModel::ChannelRays> rays =
+            qdChannel->GetChannelRays(nodes.Get(0)->GetId(),
+                                      nodes.Get(1)->GetId(),
+                                      aArray,
+                                      bArray,
+                                      timestep);
+        Ptr<MatrixBasedChannelModel::ChannelMatrix> channel =
+            Create<MatrixBasedChannelModel::ChannelMatrix>();
+        uint64_t bSize = bArray->GetNumberOfElements();
+        uint64_t aSize = aArray->GetNumberOfElements();
+        channel->m_channel = MatrixBasedChannelModel::Complex3DVector(bSize, aSize, 1);
+        for (size_t k = 0; k < rays->m_rayGain.size(); k++)
+        {
+            for (uint64_t bIndex = 0; bIndex < bSize; bIndex++)
+            {
+                for (uint64_t aIndex = 0; aIndex < aSize; aIndex++)
+                {
+                    channel->m_channel(bIndex, aIndex, 0) += rays->m_rayGain[k] *
+                                                             rays->m_bSteering(bIndex, k) *
+                                                             rays->m_aSteering(aIndex, k);
+                }
+            }
+        }
+        channel->m_antennaPair = std::make_pair(aArray->GetId(), bArray->GetId());
+        return std::make_pair(channel, !rays->m_rayGain.empty());
+    };
+
+    const uint64_t numTimesteps = std::min<uint64_t>(20, qdChannel->GetNumTimesteps());
+    for (bool matrixFree : {false, true})
+    {
+        // the warm-started beamformer is kept over the timesteps, while a new one, starting
+        // from the first row of the correlation matrix, is used at each timestep
+        SvdBeamformer warm(30, 1e-8, matrixFree);
+        uint64_t coldIterations = 0;
+        Ptr<const MatrixBasedChannelModel::ChannelMatrix> last;
+        for (uint64_t t = 0; t < numTimesteps; t++)
+        {
+            auto channel = getChannel(t);
+            if (!channel.second)
+            {
+                continue;
+            }
+            warm.ComputeBeamformingVectors(channel.first);
+            SvdBeamformer cold(30, 1e-8, matrixFree);
+            cold.ComputeBeamformingVectors(channel.first);
+            coldIterations += cold.GetTotalIterations();
+            last = channel.first;
+        }
+        NS_LOG_INFO("Iterations over " << numTimesteps << " timesteps with matrixFree="
+                                       << matrixFree << ": " << warm.GetTotalIterations()
+                                       << " warm-started, " << coldIterations
+                                       << " cold-started");
+        NS_TEST_ASSERT_MSG_GT(warm.GetNumComputations(), 1, "Checking the computations");
+        NS_TEST_ASSERT_MSG_LT(warm.GetTotalIterations(),
+                              coldIterations,
+                              "The warm start should need fewer iterations, matrixFree="
+                                  << matrixFree);
+
+        // starting from the solution of the same channel, one or two iterations are enough
+        warm.ComputeBeamformingVectors(last);
+        NS_TEST_ASSERT_MSG_LT_OR_EQ(warm.GetLastIterations().first,
+                                    2,
+                                    "Checking the warm start on the same channel, matrixFree="
+                                        << matrixFree);
+        NS_TEST_ASSERT_MSG_LT_OR_EQ(warm.GetLastIterations().second,
+                                    2,
+                                    "Checking the warm start on the same channel, matrixFree="
+                                        << matrixFree);
+    }
+
+    Simulator::Destroy();
+}
+
+// Test case for the trace sources and the StatsFile of QdChannelModel, including the
+// beamforming statistics reported by an attached SvdBeamformer
+class QdChannelTestCaseStatsFile : public TestCase
+{
+  public:
+    QdChannelTestCaseStatsFile();
+    virtual ~QdChannelTestCaseStatsFile();
+
+  private:
+    virtual void DoRun(void);
+
+    /**
+     * Get the channel between the two nodes and compute its beamforming vectors
+     */
+    void Beamform();
+
+    /**
+     * Sink of the GetChannelCalls trace source
+     *
+     * \param oldValue the previous value
+     * \param newValue the new value
+     */
+    void GetChannelCallsTrace(uint64_t oldValue, uint64_t newValue);
+
+    /**
+     * Sink of the CacheHits trace source
+     *
+     * \param oldValue the previous value
+     * \param newValue the new value
+     */
+    void CacheHitsTrace(uint64_t oldValue, uint64_t newValue);
+
+    /**
+     * Sink of the Regenerations trace source
+     *
+     * \param oldValue the previous value
+     * \param newValue the new value
+     */
+    void RegenerationsTrace(uint64_t oldValue, uint64_t newValue);
+
+    /**
+     * Sink of the ChannelRegenerated trace source
+     *
+     * \param aNodeId ns-3 ID of the a node
+     * \param bNodeId ns-3 ID of the b node
+     * \param latency wall-clock time spent generating the channel matrix
+     */
+    void ChannelRegeneratedTrace(uint32_t aNodeId, uint32_t bNodeId, Time latency);
+
+    /**
+     * Sink of the BeamformingComputed trace source
+     *
+     * \param latency wall-clock time spent computing the beamforming vectors
+     */
+    void BeamformingComputedTrace(Time latency);
+
+    Ptr<QdChannelModel> m_qdChannel;             //!< the channel model
+    std::vector<Ptr<MobilityModel>> m_mobs;      //!< mobility models of the nodes
+    std::vector<Ptr<PhasedArrayModel>> m_arrays; //!< antennas of the nodes
+    SvdBeamformer m_beamformer;                  //!< the beamformer
+    uint64_t m_getChannelCalls{0};               //!< last value of GetChannelCalls
+    uint64_t m_cacheHits{0};                     //!< last value of CacheHits
+    uint64_t m_regenerations{0};                 //!< last value of Regenerations
+    uint32_t m_channelsRegenerated{0};           //!< calls of the ChannelRegenerated sink
+    uint32_t m_beamformingComputed{0};           //!< calls of the BeamformingComputed sink
+};
+
+QdChannelTestCaseStatsFile::QdChannelTestCaseStatsFile()
+    : TestCase("QdChannelTestCaseStatsFile")
+{
+}
+
+QdChannelTestCaseStatsFile::~QdChannelTestCaseStatsFile()
+{
+}
+
+void
+QdChannelTestCaseStatsFile::Beamform()
+{
+    m_beamformer.ComputeBeamformingVectors(
+        m_qdChannel->GetChannel(m_mobs[0], m_mobs[1], m_arrays[0], m_arrays[1]));
+}
+
+void
+QdChannelTestCaseStatsFile::GetChannelCallsTrace(uint64_t oldValue, uint64_t newValue)
+{
+    NS_TEST_ASSERT_MSG_EQ(newValue, oldValue + 1, "GetChannelCalls should be incremented");
+    m_getChannelCalls = newValue;
+}
+
+void
+QdChannelTestCaseStatsFile::CacheHitsTrace(uint64_t oldValue, uint64_t newValue)
+{
+    NS_TEST_ASSERT_MSG_EQ(newValue, oldValue + 1, "CacheHits should be incremented");
+    m_cacheHits = newValue;
+}
+
+void
+QdChannelTestCaseStatsFile::RegenerationsTrace(uint64_t oldValue, uint64_t newValue)
+{
+    NS_TEST_ASSERT_MSG_EQ(newValue, oldValue + 1, "Regenerations should be incremented");
+    m_regenerations = newValue;
+}
+
+void
+QdChannelTestCaseStatsFile::ChannelRegeneratedTrace(uint32_t aNodeId,
+                                                    uint32_t bNodeId,
+                                                    Time latency)
+{
+    NS_TEST_ASSERT_MSG_EQ((std::minmax(aNodeId, bNodeId) ==
+                           std::minmax(m_mobs[0]->GetObject<Node>()->GetId(),
+                                       m_mobs[1]->GetObject<Node>()->GetId())),
+                          true,
+                          "The regenerated channel should be the one of the two nodes");
+    NS_TEST_ASSERT_MSG_EQ(latency.IsStrictlyNegative(),
+                          false,
+                          "The latency should not be negative");
+    m_channelsRegenerated++;
+}
+
+void
+QdChannelTestCaseStatsFile::BeamformingComputedTrace(Time latency)
+{
+    NS_TEST_ASSERT_MSG_EQ(latency.IsStrictlyNegative(),
+                          false,
+                          "The latency should not be negative");
+    m_beamformingComputed++;
+}
+
+void
+QdChannelTestCaseStatsFile::DoRun(void)
+{
+    SyntheticScenario synthetic = CreateSyntheticScenario(CreateTempDirFilename(""), 2, 2, 5);
+    m_mobs = synthetic.mobs;
+    m_arrays = synthetic.arrays;
+    std::string statsFile = CreateTempDirFilename("qd-channel-stats.txt");
+
+    m_qdChannel = CreateObject<QdChannelModel>(synthetic.path, synthetic.name);
+    m_qdChannel->SetAttribute("StatsFile", StringValue(statsFile));
+    m_qdChannel->TraceConnectWithoutContext(
+        "GetChannelCalls",
+        MakeCallback(&QdChannelTestCaseStatsFile::GetChannelCallsTrace, this));
+    m_qdChannel->TraceConnectWithoutContext(
+        "CacheHits",
+        MakeCallback(&QdChannelTestCaseStatsFile::CacheHitsTrace, this));
+    m_qdChannel->TraceConnectWithoutContext(
+        "Regenerations",
+        MakeCallback(&QdChannelTestCaseStatsFile::RegenerationsTrace, this));
+    m_qdChannel->TraceConnectWithoutContext(
+        "ChannelRegenerated",
+        MakeCallback(&QdChannelTestCaseStatsFile::ChannelRegeneratedTrace, this));
+    m_qdChannel->TraceConnectWithoutContext(
+        "BeamformingComputed",
+        MakeCallback(&QdChannelTestCaseStatsFile::BeamformingComputedTrace, this));
+    m_beamformer.SetChannelModel(m_qdChannel);
+
+    // the second call within the first timestep is served by the cache, and the beamforming
+    // vectors of its channel are memoized
+    Simulator::Schedule(MilliSeconds(50), &QdChannelTestCaseStatsFile::Beamform, this);
+    Simulator::Schedule(MilliSeconds(60), &QdChannelTestCaseStatsFile::Beamform, this);
+    Simulator::Schedule(MilliSeconds(150), &QdChannelTestCaseStatsFile::Beamform, this);
+    Simulator::Run();
+
+    NS_TEST_ASSERT_MSG_EQ(m_getChannelCalls, 3, "Checking the traced GetChannel calls");
+    NS_TEST_ASSERT_MSG_EQ(m_cacheHits, 1, "Checking the traced cache hits");
+    NS_TEST_ASSERT_MSG_EQ(m_regenerations, 2, "Checking the traced regenerations");
+    NS_TEST_ASSERT_MSG_EQ(m_channelsRegenerated, 2, "Checking the regenerated channels");
+    NS_TEST_ASSERT_MSG_EQ(m_beamformingComputed, 2, "Checking the beamforming computations");
+
+    // the statistics are written at Simulator::Destroy
+    Simulator::Destroy();
+    m_beamformer.SetChannelModel(nullptr);
+    m_qdChannel = nullptr;
+
+    std::ifstream f(statsFile);
+    NS_TEST_ASSERT_MSG_EQ(f.is_open(), true, "The statistics should be written");
+    std::map<std::string, std::string> values;
+    uint64_t beamformingLatencyCount = 0;
+    bool beamformingLatency = false;
+    std::string line;
+    while (std::getline(f, line))
+    {
+        size_t separator = line.find(": ");
+        if (beamformingLatency && separator != std::string::npos && line[0] == '[')
+        {
+            beamformingLatencyCount += std::stoull(line.substr(separator + 2));
+            continue;
+        }
+        beamformingLatency = line.rfind("Beamforming latency", 0) == 0;
+        if (separator != std::string::npos)
+        {
+            values[line.substr(0, separator)] = line.substr(separator + 2);
+        }
+    }
+    NS_TEST_ASSERT_MSG_EQ(values["GetChannel calls"], "3", "Checking the GetChannel calls");
+    NS_TEST_ASSERT_MSG_EQ(values["Cache hits"], "1", "Checking the cache hits");
+    NS_TEST_ASSERT_MSG_EQ(values["Regenerations"], "2", "Checking the regenerations");
+    NS_TEST_ASSERT_MSG_EQ(values["Beamforming computations"],
+                          "2",
+                          "Checking the beamforming computations");
+    NS_TEST_ASSERT_MSG_EQ(values["Beamforming cache hits"],
+                          "1",
+                          "Checking the beamforming cache hits");
+    NS_TEST_ASSERT_MSG_EQ(beamformingLatencyCount,
+                          2,
+                          "The beamforming latency histogram should count each computation");
+}
+
+// Test case for the LoadReportFile of QdChannelModel and the timings of each loading stage
+class QdChannelTestCaseLoadReportFile : public TestCase
+{
+  public:
+    QdChannelTestCaseLoadReportFile();
+    virtual ~QdChannelTestCaseLoadReportFile();
+
+  private:
+    virtual void DoRun(void);
+};
+
+QdChannelTestCaseLoadReportFile::QdChannelTestCaseLoadReportFile()
+    : TestCase("QdChannelTestCaseLoadReportFile")
+{
+}
+
+QdChannelTestCaseLoadReportFile::~QdChannelTestCaseLoadReportFile()
+{
+}
+
+void
+QdChannelTestCaseLoadReportFile::DoRun(void)
+{
+    uint32_t numNodes = 3;
+    SyntheticScenario synthetic = CreateSyntheticScenario(CreateTempDirFilename(""), numNodes, 2);
+    std::string loadReportFile = CreateTempDirFilename("qd-channel-load-report.txt");
+
+    Ptr<QdChannelModel> qdChannel = CreateObject<QdChannelModel>();
+    qdChannel->SetAttribute("LoadReportFile", StringValue(loadReportFile));
+    qdChannel->SetPath(synthetic.path);
+    qdChannel->SetScenario(synthetic.name);
+
+    // the nodes position file, the configuration file, and a QD file per direction of each
+    // pair of nodes
+    const QdChannelModel::LoadReport& report = qdChannel->GetLoadReport();
+    NS_TEST_ASSERT_MSG_EQ(report.fileLoadTimes.size(),
+                          2 + numNodes * (numNodes - 1),
+                          "Each file should have its load time");
+    for (const auto& file : report.fileLoadTimes)
+    {
+        NS_TEST_ASSERT_MSG_EQ((file.second >= 0),
+                              true,
+                              "Checking the load time of " << file.first);
+    }
+
+    // the report is written at Simulator::Destroy
+    Simulator::Destroy();
+    std::map<std::string, std::string> stages;
+    {
+        std::ifstream f(loadReportFile);
+        NS_TEST_ASSERT_MSG_EQ(f.is_open(), true, "The load report should be written");
+        std::string line;
+        while (std::getline(f, line))
+        {
+            size_t separator = line.find(": ");
+            if (separator != std::string::npos)
+            {
+                stages[line.substr(0, separator)] = line.substr(separator + 2);
+            }
+        }
+    }
+
+    std::map<std::string, uint64_t> stageBytes = {{"ReadParaCfgFile", report.paraCfgBytes},
+                                                  {"ReadNodesPosition", report.nodesPositionBytes},
+                                                  {"ReadQdFiles", report.qdFilesBytes}};
+    for (const auto& stage : stageBytes)
+    {
+        NS_TEST_ASSERT_MSG_EQ(stages.count(stage.first),
+                              1,
+                              "The report should list the stage " << stage.first);
+        NS_TEST_ASSERT_MSG_GT(stage.second, 0, "Checking the bytes read by " << stage.first);
+
+        // each stage is reported as "<time> s, <bytes> bytes"
+        std::istringstream value(stages[stage.first]);
+        double time = -1;
+        std::string unit;
+        uint64_t bytes = 0;
+        value >> time >> unit >> bytes;
+        NS_TEST_ASSERT_MSG_EQ((time >= 0), true, "Checking the time of " << stage.first);
+        NS_TEST_ASSERT_MSG_EQ(bytes, stage.second, "Checking the bytes of " << stage.first);
+    }
+    NS_TEST_ASSERT_MSG_EQ(stages.count("QD information"),
+                          1,
+                          "The report should list the memory of the QD information");
+
+    qdChannel = nullptr;
+}
+
+// Test case for concurrent GetSharedChannel and GetSharedParams calls from many threads,
+// all requesting the same links in both directions
+class QdChannelTestCaseConcurrentGetChannel : public TestCase
+{
+  public:
+    QdChannelTestCaseConcurrentGetChannel();
+    virtual ~QdChannelTestCaseConcurrentGetChannel();
+
+  private:
+    virtual void DoRun(void);
+
+    /**
+     * Request the channels from the reader threads, released at the same time, and check
+     * that they got a single channel per link, equal to the reference one
+     *
+     * \param generationTime the time when the current channels are expected to be generated
+     */
+    void RunReaders(Time generationTime);
+
+    uint32_t m_numNodes;                         //!< number of nodes
+    uint32_t m_numThreads;                       //!< number of reader threads
+    uint32_t m_numCalls;                         //!< GetSharedChannel calls per thread and run
+    Ptr<QdChannelModel> m_qdChannel;             //!< the channel model shared by the threads
+    Ptr<QdChannelModel> m_reference;             //!< model used only by the main thread
+    std::vector<Ptr<MobilityModel>> m_mobs;      //!< mobility models of the nodes
+    std::vector<Ptr<PhasedArrayModel>> m_arrays; //!< antennas of the nodes
+    std::vector<std::pair<uint32_t, uint32_t>>
+        m_links; //!< indices of the nodes of each handle, two per link
+    std::vector<QdChannelModel::LinkHandle> m_handles; //!< handles of the links, both directions
+    std::atomic<uint32_t> m_failures;                  //!< number of unexpected results
+};
+
+QdChannelTestCaseConcurrentGetChannel::QdChannelTestCaseConcurrentGetChannel()
+    : TestCase("QdChannelTestCaseConcurrentGetChannel"),
+      m_numNodes(4),
+      m_numThreads(8),
+      m_numCalls(1000),
+      m_failures(0)
+{
+}
+
+QdChannelTestCaseConcurrentGetChannel::~QdChannelTestCaseConcurrentGetChannel()
+{
+}
+
+void
+QdChannelTestCaseConcurrentGetChannel::RunReaders(Time generationTime)
+{
+    // the channels returned to each thread, with the index of their handle, are kept until
+    // the threads are done, so that their buffers cannot be reused in the meantime
+    using SharedChannel = std::shared_ptr<const MatrixBasedChannelModel::ChannelMatrix>;
+    std::vector<std::vector<std::pair<uint32_t, SharedChannel>>> returned(m_numThreads);
+    std::atomic<bool> start(false);
+    std::vector<std::thread> readers;
+    for (uint32_t k = 0; k < m_numThreads; k++)
+    {
+        readers.emplace_back([this, k, generationTime, &start, &returned]() {
+            while (!start.load())
+            {
+                std::this_thread::yield();
+            }
+            for (uint32_t i = 0; i < m_numCalls; i++)
+            {
+                // each thread cycles over all the handles, starting from a different one
+                uint32_t index = (i + k) % m_handles.size();
+                SharedChannel channel = m_qdChannel->GetSharedChannel(m_handles[index]);
+                std::shared_ptr<const MatrixBasedChannelModel::ChannelParams> params =
+                    m_qdChannel->GetSharedParams(m_handles[index]);
+                if (!channel || !params || channel->m_generatedTime != generationTime ||
+                    params->m_generatedTime != generationTime)
+                {
+                    m_failures++;
+                    continue;
+                }
+                auto seen = std::find_if(returned[k].begin(),
+                                         returned[k].end(),
+                                         [&channel](const auto& entry) {
+                                             return entry.second == channel;
+                                         });
+                if (seen == returned[k].end())
+                {
+                    returned[k].emplace_back(index, channel);
+                }
+            }
+        });
+    }
+    start = true;
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+
+    // all the threads got the same channel for a link, whatever the direction of their
+    // requests, generated in either direction
+    std::map<uint32_t, std::set<const MatrixBasedChannelModel::ChannelMatrix*>> linkChannels;
+    for (const auto& threadChannels : returned)
+    {
+        for (const auto& entry : threadChannels)
+        {
+            const MatrixBasedChannelModel::ChannelMatrix* channel = entry.second.get();
+            linkChannels[entry.first / 2].insert(channel);
+
+            // the direction of the generation is given by the order of the antennas
+            uint32_t a = m_links[entry.first].first;
+            uint32_t b = m_links[entry.first].second;
+            if (channel->m_antennaPair.first != m_arrays[a]->GetId())
+            {
+                std::swap(a, b);
+            }
+            NS_TEST_EXPECT_MSG_EQ((channel->m_antennaPair ==
+                                   std::make_pair(m_arrays[a]->GetId(), m_arrays[b]->GetId())),
+                                  true,
+                                  "Checking the antennas of the channel");
+
+            Ptr<const MatrixBasedChannelModel::ChannelMatrix> reference =
+                m_reference->GetChannel(m_mobs[a], m_mobs[b], m_arrays[a], m_arrays[b]);
+            NS_TEST_EXPECT_MSG_EQ(channel->m_channel.GetSize(),
+                                  reference->m_channel.GetSize(),
+                                  "Checking the size of the channel");
+            size_t size = std::min(channel->m_channel.GetSize(), reference->m_channel.GetSize());
+            for (size_t i = 0; i < size; i++)
+            {
+                NS_TEST_EXPECT_MSG_EQ(channel->m_channel[i],
+                                      reference->m_channel[i],
+                                      "Checking coefficient " << i << " of link " << a << "-"
+                                                              << b);
+            }
+        }
+    }
+    NS_TEST_EXPECT_MSG_EQ(linkChannels.size(),
+                          m_handles.size() / 2,
+                          "All the links should have been requested");
+    for (const auto& link : linkChannels)
+    {
+        NS_TEST_EXPECT_MSG_EQ(link.second.size(),
+                              1,
+                              "The threads should share the channel of link " << link.first);
+    }
+
+    // the params are published with the matrix
+    for (uint32_t index = 0; index < m_handles.size(); index++)
+    {
+        SharedChannel channel = m_qdChannel->GetSharedChannel(m_handles[index]);
+        std::shared_ptr<const MatrixBasedChannelModel::ChannelParams> params =
+            m_qdChannel->GetSharedParams(m_handles[index]);
+        bool sameOrder = channel->m_antennaPair.first == m_arrays[m_links[index].first]->GetId();
+        NS_TEST_EXPECT_MSG_EQ(params->m_nodeIds.first,
+                              sameOrder ? m_handles[index].aNodeId : m_handles[index].bNodeId,
+                              "Checking the nodes of the params");
+        NS_TEST_EXPECT_MSG_EQ(params->m_nodeIds.second,
+                              sameOrder ? m_handles[index].bNodeId : m_handles[index].aNodeId,
+                              "Checking the nodes of the params");
+    }
+}
+
+void
+QdChannelTestCaseConcurrentGetChannel::DoRun(void)
+{
+    uint32_t numTimesteps = 3;
+
+    SyntheticScenario synthetic =
+        CreateSyntheticScenario(CreateTempDirFilename(""), m_numNodes, numTimesteps);
+    m_mobs = synthetic.mobs;
+    m_arrays = synthetic.arrays;
+    m_qdChannel = CreateObject<QdChannelModel>(synthetic.path, synthetic.name);
+    m_reference = CreateObject<QdChannelModel>(synthetic.path, synthetic.name);
+
+    // the handles are resolved by the main thread, in both directions of each link
+    for (uint32_t i = 0; i < m_numNodes; i++)
+    {
+        for (uint32_t j = i + 1; j < m_numNodes; j++)
+        {
+            m_links.emplace_back(i, j);
+            m_handles.push_back(
+                m_qdChannel->ResolveLink(m_mobs[i], m_mobs[j], m_arrays[i], m_arrays[j]));
+            m_links.emplace_back(j, i);
+            m_handles.push_back(
+                m_qdChannel->ResolveLink(m_mobs[j], m_mobs[i], m_arrays[j], m_arrays[i]));
+        }
+    }
+    uint32_t numLinks = m_handles.size() / 2;
+
+    // the threads request the channels in the middle of the first timestep, right before and
+    // right after the boundary with the second one, and in the third one. The second run
+    // finds the channels of the first one, while the third one regenerates them all at once.
+    // Each run is given with the time when its channels are expected to be generated
+    std::vector<std::pair<Time, Time>> runs = {
+        {MilliSeconds(50), MilliSeconds(50)},
+        {MilliSeconds(100) - NanoSeconds(1), MilliSeconds(50)},
+        {MilliSeconds(100), MilliSeconds(100)},
+        {MilliSeconds(250), MilliSeconds(250)}};
+    for (const auto& run : runs)
+    {
+        Simulator::Schedule(run.first,
+                            &QdChannelTestCaseConcurrentGetChannel::RunReaders,
+                            this,
+                            run.second);
+    }
+    Simulator::Run();
+
+    NS_TEST_ASSERT_MSG_EQ(m_failures.load(), 0, "Checking the channels returned to the threads");
+    QdChannelModel::Stats stats = m_qdChannel->GetStats();
+    uint64_t numCalls = uint64_t(m_numThreads) * m_numCalls * runs.size();
+    uint64_t numChecks = uint64_t(m_handles.size()) * runs.size();
+    NS_TEST_ASSERT_MSG_EQ(stats.getChannelCalls,
+                          numCalls + numChecks,
+                          "Checking the number of GetChannel calls");
+    NS_TEST_ASSERT_MSG_EQ(stats.regenerations,
+                          numLinks * numTimesteps,
+                          "Checking that each link is generated once per timestep");
+    NS_TEST_ASSERT_MSG_EQ(stats.cacheHits,
+                          stats.getChannelCalls - stats.regenerations,
+                          "Checking the number of cache hits");
+    NS_TEST_ASSERT_MSG_EQ(stats.paramsMisses, 0, "Checking the number of GetParams misses");
+    NS_TEST_ASSERT_MSG_EQ(stats.linkRegenerations.size(),
+                          numLinks,
+                          "Checking the number of generated links");
+    for (const auto& link : stats.linkRegenerations)
+    {
+        NS_TEST_ASSERT_MSG_EQ(link.second,
+                              numTimesteps,
+                              "Checking the regenerations of link " << link.first.first << "-"
+                                                                    << link.first.second);
+    }
+
+    m_handles.clear();
+    m_qdChannel = nullptr;
+    m_reference = nullptr;
+    m_mobs.clear();
+    m_arrays.clear();
+    Simulator::Destroy();
+}
+
 // The TestSuite class names the TestSuite, identifies what type of TestSuite,
 // and enables the TestCases to be run.  Typically, only the constructor for
 // this class must be defined
@@ -82,6 +3087,25 @@ QdChannelTestSuite::QdChannelTestSuite()
 {
     // TestDuration for TestCase can be QUICK, EXTENSIVE or TAKES_FOREVER
     AddTestCase(new QdChannelTestCaseInput, TestCase::QUICK);
+    AddTestCase(new QdChannelTestCaseSyntheticScenario, TestCase::QUICK);
+    AddTestCase(new QdChannelTestCaseNodeSubset, TestCase::QUICK);
+    AddTestCase(new QdChannelTestCasePartitionBySystemId, TestCase::QUICK);
+    AddTestCase(new QdChannelTestCaseConcurrentGetChannel, TestCase::QUICK);
+    AddTestCase(new QdChannelTestCaseSpectrumPropagationLossModel, TestCase::QUICK);
+    AddTestCase(new QdChannelTestCaseSteeringVectors, TestCase::QUICK);
+    AddTestCase(new QdChannelTestCaseBeamSweep, TestCase::QUICK);
+    AddTestCase(new QdChannelTestCaseChannelCache, TestCase::QUICK);
+    AddTestCase(new QdChannelTestCaseAsyncLoading, TestCase::QUICK);
+    AddTestCase(new QdChannelTestCaseCancelLoading, TestCase::QUICK);
+    AddTestCase(new QdChannelTestCaseLinkPruning, TestCase::QUICK);
+    AddTestCase(new QdChannelTestCaseKernelEquivalence, TestCase::QUICK);
+    AddTestCase(new QdChannelTestCaseBufferReuse, TestCase::QUICK);
+    AddTestCase(new QdChannelTestCaseLinkHandle, TestCase::QUICK);
+    AddTestCase(new QdChannelTestCasePreloadScenario, TestCase::QUICK);
+    AddTestCase(new QdChannelTestCaseSvdBeamformer, TestCase::QUICK);
+    AddTestCase(new QdChannelTestCaseWarmStart, TestCase::QUICK);
+    AddTestCase(new QdChannelTestCaseStatsFile, TestCase::QUICK);
+    AddTestCase(new QdChannelTestCaseLoadReportFile, TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite